@@ -0,0 +1,190 @@
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+#include "Arena.h"
+
+C_arena::C_arena(u64 BlockSize)
+   : m_BlockSize(BlockSize),
+     m_Offset(0),
+     m_Last(0),
+     m_Used(0),
+     m_HighWater(0),
+     m_BlocksTaken(0)
+{
+}
+
+C_arena::~C_arena()
+{
+   for (TBlock& block : m_Blocks)
+      free(block.Data);
+}
+
+C_arena& C_arena::ForThread()
+{
+   static thread_local C_arena arena;
+   return arena;
+}
+
+void C_arena::NewBlock(u64 Size)
+{
+   TBlock block;
+
+   block.Size = Size;
+   block.Data = (u8*)aligned_alloc(ALIGN, (Size + ALIGN - 1) & ~(ALIGN - 1));
+
+   if (!block.Data)
+      throw std::bad_alloc();
+
+   m_Blocks.push_back(block);
+   m_Offset = 0;
+   m_BlocksTaken++;
+}
+
+void* C_arena::Alloc(u64 Size, u64 Align)
+{
+   u64 offset = 0;
+
+   if (!m_Blocks.empty())
+      offset = (m_Offset + Align - 1) & ~(Align - 1);
+
+   if (m_Blocks.empty() || offset + Size > m_Blocks.back().Size)
+   {
+      u64 size = m_BlockSize;
+      while (size < Size + Align)
+         size *= 2;
+
+      NewBlock(size);
+      offset = ((u64)(uintptr_t)m_Blocks.back().Data % Align) ? Align - (u64)(uintptr_t)m_Blocks.back().Data % Align : 0;
+   }
+
+   m_Used   += offset + Size - m_Offset;
+   m_Offset  = offset + Size;
+   m_Last    = offset;
+
+   return m_Blocks.back().Data + offset;
+}
+
+void C_arena::Shrink(void* Last, u64 Size)
+{
+   if (m_Blocks.empty())
+      return;
+
+   u64 offset = (u64)((u8*)Last - m_Blocks.back().Data);
+
+   // Only the newest allocation can give memory back
+   if ((u8*)Last >= m_Blocks.back().Data && offset == m_Last && offset + Size <= m_Offset)
+   {
+      m_Used   -= m_Offset - (offset + Size);
+      m_Offset  = offset + Size;
+   }
+}
+
+u64 C_arena::Available() const
+{
+   if (m_Blocks.empty())
+      return 0;
+
+   u64 offset = (m_Offset + ALIGN - 1) & ~(ALIGN - 1);
+   return (offset < m_Blocks.back().Size) ? m_Blocks.back().Size - offset : 0;
+}
+
+void C_arena::Reset()
+{
+   if (m_Used > m_HighWater)
+      m_HighWater = m_Used;
+
+   // Fold a chain into one block big enough for the whole batch
+   if (m_Blocks.size() > 1)
+   {
+      u64 size = m_BlockSize;
+      while (size < m_HighWater)
+         size *= 2;
+
+      for (TBlock& block : m_Blocks)
+         free(block.Data);
+      m_Blocks.clear();
+
+      NewBlock(size);
+   }
+
+   m_Offset = 0;
+   m_Last   = 0;
+   m_Used   = 0;
+}
+
+static thread_local u32 g_QueryDepth       = 0;
+static thread_local u64 g_QueryAllocations = 0;
+
+C_queryScope::C_queryScope()
+{
+   g_QueryDepth++;
+}
+
+C_queryScope::~C_queryScope()
+{
+   g_QueryDepth--;
+}
+
+u64 C_queryScope::Allocations()
+{
+   return g_QueryAllocations;
+}
+
+void C_queryScope::ResetAllocations()
+{
+   g_QueryAllocations = 0;
+}
+
+#if defined(QUERY_ALLOC_CHECK) && QUERY_ALLOC_CHECK
+
+// Every form of operator new comes through here, aligned and nothrow ones
+// included, so none of them slips past the count
+static void* QueryNew(size_t Size, size_t Align, bool Throw)
+{
+   if (g_QueryDepth)
+   {
+      g_QueryAllocations++;
+
+#if QUERY_ALLOC_CHECK >= 2
+      fprintf(stderr, "heap allocation of %zu bytes on a query path\n", Size);
+      abort();
+#endif
+   }
+
+   void* p = nullptr;
+
+   if (Align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+      p = malloc(Size ? Size : 1);
+   else if (posix_memalign(&p, Align, Size ? Size : 1) != 0)
+      p = nullptr;
+
+   if (!p && Throw)
+      throw std::bad_alloc();
+   return p;
+}
+
+void* operator new(size_t Size)                                                           { return QueryNew(Size, 0, true); }
+void* operator new[](size_t Size)                                                         { return QueryNew(Size, 0, true); }
+void* operator new(size_t Size, const std::nothrow_t&) noexcept                           { return QueryNew(Size, 0, false); }
+void* operator new[](size_t Size, const std::nothrow_t&) noexcept                         { return QueryNew(Size, 0, false); }
+void* operator new(size_t Size, std::align_val_t Align)                                   { return QueryNew(Size, (size_t)Align, true); }
+void* operator new[](size_t Size, std::align_val_t Align)                                 { return QueryNew(Size, (size_t)Align, true); }
+void* operator new(size_t Size, std::align_val_t Align, const std::nothrow_t&) noexcept   { return QueryNew(Size, (size_t)Align, false); }
+void* operator new[](size_t Size, std::align_val_t Align, const std::nothrow_t&) noexcept { return QueryNew(Size, (size_t)Align, false); }
+
+// malloc and posix_memalign memory both go back through free
+void  operator delete(void* P) noexcept                                                   { free(P); }
+void  operator delete[](void* P) noexcept                                                 { free(P); }
+void  operator delete(void* P, size_t) noexcept                                           { free(P); }
+void  operator delete[](void* P, size_t) noexcept                                         { free(P); }
+void  operator delete(void* P, const std::nothrow_t&) noexcept                            { free(P); }
+void  operator delete[](void* P, const std::nothrow_t&) noexcept                          { free(P); }
+void  operator delete(void* P, std::align_val_t) noexcept                                 { free(P); }
+void  operator delete[](void* P, std::align_val_t) noexcept                               { free(P); }
+void  operator delete(void* P, size_t, std::align_val_t) noexcept                         { free(P); }
+void  operator delete[](void* P, size_t, std::align_val_t) noexcept                       { free(P); }
+void  operator delete(void* P, std::align_val_t, const std::nothrow_t&) noexcept          { free(P); }
+void  operator delete[](void* P, std::align_val_t, const std::nothrow_t&) noexcept        { free(P); }
+
+#endif
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <stddef.h>
+#include <vector>
+#include "CommonTypes.h"
+
+// Bump allocator for query scratch and results. Allocation is a pointer
+// bump, nothing is freed on its own, Reset() rewinds the whole arena at the
+// end of a batch. When a batch outgrows the arena another block is chained
+// on, and the next Reset() replaces the chain by a single block of the high
+// water mark, so a steady workload stops touching the heap after one batch.
+class C_arena
+{
+public:
+
+   static constexpr u64 DEFAULT_BLOCK = 1 << 20;
+   static constexpr u64 ALIGN         = 16;
+
+   //! Constructor C_arena(u64 BlockSize)
+   //! \details No memory is taken until the first allocation.
+   C_arena(u64 BlockSize = DEFAULT_BLOCK);
+   ~C_arena();
+
+   C_arena(const C_arena&) = delete;
+   C_arena& operator=(const C_arena&) = delete;
+
+   //! void* Alloc(u64 Size, u64 Align)
+   //! \return Size bytes aligned to Align (a power of two), valid until Reset().
+   void* Alloc(u64 Size, u64 Align = ALIGN);
+
+   //! T* Alloc<T>(u64 Count)
+   //! \return Uninitialized room for Count trivially copyable T.
+   template <typename T>
+   T* Alloc(u64 Count) { return (T*)Alloc(Count * sizeof(T), alignof(T) > ALIGN ? alignof(T) : ALIGN); }
+
+   //! T* AllocRest<T>(u64 Min, u64& Count)
+   //! \details Hands out everything left in the current block (at least Min
+   //!          entries) for results of unknown length, give the unused tail
+   //!          back with Shrink().
+   template <typename T>
+   T* AllocRest(u64 Min, u64& Count)
+   {
+      u64 bytes = Available();
+      Count = (bytes / sizeof(T) > Min) ? bytes / sizeof(T) : Min;
+      return Alloc<T>(Count);
+   }
+
+   //! void Shrink(void* Last, u64 Size)
+   //! \details Trims the most recent allocation Last down to Size bytes.
+   void Shrink(void* Last, u64 Size);
+
+   //! void Reset()
+   //! \details Releases every allocation at once.
+   void Reset();
+
+   //! u64 Available()
+   //! \return The bytes left in the current block.
+   u64 Available() const;
+
+   //! u64 Used()
+   //! \return The bytes handed out since the last Reset().
+   u64 Used() const { return m_Used; }
+
+   //! u64 HighWater()
+   //! \return The most bytes in use between two resets.
+   u64 HighWater() const { return (m_Used > m_HighWater) ? m_Used : m_HighWater; }
+
+   //! u64 Blocks()
+   //! \return The number of blocks taken from the heap so far.
+   u64 Blocks() const { return m_BlocksTaken; }
+
+   //! C_arena& ForThread()
+   //! \details The calling thread's own arena, for query paths that do not
+   //!          get one handed down.
+   static C_arena& ForThread();
+
+private:
+
+   struct TBlock
+   {
+      u8* Data;
+      u64 Size;
+   };
+
+   void NewBlock(u64 Size);
+
+   std::vector<TBlock> m_Blocks;
+   u64                 m_BlockSize;
+   u64                 m_Offset;   // into m_Blocks.back()
+   u64                 m_Last;     // start of the newest allocation
+   u64                 m_Used;
+   u64                 m_HighWater;
+   u64                 m_BlocksTaken;
+};
+
+// std allocator over an arena, for result vectors. Deallocation is a no-op,
+// growth leaves the old storage behind until the arena is reset.
+template <typename T>
+struct TArenaAllocator
+{
+   typedef T value_type;
+
+   C_arena* Arena;
+
+   TArenaAllocator(C_arena& Arena) : Arena(&Arena) {}
+   template <typename U>
+   TArenaAllocator(const TArenaAllocator<U>& Other) : Arena(Other.Arena) {}
+
+   T*   allocate(size_t Count) { return Arena->Alloc<T>(Count); }
+   void deallocate(T*, size_t) {}
+
+   template <typename U>
+   bool operator==(const TArenaAllocator<U>& Other) const { return Arena == Other.Arena; }
+   template <typename U>
+   bool operator!=(const TArenaAllocator<U>& Other) const { return Arena != Other.Arena; }
+};
+
+template <typename T>
+using TArenaVector = std::vector<T, TArenaAllocator<T>>;
+
+// Marks the calling thread as being on a query path. Builds with
+// QUERY_ALLOC_CHECK=1 count every operator new made inside a scope, the
+// aligned and nothrow forms too, QUERY_ALLOC_CHECK=2 abort on the first one. Without the flag the scope
+// costs nothing and the counters stay 0.
+class C_queryScope
+{
+public:
+
+   C_queryScope();
+   ~C_queryScope();
+
+   //! u64 Allocations()
+   //! \return The heap allocations the calling thread made inside scopes.
+   static u64 Allocations();
+
+   //! void ResetAllocations()
+   static void ResetAllocations();
+};
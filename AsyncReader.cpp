@@ -0,0 +1,504 @@
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <algorithm>
+#include "AsyncReader.h"
+
+// No liburing, the three system calls are made directly
+static int UringSetup(u32 Entries, io_uring_params* Params)
+{
+   return (int)syscall(__NR_io_uring_setup, Entries, Params);
+}
+
+static int UringEnter(int Ring, u32 Submit, u32 MinComplete, u32 Flags)
+{
+   return (int)syscall(__NR_io_uring_enter, Ring, Submit, MinComplete, Flags, nullptr, 0);
+}
+
+C_asyncReader::C_asyncReader(u32 QueueDepth, u64 ChunkSize, EReadBackend Backend)
+   : m_QueueDepth(std::max(QueueDepth, 1u)),
+     m_ChunkSize(ChunkSize),
+     m_Backend(Backend),
+     m_InFlight(0),
+     m_Ring(-1),
+     m_SqMap(MAP_FAILED),
+     m_CqMap(MAP_FAILED),
+     m_SqeMap(MAP_FAILED),
+     m_SqMapSize(0),
+     m_CqMapSize(0),
+     m_SqeMapSize(0),
+     m_SqHead(nullptr),
+     m_SqTail(nullptr),
+     m_SqMask(nullptr),
+     m_SqArray(nullptr),
+     m_CqHead(nullptr),
+     m_CqTail(nullptr),
+     m_CqMask(nullptr),
+     m_Cqes(nullptr),
+     m_Sqes(nullptr),
+     m_Unsubmitted(0),
+     m_Reaping(false),
+     m_Stop(false)
+{
+   if (m_Backend == READ_BACKEND_URING && !SetupRing())
+      m_Backend = READ_BACKEND_THREADS;
+
+   if (m_Backend == READ_BACKEND_THREADS)
+      for (u32 t = 0; t < READ_THREADS; t++)
+         m_Readers.emplace_back(&C_asyncReader::ReadMain, this);
+}
+
+C_asyncReader::~C_asyncReader()
+{
+   for (u32 f = 0; f < m_Files.size(); f++)
+      Close(f);
+
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      m_Stop = true;
+   }
+   m_Work.notify_all();
+
+   for (std::thread& reader : m_Readers)
+      reader.join();
+
+   if (m_SqeMap != MAP_FAILED)
+      munmap(m_SqeMap, m_SqeMapSize);
+   if (m_CqMap != MAP_FAILED && m_CqMap != m_SqMap)
+      munmap(m_CqMap, m_CqMapSize);
+   if (m_SqMap != MAP_FAILED)
+      munmap(m_SqMap, m_SqMapSize);
+   if (m_Ring >= 0)
+      close(m_Ring);
+}
+
+bool C_asyncReader::SetupRing()
+{
+   io_uring_params params;
+
+   memset(&params, 0, sizeof(params));
+
+   m_Ring = UringSetup(RING_ENTRIES, &params);
+   if (m_Ring < 0)
+      return false;
+
+   // IORING_OP_READ arrived in 5.6, FAST_POLL in 5.7 is the nearest feature bit
+   if (!(params.features & IORING_FEAT_FAST_POLL))
+   {
+      close(m_Ring);
+      m_Ring = -1;
+      return false;
+   }
+
+   m_SqMapSize  = params.sq_off.array + params.sq_entries * sizeof(u32);
+   m_CqMapSize  = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+   m_SqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+
+   if (params.features & IORING_FEAT_SINGLE_MMAP)
+      m_SqMapSize = m_CqMapSize = std::max(m_SqMapSize, m_CqMapSize);
+
+   m_SqMap = mmap(nullptr, m_SqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQ_RING);
+   m_CqMap = (params.features & IORING_FEAT_SINGLE_MMAP) ? m_SqMap :
+             mmap(nullptr, m_CqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_CQ_RING);
+   m_SqeMap = mmap(nullptr, m_SqeMapSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+
+   if (m_SqMap == MAP_FAILED || m_CqMap == MAP_FAILED || m_SqeMap == MAP_FAILED)
+      return false;
+
+   u8* sq = (u8*)m_SqMap;
+   u8* cq = (u8*)m_CqMap;
+
+   m_SqHead  = (u32*)(sq + params.sq_off.head);
+   m_SqTail  = (u32*)(sq + params.sq_off.tail);
+   m_SqMask  = (u32*)(sq + params.sq_off.ring_mask);
+   m_SqArray = (u32*)(sq + params.sq_off.array);
+   m_CqHead  = (u32*)(cq + params.cq_off.head);
+   m_CqTail  = (u32*)(cq + params.cq_off.tail);
+   m_CqMask  = (u32*)(cq + params.cq_off.ring_mask);
+   m_Cqes    = cq + params.cq_off.cqes;
+   m_Sqes    = m_SqeMap;
+
+   return true;
+}
+
+s32 C_asyncReader::Open(const char* Filename)
+{
+   struct stat Stat;
+   int         fd = open(Filename, O_RDONLY);
+
+   if (fd < 0)
+      return -1;
+
+   if (fstat(fd, &Stat) != 0)
+   {
+      close(fd);
+      return -1;
+   }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+   posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+   std::unique_lock<std::mutex> lock(m_Lock);
+
+   if (m_InFlight + m_QueueDepth > RING_ENTRIES)
+   {
+      close(fd);
+      return -1;
+   }
+
+   std::unique_ptr<TFile> file(new TFile());
+
+   file->Fd         = fd;
+   file->Size       = (u64)Stat.st_size;
+   file->NextOffset = 0;
+   file->Head       = 0;
+   file->Failed     = false;
+   file->Slots.resize(m_QueueDepth);
+
+   for (TSlot& slot : file->Slots)
+   {
+      slot.Buffer.reset(new u8[m_ChunkSize + PADDING]);
+      slot.State = SLOT_IDLE;
+   }
+
+   u32 handle = (u32)m_Files.size();
+
+   m_Files.push_back(std::move(file));
+   m_InFlight += m_QueueDepth;
+
+   for (u32 s = 0; s < m_QueueDepth && m_Files[handle]->NextOffset < m_Files[handle]->Size; s++)
+      Submit(handle, s);
+
+   if (m_Backend == READ_BACKEND_URING)
+      Reap();
+
+   return (s32)handle;
+}
+
+void C_asyncReader::Close(u32 File)
+{
+   std::unique_lock<std::mutex> lock(m_Lock);
+   TFile&                       file = *m_Files[File];
+
+   if (file.Fd < 0)
+      return;
+
+   // Buffers may not go away under reads still in flight
+   for (;;)
+   {
+      bool pending = false;
+
+      for (const TSlot& slot : file.Slots)
+         pending = pending || slot.State == SLOT_PENDING;
+
+      if (!pending)
+         break;
+
+      Wait(lock);
+   }
+
+   close(file.Fd);
+
+   file.Fd = -1;
+   file.Slots.clear();
+   m_InFlight -= m_QueueDepth;
+}
+
+// Claims the next range of the file for an idle slot and starts reading it
+void C_asyncReader::Submit(u32 File, u32 Slot)
+{
+   TFile& file = *m_Files[File];
+   TSlot& slot = file.Slots[Slot];
+
+   slot.State  = SLOT_PENDING;
+   slot.Offset = file.NextOffset;
+   slot.Size   = std::min(m_ChunkSize, file.Size - file.NextOffset);
+   slot.Done   = 0;
+
+   file.NextOffset += slot.Size;
+
+   Start(File, Slot);
+}
+
+// Queues a read of the part of the slot's range not read yet
+void C_asyncReader::Start(u32 File, u32 Slot)
+{
+   if (m_Backend == READ_BACKEND_THREADS)
+   {
+      m_Requests.push_back({ File, Slot });
+      m_Work.notify_one();
+      return;
+   }
+
+   TFile&        file  = *m_Files[File];
+   TSlot&        slot  = file.Slots[Slot];
+   u32           tail  = *m_SqTail;
+   u32           index = tail & *m_SqMask;
+   io_uring_sqe* sqe   = (io_uring_sqe*)m_Sqes + index;
+
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode    = IORING_OP_READ;
+   sqe->fd        = file.Fd;
+   sqe->addr      = (u64)(slot.Buffer.get() + slot.Done);
+   sqe->len       = (u32)(slot.Size - slot.Done);
+   sqe->off       = slot.Offset + slot.Done;
+   sqe->user_data = ((u64)File << 32) | Slot;
+
+   m_SqArray[index] = index;
+   __atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+   m_Unsubmitted++;
+}
+
+void C_asyncReader::Complete(u32 File, u32 Slot, s64 Result)
+{
+   TFile& file = *m_Files[File];
+   TSlot& slot = file.Slots[Slot];
+
+   if (Result < 0)
+   {
+      file.Failed = true;
+   }
+   else if (Result == 0)
+   {
+      // The file shrank since it was opened, it ends here
+      slot.Size = slot.Done;
+      file.Size = std::min(file.Size, slot.Offset + slot.Done);
+   }
+   else
+   {
+      slot.Done += (u64)Result;
+
+      if (slot.Done < slot.Size)
+      {
+         Start(File, Slot);
+         return;
+      }
+   }
+
+   memset(slot.Buffer.get() + slot.Done, 0, PADDING);
+   slot.State = SLOT_READY;
+   m_Ready.notify_all();
+}
+
+// Hands the queued reads to the kernel. Called with m_Lock held.
+void C_asyncReader::SubmitQueued()
+{
+   u32 retries = 0;
+
+   while (m_Unsubmitted)
+   {
+      int submitted = UringEnter(m_Ring, m_Unsubmitted, 0, 0);
+
+      if (submitted > 0)
+      {
+         m_Unsubmitted -= std::min<u32>((u32)submitted, m_Unsubmitted);
+         return;
+      }
+
+      int error = (submitted == 0) ? EAGAIN : errno;
+
+      if (error == EINTR)
+         continue;
+
+      // The kernel is short of memory or of completion queue room, both
+      // come back as reads complete, so one is waited for before a retry
+      if ((error != EAGAIN && error != EBUSY) || retries++ == SUBMIT_RETRIES)
+      {
+         FailQueued(error);
+         return;
+      }
+
+      u32 pending = 0;
+
+      for (const std::unique_ptr<TFile>& file : m_Files)
+         for (const TSlot& slot : file->Slots)
+            pending += (slot.State == SLOT_PENDING) ? 1 : 0;
+
+      // Reads queued but not submitted are pending too, waiting needs more
+      if (pending > m_Unsubmitted)
+         while (UringEnter(m_Ring, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno == EINTR)
+            ;
+   }
+}
+
+// Takes back the reads the kernel did not accept and fails their files,
+// so Next() stops instead of waiting for them. Called with m_Lock held.
+void C_asyncReader::FailQueued(int Error)
+{
+   u32 head = __atomic_load_n(m_SqHead, __ATOMIC_ACQUIRE);
+   u32 tail = *m_SqTail;
+
+   // Without SQPOLL the kernel only reads the queue in io_uring_enter,
+   // under the lock, the tail may go back to the head
+   __atomic_store_n(m_SqTail, head, __ATOMIC_RELEASE);
+   m_Unsubmitted = 0;
+
+   for (u32 at = head; at != tail; at++)
+   {
+      const io_uring_sqe& sqe = ((const io_uring_sqe*)m_Sqes)[m_SqArray[at & *m_SqMask]];
+
+      Complete((u32)(sqe.user_data >> 32), (u32)sqe.user_data, -Error);
+   }
+}
+
+// Submits queued reads and handles the completions already posted.
+// Called with m_Lock held.
+void C_asyncReader::Reap()
+{
+   if (m_Unsubmitted)
+      SubmitQueued();
+
+   // The blocked caller waits for completions to show up in the queue,
+   // taking them here could leave it waiting for reads that never come
+   if (m_Reaping)
+      return;
+
+   u32 head = *m_CqHead;
+
+   while (head != __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE))
+   {
+      const io_uring_cqe& cqe = ((const io_uring_cqe*)m_Cqes)[head & *m_CqMask];
+
+      head++;
+      __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+
+      Complete((u32)(cqe.user_data >> 32), (u32)cqe.user_data, cqe.res);
+   }
+}
+
+// Waits until some read completes, called with m_Lock held by Lock. One
+// caller at a time blocks in the ring, without the lock so the others can
+// still hand out and release chunks, the rest wait for it to post.
+void C_asyncReader::Wait(std::unique_lock<std::mutex>& Lock)
+{
+   if (m_Backend == READ_BACKEND_THREADS || m_Reaping)
+   {
+      m_Ready.wait(Lock);
+      return;
+   }
+
+   // Queued reads go in first, the caller looks again before blocking
+   if (m_Unsubmitted)
+   {
+      Reap();
+      return;
+   }
+
+   m_Reaping = true;
+   Lock.unlock();
+
+   // Only reaps, the submission queue is left to the lock holders
+   UringEnter(m_Ring, 0, 1, IORING_ENTER_GETEVENTS);
+
+   Lock.lock();
+   m_Reaping = false;
+
+   Reap();
+   m_Ready.notify_all();
+}
+
+void C_asyncReader::ReadMain()
+{
+   std::unique_lock<std::mutex> lock(m_Lock);
+
+   for (;;)
+   {
+      m_Work.wait(lock, [&] { return m_Stop || !m_Requests.empty(); });
+
+      if (m_Stop)
+         return;
+
+      TRequest request = m_Requests.front();
+      m_Requests.pop_front();
+
+      TFile& file = *m_Files[request.File];
+      TSlot& slot = file.Slots[request.Slot];
+      int    fd   = file.Fd;
+      u8*    dest = slot.Buffer.get() + slot.Done;
+      u64    size = slot.Size - slot.Done;
+      u64    at   = slot.Offset + slot.Done;
+
+      lock.unlock();
+
+      ssize_t got;
+      do
+         got = pread(fd, dest, size, (off_t)at);
+      while (got < 0 && errno == EINTR);
+
+      lock.lock();
+      Complete(request.File, request.Slot, (got < 0) ? -errno : got);
+   }
+}
+
+bool C_asyncReader::Next(u32 File, TAsyncChunk& Chunk)
+{
+   std::unique_lock<std::mutex> lock(m_Lock);
+   TFile&                       file = *m_Files[File];
+
+   for (;;)
+   {
+      if (file.Failed || file.Fd < 0 || file.Head >= file.Size)
+         return false;
+
+      // The slot holding the next range, found by offset so releases may
+      // come in any order
+      TSlot* next  = nullptr;
+      u32    index = 0;
+
+      for (u32 s = 0; s < file.Slots.size(); s++)
+      {
+         if ((file.Slots[s].State == SLOT_PENDING || file.Slots[s].State == SLOT_READY) && file.Slots[s].Offset == file.Head)
+         {
+            next  = &file.Slots[s];
+            index = s;
+         }
+      }
+
+      // Every buffer is handed out, nothing can arrive
+      if (!next)
+         return false;
+
+      if (next->State == SLOT_READY)
+      {
+         if (next->Size == 0)
+            return false;
+
+         next->State  = SLOT_HANDED_OUT;
+         file.Head   += next->Size;
+
+         Chunk.Data   = next->Buffer.get();
+         Chunk.Offset = next->Offset;
+         Chunk.Size   = next->Size;
+         Chunk.Slot   = index;
+         return true;
+      }
+
+      Wait(lock);
+   }
+}
+
+void C_asyncReader::Release(u32 File, const TAsyncChunk& Chunk)
+{
+   std::unique_lock<std::mutex> lock(m_Lock);
+   TFile&                       file = *m_Files[File];
+
+   if (file.Fd < 0)
+      return;
+
+   file.Slots[Chunk.Slot].State = SLOT_IDLE;
+
+   if (!file.Failed && file.NextOffset < file.Size)
+   {
+      Submit(File, Chunk.Slot);
+
+      if (m_Backend == READ_BACKEND_URING)
+         Reap();
+   }
+}
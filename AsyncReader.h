@@ -0,0 +1,155 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommonTypes.h"
+
+enum EReadBackend
+{
+   READ_BACKEND_URING,   // io_uring, submitted and reaped by the callers
+   READ_BACKEND_THREADS  // pread on a small pool of blocking readers
+};
+
+// One chunk of a file, valid until it is released. PADDING zero bytes
+// follow the data.
+struct TAsyncChunk
+{
+   const u8* Data;
+   u64       Offset; // in the file
+   u64       Size;
+   u32       Slot;
+};
+
+// Reads many files ahead of their consumers. Every open file keeps up to
+// QueueDepth chunk reads in flight, chunks are handed out in file order and
+// each release starts the next read into the freed buffer. io_uring is used
+// where the kernel has it (5.7 or later), otherwise a pool of threads does
+// blocking preads. Next() and Release() may be called from any thread.
+class C_asyncReader
+{
+public:
+
+   static constexpr u64 PADDING        = 64;
+   static constexpr u32 RING_ENTRIES   = 256; // reads in flight over all files
+   static constexpr u32 READ_THREADS   = 4;   // blocking readers of the fallback
+   static constexpr u32 SUBMIT_RETRIES = 4;   // of reads the kernel had no room for
+
+   //! Constructor C_asyncReader(u32 QueueDepth, u64 ChunkSize, EReadBackend Backend)
+   //! \details Falls back to READ_BACKEND_THREADS if an io_uring cannot be set up.
+   C_asyncReader(u32 QueueDepth = 4, u64 ChunkSize = 4 << 20, EReadBackend Backend = READ_BACKEND_URING);
+   ~C_asyncReader();
+
+   //! EReadBackend Backend()
+   //! \return The backend actually in use.
+   EReadBackend Backend() const { return m_Backend; }
+
+   //! s32 Open(const char* Filename)
+   //! \details Opens the file and starts its first reads.
+   //! \return The file handle, -1 if the file cannot be opened or every
+   //!         ring entry is taken by open files.
+   s32 Open(const char* Filename);
+
+   //! void Close(u32 File)
+   //! \details Waits for the file's reads in flight and frees its buffers.
+   void Close(u32 File);
+
+   //! u64 Size(u32 File)
+   u64 Size(u32 File) const { return m_Files[File]->Size; }
+
+   //! bool Next(u32 File, TAsyncChunk& Chunk)
+   //! \details Waits for the next chunk of the file.
+   //! \return false at the end of the file or after a read error.
+   bool Next(u32 File, TAsyncChunk& Chunk);
+
+   //! void Release(u32 File, const TAsyncChunk& Chunk)
+   //! \details Gives the chunk's buffer back for the next read.
+   void Release(u32 File, const TAsyncChunk& Chunk);
+
+   //! bool Failed(u32 File)
+   //! \return true if a read of the file failed.
+   bool Failed(u32 File) const { return m_Files[File]->Failed; }
+
+private:
+
+   enum ESlotState
+   {
+      SLOT_IDLE,
+      SLOT_PENDING,
+      SLOT_READY,
+      SLOT_HANDED_OUT
+   };
+
+   struct TSlot
+   {
+      std::unique_ptr<u8[]> Buffer;
+      ESlotState            State;
+      u64                   Offset;
+      u64                   Size; // bytes wanted
+      u64                   Done; // bytes read so far
+   };
+
+   struct TFile
+   {
+      int                Fd;
+      u64                Size;
+      u64                NextOffset; // of the next read to start
+      u64                Head;       // chunks handed out
+      bool               Failed;
+      std::vector<TSlot> Slots;
+   };
+
+   struct TRequest
+   {
+      u32 File;
+      u32 Slot;
+   };
+
+   bool SetupRing();
+   void Submit(u32 File, u32 Slot);
+   void Start(u32 File, u32 Slot);
+   void Complete(u32 File, u32 Slot, s64 Result);
+   void SubmitQueued();
+   void FailQueued(int Error);
+   void Reap();
+   void Wait(std::unique_lock<std::mutex>& Lock);
+   void ReadMain();
+
+   u32                                 m_QueueDepth;
+   u64                                 m_ChunkSize;
+   EReadBackend                        m_Backend;
+   u32                                 m_InFlight;  // slots of open files
+   std::vector<std::unique_ptr<TFile>> m_Files;
+
+   std::mutex                          m_Lock;
+   std::condition_variable             m_Ready;
+
+   // io_uring
+   int                                 m_Ring;
+   void*                               m_SqMap;
+   void*                               m_CqMap;
+   void*                               m_SqeMap;
+   u64                                 m_SqMapSize;
+   u64                                 m_CqMapSize;
+   u64                                 m_SqeMapSize;
+   u32*                                m_SqHead;
+   u32*                                m_SqTail;
+   u32*                                m_SqMask;
+   u32*                                m_SqArray;
+   u32*                                m_CqHead;
+   u32*                                m_CqTail;
+   u32*                                m_CqMask;
+   void*                               m_Cqes;
+   void*                               m_Sqes;
+   u32                                 m_Unsubmitted;
+   bool                                m_Reaping;   // a caller is blocked in the ring
+
+   // Thread fallback
+   std::deque<TRequest>                m_Requests;
+   std::condition_variable             m_Work;
+   std::vector<std::thread>            m_Readers;
+   bool                                m_Stop;
+};
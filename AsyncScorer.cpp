@@ -0,0 +1,100 @@
+
+#include <algorithm>
+#include "AsyncScorer.h"
+
+C_asyncScorer::C_asyncScorer(const C_scene& Scene, C_batchEngine& Engine, f64 MaxDistance, u32 LingerMicroseconds)
+   : m_Scene(Scene),
+     m_Engine(Engine),
+     m_MaxDistance(MaxDistance),
+     m_Linger(std::chrono::microseconds(LingerMicroseconds)),
+     m_Stop(false),
+     m_Batches(0),
+     m_Queries(0)
+{
+   m_Dispatcher = std::thread(&C_asyncScorer::DispatcherMain, this);
+}
+
+C_asyncScorer::~C_asyncScorer()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      m_Stop = true;
+   }
+
+   m_Wake.notify_one();
+   m_Dispatcher.join();
+}
+
+void C_asyncScorer::Enqueue(TAwaitable* Awaiter, std::coroutine_handle<> Handle)
+{
+   bool wake;
+
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+
+      if (m_Pending.empty())
+         m_Oldest = clock::now();
+
+      m_Pending.push_back({ Awaiter, Handle });
+
+      // The dispatcher only needs waking for the first submission and
+      // when a full batch is ready
+      wake = m_Pending.size() == 1 || m_Pending.size() == MAX_BATCH;
+   }
+
+   if (wake)
+      m_Wake.notify_one();
+}
+
+void C_asyncScorer::DispatcherMain()
+{
+   std::vector<TPending>    batch;
+   std::vector<TShot>       shots;
+   std::vector<TShotResult> results;
+
+   std::unique_lock<std::mutex> lock(m_Lock);
+
+   for (;;)
+   {
+      m_Wake.wait(lock, [&] { return m_Stop || !m_Pending.empty(); });
+
+      if (m_Pending.empty())
+         return;
+
+      // Linger for a full batch unless stopping
+      if (!m_Stop && m_Pending.size() < MAX_BATCH)
+         m_Wake.wait_until(lock, m_Oldest + m_Linger, [&] { return m_Stop || m_Pending.size() >= MAX_BATCH; });
+
+      // Whole lanes where possible, the remainder waits for the next batch
+      // unless it is all there is
+      u32 count = (u32)std::min<size_t>(m_Pending.size(), MAX_BATCH);
+      if (count > BATCH_LANES)
+         count -= count % BATCH_LANES;
+
+      batch.assign(m_Pending.begin(), m_Pending.begin() + count);
+      m_Pending.erase(m_Pending.begin(), m_Pending.begin() + count);
+      if (!m_Pending.empty())
+         m_Oldest = clock::now();
+
+      lock.unlock();
+
+      shots.resize(count);
+      results.resize(count);
+      for (u32 i = 0; i < count; i++)
+         shots[i] = batch[i].Awaiter->m_Shot;
+
+      m_Engine.Score(m_Scene, shots.data(), count, results.data(), m_MaxDistance);
+
+      // Resuming may destroy the awaiter (and submit more work), so the
+      // result is stored first and nothing touches the entry afterwards
+      for (u32 i = 0; i < count; i++)
+      {
+         batch[i].Awaiter->m_Result = results[i];
+         batch[i].Handle.resume();
+      }
+
+      m_Batches.fetch_add(1, std::memory_order_relaxed);
+      m_Queries.fetch_add(count, std::memory_order_relaxed);
+      lock.lock();
+   }
+}
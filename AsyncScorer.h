@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommonTypes.h"
+#include "BatchEngine.h"
+
+// Coroutine front end to C_batchEngine. Callers co_await Score() instead of
+// blocking a thread per request. Submissions made while a batch is running
+// or within the linger window are coalesced and scored as one batch by a
+// dispatcher thread, which then resumes every waiting coroutine.
+class C_asyncScorer
+{
+public:
+
+   static constexpr u32 BATCH_LANES = 8;    // batches are cut in multiples of this
+   static constexpr u32 MAX_BATCH   = 1024;
+
+   class TAwaitable
+   {
+   public:
+
+      bool        await_ready() const { return false; }
+      void        await_suspend(std::coroutine_handle<> Handle) { m_Owner->Enqueue(this, Handle); }
+      TShotResult await_resume() const { return m_Result; }
+
+   private:
+
+      friend class C_asyncScorer;
+
+      TAwaitable(C_asyncScorer* Owner, const TShot& Shot) : m_Owner(Owner), m_Shot(Shot), m_Result() {}
+
+      C_asyncScorer* m_Owner;
+      TShot          m_Shot;
+      TShotResult    m_Result;
+   };
+
+   //! Constructor C_asyncScorer(const C_scene& Scene, C_batchEngine& Engine, f64 MaxDistance, u32 LingerMicroseconds)
+   //! \details Starts the dispatcher. Scene and Engine must outlive the
+   //!          scorer and the engine must not be used by anyone else.
+   //! \param[in] LingerMicroseconds How long a partial batch waits for more
+   //!            submissions before it is scored anyway.
+   C_asyncScorer(const C_scene& Scene, C_batchEngine& Engine, f64 MaxDistance, u32 LingerMicroseconds = 50);
+
+   //! Destructor
+   //! \details Scores and resumes whatever is still queued, then stops.
+   ~C_asyncScorer();
+
+   //! TAwaitable Score(const TShot& Shot)
+   //! \details co_await the result to have the shot scored as part of the
+   //!          next batch. The coroutine is resumed on the dispatcher thread.
+   TAwaitable Score(const TShot& Shot) { return TAwaitable(this, Shot); }
+
+   //! u64 Batches()
+   //! \return The number of batches scored so far.
+   u64 Batches() const { return m_Batches.load(std::memory_order_relaxed); }
+
+   //! u64 Queries()
+   //! \return The number of shots scored so far.
+   u64 Queries() const { return m_Queries.load(std::memory_order_relaxed); }
+
+private:
+
+   typedef std::chrono::steady_clock clock;
+
+   struct TPending
+   {
+      TAwaitable*             Awaiter;
+      std::coroutine_handle<> Handle;
+   };
+
+   void Enqueue(TAwaitable* Awaiter, std::coroutine_handle<> Handle);
+   void DispatcherMain();
+
+   const C_scene&           m_Scene;
+   C_batchEngine&           m_Engine;
+   f64                      m_MaxDistance;
+   clock::duration          m_Linger;
+
+   std::mutex               m_Lock;
+   std::condition_variable  m_Wake;
+   std::vector<TPending>    m_Pending;
+   clock::time_point        m_Oldest; // submission time of m_Pending[0]
+   bool                     m_Stop;
+   std::atomic<u64>         m_Batches;
+   std::atomic<u64>         m_Queries;
+   std::thread              m_Dispatcher;
+};
@@ -0,0 +1,235 @@
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "BatchEngine.h"
+
+void TCompensatedSum::Add(f64 Value)
+{
+   f64 t = Sum + Value;
+
+   if (fabs(Sum) >= fabs(Value))
+      Comp += (Sum - t) + Value;
+   else
+      Comp += (Value - t) + Sum;
+
+   Sum = t;
+}
+
+void TCompensatedSum::Add(const TCompensatedSum& Other)
+{
+   Add(Other.Sum);
+   Add(Other.Comp);
+}
+
+// Inserts into a list sorted by (distance, shot), dropping the largest
+static void InsertClosest(TScoreSummary& Summary, const TClosestApproach& Approach)
+{
+   u32 n = Summary.ClosestCount;
+   u32 i = n;
+
+   while (i > 0 && (Summary.Closest[i - 1].Distance > Approach.Distance ||
+                    (Summary.Closest[i - 1].Distance == Approach.Distance && Summary.Closest[i - 1].Shot > Approach.Shot)))
+      i--;
+
+   if (i >= TScoreSummary::CLOSEST)
+      return;
+
+   if (n == TScoreSummary::CLOSEST)
+      n--;
+
+   memmove(&Summary.Closest[i + 1], &Summary.Closest[i], (n - i) * sizeof(TClosestApproach));
+   Summary.Closest[i]   = Approach;
+   Summary.ClosestCount = n + 1;
+}
+
+// Spreads the low 21 bits of V to every third bit
+static u64 MortonSpread(u64 V)
+{
+   V &= 0x1fffff;
+   V = (V | (V << 32)) & 0x001f00000000ffffULL;
+   V = (V | (V << 16)) & 0x001f0000ff0000ffULL;
+   V = (V | (V << 8))  & 0x100f00f00f00f00fULL;
+   V = (V | (V << 4))  & 0x10c30c30c30c30c3ULL;
+   V = (V | (V << 2))  & 0x1249249249249249ULL;
+   return V;
+}
+
+C_batchEngine::C_batchEngine(u32 Threads)
+   : m_Pool(Threads),
+     m_Grain(DEFAULT_GRAIN),
+     m_SpatialSort(false)
+{
+}
+
+void C_batchEngine::SortShots(const TShot* Shots, u32 Count)
+{
+   f64 min[3];
+   f64 max[3];
+   f64 scale[3];
+
+   for (int k = 0; k < 3; k++)
+   {
+      min[k] =  DBL_MAX;
+      max[k] = -DBL_MAX;
+   }
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      for (int k = 0; k < 3; k++)
+      {
+         min[k] = std::min(min[k], Shots[i].Position.data[k]);
+         max[k] = std::max(max[k], Shots[i].Position.data[k]);
+      }
+   }
+
+   // Quantize the batch bounds to 21 bits per axis
+   for (int k = 0; k < 3; k++)
+      scale[k] = (max[k] > min[k]) ? 2097151.0 / (max[k] - min[k]) : 0.0;
+
+   m_Keys.resize(Count);
+   m_KeysTemp.resize(Count);
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      const f64* p = Shots[i].Position.data;
+
+      m_Keys[i].Code  = MortonSpread((u64)((p[0] - min[0]) * scale[0]))      |
+                        MortonSpread((u64)((p[1] - min[1]) * scale[1])) << 1 |
+                        MortonSpread((u64)((p[2] - min[2]) * scale[2])) << 2;
+      m_Keys[i].Index = i;
+   }
+
+   // LSD radix sort on 11 bit digits, stable so equal codes keep shot order
+   const u32 bits    = 11;
+   const u32 buckets = 1u << bits;
+   std::vector<u32> offsets(buckets);
+
+   for (u32 shift = 0; shift < 63; shift += bits)
+   {
+      std::fill(offsets.begin(), offsets.end(), 0);
+
+      for (u32 i = 0; i < Count; i++)
+         offsets[(m_Keys[i].Code >> shift) & (buckets - 1)]++;
+
+      u32 sum = 0;
+      for (u32 b = 0; b < buckets; b++)
+      {
+         u32 n = offsets[b];
+         offsets[b] = sum;
+         sum += n;
+      }
+
+      for (u32 i = 0; i < Count; i++)
+         m_KeysTemp[offsets[(m_Keys[i].Code >> shift) & (buckets - 1)]++] = m_Keys[i];
+
+      m_Keys.swap(m_KeysTemp);
+   }
+}
+
+void C_batchEngine::ScoreOne(const C_scene& Scene, const TShot& Shot, TShotResult& Result, f64 MaxDistance)
+{
+   TRangeHit nearest;
+
+   if (!Scene.Nearest(Shot.Position, MaxDistance + Shot.Radius, nearest))
+   {
+      Result.Entity       = -1;
+      Result.Hit          = 0;
+      Result.MissDistance = MaxDistance;
+      Result.Point        = Shot.Position;
+      return;
+   }
+
+   Result.Entity       = nearest.Entity;
+   Result.Hit          = (nearest.Distance <= Shot.Radius) ? 1 : 0;
+   Result.MissDistance = Result.Hit ? 0.0 : nearest.Distance - Shot.Radius;
+   Result.Point        = nearest.Point;
+}
+
+void C_batchEngine::Score(const C_scene& Scene, const TShot* Shots, u32 Count, TShotResult* Results, f64 MaxDistance)
+{
+   if (!m_SpatialSort)
+   {
+      m_Pool.ParallelFor(Count, m_Grain, [&](u32 Begin, u32 End, u32)
+      {
+         for (u32 i = Begin; i < End; i++)
+            ScoreOne(Scene, Shots[i], Results[i], MaxDistance);
+      });
+      return;
+   }
+
+   SortShots(Shots, Count);
+
+   m_SortedShots.resize(Count);
+   m_SortedResults.resize(Count);
+
+   // Gather, score in Morton order, scatter back to the caller's slots
+   m_Pool.ParallelFor(Count, m_Grain, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 i = Begin; i < End; i++)
+         m_SortedShots[i] = Shots[m_Keys[i].Index];
+
+      for (u32 i = Begin; i < End; i++)
+         ScoreOne(Scene, m_SortedShots[i], m_SortedResults[i], MaxDistance);
+
+      for (u32 i = Begin; i < End; i++)
+         Results[m_Keys[i].Index] = m_SortedResults[i];
+   });
+}
+
+void C_batchEngine::Summarize(const TShotResult* Results, u32 Count, TScoreSummary& Summary)
+{
+   u32                        chunks = (Count + SUMMARY_CHUNK - 1) / SUMMARY_CHUNK;
+   std::vector<TScoreSummary> partials(chunks);
+
+   memset(partials.data(), 0, chunks * sizeof(TScoreSummary));
+
+   // One chunk per pool task, the pool grain only schedules whole chunks
+   m_Pool.ParallelFor(chunks, 1, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 c = Begin; c < End; c++)
+      {
+         TScoreSummary& partial = partials[c];
+         u32            last    = (c + 1 < chunks) ? (c + 1) * SUMMARY_CHUNK : Count;
+
+         for (u32 i = c * SUMMARY_CHUNK; i < last; i++)
+         {
+            const TShotResult& result = Results[i];
+
+            partial.Shots++;
+
+            if (result.Entity < 0)
+               continue;
+
+            partial.Scored++;
+
+            if (result.Hit)
+               partial.Hits++;
+            else
+               partial.MissSum.Add(result.MissDistance);
+
+            InsertClosest(partial, { i, result.Entity, result.MissDistance });
+         }
+      }
+   });
+
+   memset(&Summary, 0, sizeof(Summary));
+
+   for (u32 c = 0; c < chunks; c++)
+   {
+      const TScoreSummary& partial = partials[c];
+
+      Summary.Shots  += partial.Shots;
+      Summary.Scored += partial.Scored;
+      Summary.Hits   += partial.Hits;
+      Summary.MissSum.Add(partial.MissSum);
+
+      for (u32 i = 0; i < partial.ClosestCount; i++)
+         InsertClosest(Summary, partial.Closest[i]);
+   }
+
+   u64 misses = Summary.Scored - Summary.Hits;
+   Summary.MeanMissDistance = misses ? Summary.MissSum.Value() / (f64)misses : 0.0;
+}
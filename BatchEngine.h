@@ -0,0 +1,115 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+struct TShot
+{
+   u32      Id;
+   C_vector Position; // round position
+   f64      Radius;   // round (or lethal) radius
+};
+
+struct TShotResult
+{
+   s32      Entity;       // scene index of the closest cuboid, -1 if none within range
+   s32      Hit;          // 1 if the round touches the cuboid
+   f64      MissDistance; // distance from the round's edge to the cuboid, 0.0 on a hit
+   C_vector Point;        // closest point on the cuboid
+};
+
+// Neumaier compensated sum, the low order bits lost by Sum are kept in Comp
+struct TCompensatedSum
+{
+   f64 Sum;
+   f64 Comp;
+
+   void Add(f64 Value);
+   void Add(const TCompensatedSum& Other);
+   f64  Value() const { return Sum + Comp; }
+};
+
+struct TClosestApproach
+{
+   u32 Shot;     // index into the scored batch
+   s32 Entity;   // scene index
+   f64 Distance; // miss distance, 0.0 for hits
+};
+
+struct TScoreSummary
+{
+   static constexpr u32 CLOSEST = 16;
+
+   u64              Shots;
+   u64              Scored;           // shots with a cuboid in range
+   u64              Hits;
+   TCompensatedSum  MissSum;          // over scored misses
+   f64              MeanMissDistance; // over scored misses
+   u32              ClosestCount;
+   TClosestApproach Closest[CLOSEST]; // smallest distances, ties by shot index
+};
+
+class C_batchEngine
+{
+public:
+
+   static constexpr u32 DEFAULT_GRAIN = 256;
+   static constexpr u32 SUMMARY_CHUNK = 4096;
+
+   C_threadPool m_Pool;
+   u32          m_Grain;       // shots per chunk handed to the pool
+   bool         m_SpatialSort; // score in Morton order of the shot positions
+
+   //! Constructor C_batchEngine(u32 Threads)
+   //! \details Threads 0 uses every core.
+   C_batchEngine(u32 Threads = 0);
+
+   //! u32 Threads()
+   //! \return The number of threads scoring, including the caller.
+   u32 Threads() const { return m_Pool.Threads(); }
+
+   //! void Score(const C_scene& Scene, const TShot* Shots, u32 Count, TShotResult* Results, f64 MaxDistance)
+   //! \details Scores every shot against the closest cuboid of the scene.
+   //!          The shots are cut into chunks of m_Grain and run on the work
+   //!          stealing pool, each result is written to the slot with the
+   //!          shot's index so no locking or merging is needed.
+   //!          With m_SpatialSort set the shots are first gathered in Morton
+   //!          order of their positions, so consecutive queries walk the same
+   //!          BVH nodes and cuboids, and the results are scattered back to
+   //!          the original order afterwards.
+   //! \param[out] Results Preallocated, Count entries.
+   //! \param[in] MaxDistance Cuboids farther than this from the round's edge
+   //!            are not considered (Entity -1).
+   void Score(const C_scene& Scene, const TShot* Shots, u32 Count, TShotResult* Results, f64 MaxDistance);
+
+   //! void Summarize(const TShotResult* Results, u32 Count, TScoreSummary& Summary)
+   //! \details Reduces a scored batch to hit counts, mean miss distance and
+   //!          the closest approaches. The results are cut into fixed
+   //!          SUMMARY_CHUNK chunks whatever the thread count, each chunk is
+   //!          reduced on its own and the partials are merged in chunk order
+   //!          with compensated sums, so the summary is bit-identical for
+   //!          any number of threads.
+   void Summarize(const TShotResult* Results, u32 Count, TScoreSummary& Summary);
+
+   //! void ScoreOne(const C_scene& Scene, const TShot& Shot, TShotResult& Result, f64 MaxDistance)
+   //! \details Scores a single shot on the calling thread.
+   static void ScoreOne(const C_scene& Scene, const TShot& Shot, TShotResult& Result, f64 MaxDistance);
+
+private:
+
+   struct TMortonKey
+   {
+      u64 Code;
+      u32 Index;
+   };
+
+   void SortShots(const TShot* Shots, u32 Count);
+
+   // Reused between batches
+   std::vector<TMortonKey>  m_Keys;
+   std::vector<TMortonKey>  m_KeysTemp;
+   std::vector<TShot>       m_SortedShots;
+   std::vector<TShotResult> m_SortedResults;
+};
@@ -0,0 +1,250 @@
+
+#include <math.h>
+#include <string.h>
+#include "BlockCodec.h"
+
+static const f64 g_CodecPow10[10] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+static inline u64 ZigZag(u64 Delta)
+{
+   return (Delta << 1) ^ (u64)((s64)Delta >> 63);
+}
+
+static inline u64 UnZigZag(u64 Value)
+{
+   return (Value >> 1) ^ (0 - (Value & 1));
+}
+
+// Appends the zigzag varints of the deltas between Values, each widened to
+// 64 bits by ToU64. Deltas wrap, decoding wraps them back.
+template <typename T, typename Widen>
+static void EncodeDeltas(const T* Values, u64 Count, Widen ToU64, std::vector<u8>& Out)
+{
+   u64 start = Out.size();
+   u64 prev  = 0;
+
+   Out.resize(start + Count * 10);
+
+   u8* p = Out.data() + start;
+
+   for (u64 i = 0; i < Count; i++)
+   {
+      u64 value = ToU64(Values[i]);
+      u64 v     = ZigZag(value - prev);
+
+      prev = value;
+
+      while (v >= 0x80)
+      {
+         *p++ = (u8)v | 0x80;
+         v  >>= 7;
+      }
+      *p++ = (u8)v;
+   }
+
+   Out.resize(p - Out.data());
+}
+
+// Decodes Count zigzag varints, each added to the running value and handed
+// to Put(Index, Value). Runs of eight one byte varints, the deltas of
+// constant or slowly changing columns, are taken a word at a time.
+template <typename Store>
+static bool DecodeDeltas(const u8* P, const u8* End, u64 Count, Store Put)
+{
+   u64 value = 0;
+   u64 i     = 0;
+
+   while (i < Count)
+   {
+      if (Count - i >= 8 && End - P >= 8)
+      {
+         u64 word;
+
+         memcpy(&word, P, sizeof(word));
+
+         if ((word & 0x8080808080808080ULL) == 0)
+         {
+            for (u32 b = 0; b < 8; b++)
+            {
+               value += UnZigZag((word >> (8 * b)) & 0xFF);
+               Put(i + b, value);
+            }
+
+            P += 8;
+            i += 8;
+            continue;
+         }
+      }
+
+      u64 v     = 0;
+      u32 shift = 0;
+
+      for (;;)
+      {
+         if (P == End || shift > 63)
+            return false;
+
+         u8 byte = *P++;
+
+         v |= (u64)(byte & 0x7F) << shift;
+
+         if (!(byte & 0x80))
+            break;
+
+         shift += 7;
+      }
+
+      value += UnZigZag(v);
+      Put(i++, value);
+   }
+
+   return P == End;
+}
+
+template <typename T, typename Widen>
+static void EncodeInteger(const T* Values, u64 Count, Widen ToU64, std::vector<u8>& Out, TCodecColumn& Column)
+{
+   u64 start = Out.size();
+
+   EncodeDeltas(Values, Count, ToU64, Out);
+
+   Column.Mode   = CODEC_DELTA;
+   Column.Digits = 0;
+   Column.Bytes  = Out.size() - start;
+
+   if (Column.Bytes > Count * sizeof(T))
+   {
+      Out.resize(start);
+      Out.insert(Out.end(), (const u8*)Values, (const u8*)(Values + Count));
+
+      Column.Mode  = CODEC_RAW;
+      Column.Bytes = Count * sizeof(T);
+   }
+}
+
+template <typename T>
+static bool DecodeInteger(const TCodecColumn& Column, const u8* Data, u64 Count, T* Values)
+{
+   if (Column.Mode == CODEC_RAW)
+   {
+      if (Column.Bytes != Count * sizeof(T))
+         return false;
+
+      memcpy(Values, Data, Column.Bytes);
+      return true;
+   }
+
+   if (Column.Mode != CODEC_DELTA)
+      return false;
+
+   return DecodeDeltas(Data, Data + Column.Bytes, Count, [Values](u64 Index, u64 Value) { Values[Index] = (T)Value; });
+}
+
+void EncodeColumn(const u64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+{
+   EncodeInteger(Values, Count, [](u64 Value) { return Value; }, Out, Column);
+}
+
+void EncodeColumn(const u32* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+{
+   EncodeInteger(Values, Count, [](u32 Value) { return (u64)Value; }, Out, Column);
+}
+
+void EncodeColumn(const s32* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+{
+   EncodeInteger(Values, Count, [](s32 Value) { return (u64)(s64)Value; }, Out, Column);
+}
+
+// The fewest decimal digits that give back every value bit for bit, -1 if
+// none up to 9 do
+static s32 QuantizeDigits(const f64* Values, u64 Count)
+{
+   for (u32 digits = 0; digits < 10; digits++)
+   {
+      f64 scale = g_CodecPow10[digits];
+      u64 i     = 0;
+
+      for (; i < Count; i++)
+      {
+         f64 scaled = Values[i] * scale;
+
+         if (!(fabs(scaled) < 9007199254740992.0)) // 2^53, also rejects NaN
+            break;
+
+         f64 back = (f64)llround(scaled) / scale;
+
+         // Bitwise, so -0.0 stays raw
+         if (memcmp(&back, &Values[i], sizeof(f64)) != 0)
+            break;
+      }
+
+      if (i == Count)
+         return (s32)digits;
+   }
+
+   return -1;
+}
+
+void EncodeColumn(const f64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+{
+   s32 digits = QuantizeDigits(Values, Count);
+   u64 start  = Out.size();
+
+   if (digits >= 0)
+   {
+      f64 scale = g_CodecPow10[digits];
+
+      EncodeDeltas(Values, Count, [scale](f64 Value) { return (u64)llround(Value * scale); }, Out);
+
+      Column.Mode   = CODEC_QUANTIZED;
+      Column.Digits = (u32)digits;
+      Column.Bytes  = Out.size() - start;
+
+      if (Column.Bytes <= Count * sizeof(f64))
+         return;
+
+      Out.resize(start);
+   }
+
+   Out.insert(Out.end(), (const u8*)Values, (const u8*)(Values + Count));
+
+   Column.Mode   = CODEC_RAW;
+   Column.Digits = 0;
+   Column.Bytes  = Count * sizeof(f64);
+}
+
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, u64* Values)
+{
+   return DecodeInteger(Column, Data, Count, Values);
+}
+
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, u32* Values)
+{
+   return DecodeInteger(Column, Data, Count, Values);
+}
+
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, s32* Values)
+{
+   return DecodeInteger(Column, Data, Count, Values);
+}
+
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, f64* Values)
+{
+   if (Column.Mode == CODEC_RAW)
+   {
+      if (Column.Bytes != Count * sizeof(f64))
+         return false;
+
+      memcpy(Values, Data, Column.Bytes);
+      return true;
+   }
+
+   if (Column.Mode != CODEC_QUANTIZED || Column.Digits > 9)
+      return false;
+
+   f64 scale = g_CodecPow10[Column.Digits];
+
+   // The same division the encoder checked every value with
+   return DecodeDeltas(Data, Data + Column.Bytes, Count,
+                       [Values, scale](u64 Index, u64 Value) { Values[Index] = (f64)(s64)Value / scale; });
+}
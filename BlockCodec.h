@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+
+// Column codec of compressed binary recording blocks. Each column is coded
+// on its own, against the previous row of the same column:
+//
+//   integers  zigzag varint of the delta to the previous value
+//   doubles   quantized to the fewest decimal digits (0 to 9) that give
+//             every value of the column back bit for bit, then coded as
+//             integers. Columns no scale fits are stored raw.
+//
+// Text recordings print fixed decimals, so doubles parsed from them quantize
+// exactly and decoding is lossless. The first delta of a column is against
+// zero, columns and blocks decode independently.
+
+enum ECodecMode
+{
+   CODEC_RAW,       // values as they are
+   CODEC_DELTA,     // zigzag varint deltas of integers
+   CODEC_QUANTIZED  // zigzag varint deltas of doubles times 10^Digits
+};
+
+struct TCodecColumn
+{
+   u32 Mode;        // ECodecMode
+   u32 Digits;      // decimal digits of CODEC_QUANTIZED
+   u64 Bytes;       // of the coded column
+};
+
+//! void EncodeColumn(const u64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+//! \details Delta codes an integer column, with overloads for u32 and s32.
+//! \param[out] Out The coded column is appended.
+//! \param[out] Column Its mode and size.
+void EncodeColumn(const u64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column);
+void EncodeColumn(const u32* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column);
+void EncodeColumn(const s32* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column);
+
+//! void EncodeColumn(const f64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column)
+//! \details Quantizes and delta codes a double column, or stores it raw.
+//! \param[out] Out The coded column is appended.
+//! \param[out] Column Its mode, digits and size.
+void EncodeColumn(const f64* Values, u64 Count, std::vector<u8>& Out, TCodecColumn& Column);
+
+//! bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, u64* Values)
+//! \details Decodes Count values of a column coded by the matching encoder,
+//!          with overloads for u32, s32 and f64.
+//! \return false if the column is damaged, it must end exactly at Bytes.
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, u64* Values);
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, u32* Values);
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, s32* Values);
+bool DecodeColumn(const TCodecColumn& Column, const u8* Data, u64 Count, f64* Values);
@@ -0,0 +1,104 @@
+
+#include <math.h>
+#include <vector>
+#include "Ccd.h"
+
+#define CCD_GRAIN 256
+
+// Distance from the sphere center to the cuboid at fraction T. The point is
+// carried back into the cuboid's start pose, where the scene can measure it.
+static f64 CcdDistance(const C_scene& Scene, const TCcdQuery& Query, f64 T, C_vector& Closest)
+{
+   u32      e     = Query.Entity;
+   C_vector start(Scene.m_Center[0][e], Scene.m_Center[1][e], Scene.m_Center[2][e]);
+   C_vector center = start + (Query.EntityTo - start) * T;
+   C_vector rel    = Query.From + (Query.To - Query.From) * T - center;
+   f64      sn     = sin(Query.Turn * T);
+   f64      cs     = cos(Query.Turn * T);
+
+   // Yaw(a) composes the world to local matrix with Rz(a), so a point of the
+   // turned cuboid maps to the start pose through Rz(a) and back with Rz(-a)
+   C_vector local(cs * rel.x() - sn * rel.y(), sn * rel.x() + cs * rel.y(), rel.z());
+   f64      dist = Scene.PointDistance(e, start + local, Closest);
+
+   Closest -= start;
+   Closest  = center + C_vector(cs * Closest.x() + sn * Closest.y(), -sn * Closest.x() + cs * Closest.y(), Closest.z());
+
+   return dist;
+}
+
+bool CcdQuery(const C_scene& Scene, const TCcdQuery& Query, TCcdHit& Hit)
+{
+   u32      e = Query.Entity;
+   C_vector start(Scene.m_Center[0][e], Scene.m_Center[1][e], Scene.m_Center[2][e]);
+   C_vector motion = (Query.To - Query.From) - (Query.EntityTo - start);
+   f64      spin   = fabs(Query.Turn) * Scene.m_Radius[e];
+
+   Hit.Hit        = 0;
+   Hit.T          = 0.0;
+   Hit.Iterations = 0;
+
+   while (Hit.Iterations < CCD_MAX_ITERATIONS)
+   {
+      f64      dist = CcdDistance(Scene, Query, Hit.T, Hit.Point);
+      f64      gap  = dist - Query.Radius;
+      C_vector normal;
+
+      Hit.Iterations++;
+
+      if (gap <= CCD_TOLERANCE)
+      {
+         Hit.Hit = 1;
+         return true;
+      }
+
+      // The plane through the closest point, facing the sphere, separates
+      // the two until one crosses it. Along its normal the sphere closes at
+      // the relative speed and no point of the cuboid moves faster than the
+      // turn rate times the boundary radius.
+      normal = (Query.From + (Query.To - Query.From) * Hit.T - Hit.Point) * (1.0 / dist);
+
+      f64 closing = spin - motion * normal;
+
+      if (closing <= 0.0 || Hit.T + gap / closing > 1.0)
+      {
+         Hit.T = 1.0;
+         return false;
+      }
+
+      Hit.T += gap / closing;
+   }
+
+   return false;
+}
+
+void CcdQueryBatch(const C_scene& Scene, const TCcdQuery* Queries, u32 Count, TCcdHit* Hits, C_threadPool& Pool, TCcdStats* Stats)
+{
+   std::vector<TCcdStats> stats(Pool.Threads(), TCcdStats());
+
+   Pool.ParallelFor(Count, CCD_GRAIN, [&](u32 Begin, u32 End, u32 Worker)
+   {
+      TCcdStats& s = stats[Worker];
+
+      for (u32 i = Begin; i < End; i++)
+      {
+         bool hit = CcdQuery(Scene, Queries[i], Hits[i]);
+
+         s.Queries++;
+         s.Iterations += Hits[i].Iterations;
+         s.Hits       += hit ? 1 : 0;
+         s.Capped     += (!hit && Hits[i].T < 1.0) ? 1 : 0;
+      }
+   });
+
+   if (Stats)
+   {
+      for (const TCcdStats& s : stats)
+      {
+         Stats->Queries    += s.Queries;
+         Stats->Iterations += s.Iterations;
+         Stats->Hits       += s.Hits;
+         Stats->Capped     += s.Capped;
+      }
+   }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+
+#define CCD_MAX_ITERATIONS 32
+#define CCD_TOLERANCE      1.0e-3 // meters, gap counted as contact
+
+// One step of a sphere (or, with Radius 0, a point sweeping a segment)
+// against one scene cuboid that moves and turns over the same step. The
+// scene holds the cuboid's pose at the start of the step.
+struct TCcdQuery
+{
+   C_vector From;     // sphere center at the start of the step
+   C_vector To;       // sphere center at the end of the step
+   f64      Radius;
+   u32      Entity;   // scene index
+   C_vector EntityTo; // cuboid center at the end of the step
+   f64      Turn;     // heading change over the step, radians as C_cuboid::Yaw
+};
+
+struct TCcdHit
+{
+   s32      Hit;        // 1 if the sphere touches the cuboid during the step
+   f64      T;          // step fraction of first contact, or how far the search got
+   C_vector Point;      // closest point on the cuboid at T
+   u32      Iterations; // advancement steps taken
+};
+
+struct TCcdStats
+{
+   u64 Queries;
+   u64 Iterations;
+   u64 Hits;
+   u64 Capped; // gave up after CCD_MAX_ITERATIONS without deciding
+};
+
+//! bool CcdQuery(const C_scene& Scene, const TCcdQuery& Query, TCcdHit& Hit)
+//! \details Conservative advancement: position and heading are interpolated
+//!          linearly over the step. At the current fraction the exact
+//!          distance, divided by an upper bound of the closing speed along
+//!          the separating direction (relative linear speed plus turn rate
+//!          times the boundary radius), is a step that cannot pass through
+//!          the cuboid. Stops on contact within CCD_TOLERANCE, once the
+//!          step ends, or after CCD_MAX_ITERATIONS, in which case Hit.T is
+//!          still a safe lower bound of the contact time.
+//! \return true if the sphere touches the cuboid during the step.
+bool CcdQuery(const C_scene& Scene, const TCcdQuery& Query, TCcdHit& Hit);
+
+//! void CcdQueryBatch(const C_scene& Scene, const TCcdQuery* Queries, u32 Count, TCcdHit* Hits, C_threadPool& Pool, TCcdStats* Stats)
+//! \details Runs CcdQuery for every query over the pool.
+//! \param[out] Hits One result per query.
+//! \param[in,out] Stats Optional counters, accumulated.
+void CcdQueryBatch(const C_scene& Scene, const TCcdQuery* Queries, u32 Count, TCcdHit* Hits, C_threadPool& Pool, TCcdStats* Stats);
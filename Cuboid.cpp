@@ -4,8 +4,6 @@
 #include <string.h>
 #include "Cuboid.h"
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
 
 #define ZERO 0.0000000001
 #define COLLISION 0.0
@@ -14,6 +12,8 @@
 
 const double PI_OVER_180 = PI / 180;
 
+static thread_local TCollisionStats g_CollisionStats = {};
+
 typedef struct
 {
    C_vector point;
@@ -141,6 +141,8 @@ C_cuboid::C_cuboid( void )
    m_vPosition = C_vector( 0.0 );
    m_pSize[WIDTH] = m_pSize[HEIGHT] = m_pSize[DEPTH] = 1.0;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 C_cuboid::C_cuboid( C_vector &c )
@@ -148,6 +150,8 @@ C_cuboid::C_cuboid( C_vector &c )
    m_vPosition = c;
    m_pSize[WIDTH] = m_pSize[HEIGHT] = m_pSize[DEPTH] = 1.0;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 C_cuboid::C_cuboid( double s )
@@ -155,6 +159,8 @@ C_cuboid::C_cuboid( double s )
    m_vPosition = C_vector( 0.0 );
    m_pSize[WIDTH] = m_pSize[HEIGHT] = m_pSize[DEPTH] = s;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 C_cuboid::C_cuboid( double w, double h, double d )
@@ -164,6 +170,8 @@ C_cuboid::C_cuboid( double w, double h, double d )
    m_pSize[HEIGHT] = h;
    m_pSize[DEPTH]  = d;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 C_cuboid::C_cuboid( C_vector &c, double s )
@@ -171,6 +179,8 @@ C_cuboid::C_cuboid( C_vector &c, double s )
    m_vPosition = c;
    m_pSize[WIDTH] = m_pSize[HEIGHT] = m_pSize[DEPTH] = s;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 C_cuboid::C_cuboid( C_vector c, double w, double h, double d )
@@ -180,6 +190,8 @@ C_cuboid::C_cuboid( C_vector c, double w, double h, double d )
    m_pSize[HEIGHT] = h;
    m_pSize[DEPTH]  = d;
    Identity( m_pOrientation );
+   m_Yaw = 0.0;
+   UpdateBounds();
 }
 
 /******************
@@ -283,22 +295,27 @@ C_cuboid operator +( C_cuboid &c, C_vector &v )
 void C_cuboid::SetHeight( double h )
 {
    m_pSize[HEIGHT] = h;
+   UpdateBounds();
 }
 
 void C_cuboid::SetWidth( double w )
 {
    m_pSize[WIDTH] = w;
+   UpdateBounds();
 }
 
 void C_cuboid::SetDepth( double d )
 {
    m_pSize[DEPTH] = d;
+   UpdateBounds();
 }
 
 void C_cuboid::scale( double s )
 {
    for( int i = 0; i < 3; i++ )
       m_pSize[i] *= s;
+
+   UpdateBounds();
 }
 
 void C_cuboid::operator *=( double s )
@@ -333,6 +350,7 @@ void C_cuboid::Yaw( double z )
    
 
    MatrixMultiply( m_pOrientation, rm );
+   UpdateBounds();
 }
 
 void C_cuboid::Pitch_D( double y )
@@ -352,6 +370,7 @@ void C_cuboid::Pitch( double y )
    rm[2][0] = nsn; rm[2][1] = 0.0; rm[2][2] = csn;
 
    MatrixMultiply( m_pOrientation, rm );
+   UpdateBounds();
 }
 
 void C_cuboid::Roll_D( double x )
@@ -371,6 +390,7 @@ void C_cuboid::Roll( double x )
    rm[2][0] = 0.0; rm[2][1] = sn;  rm[2][2] = csn;
 
    MatrixMultiply( m_pOrientation, rm );
+   UpdateBounds();
 }
 
 void C_cuboid::SetYaw_D( double z ) // Degrees
@@ -410,6 +430,53 @@ void C_cuboid::SetRoll  ( double x ) // Radians
    Roll( x );
 }
 
+void C_cuboid::UpdateBounds( void )
+{
+   int    i;
+   double half[3];
+
+   for( i = 0; i < 3; i++ )
+      half[i] = m_pSize[i] * 0.5;
+
+   m_BoundRadius = sqrt( half[0] * half[0] + half[1] * half[1] + half[2] * half[2] );
+
+   // Row i of the orientation matrix maps world onto local axis i, so the
+   // world extent along axis j collects every local half size through column j
+   for( i = 0; i < 3; i++ )
+      m_pAabbExtent[i] = fabs( m_pOrientation[0][i] ) * half[0] +
+                         fabs( m_pOrientation[1][i] ) * half[1] +
+                         fabs( m_pOrientation[2][i] ) * half[2];
+}
+
+C_vector C_cuboid::LocalToWorld( const C_vector &local ) const
+{
+   // Rows of the orientation matrix are the local axes in world coordinates,
+   // so the transpose rotates back. Rotate about the center, then translate.
+   return m_vPosition + C_vector( m_pOrientation[0][0] * local.x() + m_pOrientation[1][0] * local.y() + m_pOrientation[2][0] * local.z(),
+                                  m_pOrientation[0][1] * local.x() + m_pOrientation[1][1] * local.y() + m_pOrientation[2][1] * local.z(),
+                                  m_pOrientation[0][2] * local.x() + m_pOrientation[1][2] * local.y() + m_pOrientation[2][2] * local.z() );
+}
+
+double C_cuboid::ClosestPoint( const C_vector &pos, C_vector &closest ) const
+{
+   C_vector offset = pos - m_vPosition;
+   C_vector local;
+   double   dist2  = 0.0;
+
+   for( int i = 0; i < 3; i++ )
+   {
+      double o = m_pOrientation[i][0] * offset.x() + m_pOrientation[i][1] * offset.y() + m_pOrientation[i][2] * offset.z();
+      double h = m_pSize[i] * 0.5;
+      double c = ( o > h ) ? h : ( o < -h ) ? -h : o;
+
+      local.data[i] = c;
+      dist2 += ( o - c ) * ( o - c );
+   }
+
+   closest = ( dist2 == 0.0 ) ? pos : LocalToWorld( local );
+   return sqrt( dist2 );
+}
+
 /***********************
  * COLLISION DETECTION *
  ***********************/
@@ -426,6 +493,49 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
 
    int face = -1;
 
+   g_CollisionStats.Queries++;
+
+   // Tier 1: boundary sphere, one dot product settles far misses
+   C_vector offset = pos - m_vPosition;
+   double   reach  = m_BoundRadius + rad;
+   double   dist2  = offset * offset;
+
+   if( dist2 > reach * reach )
+   {
+      double dist = sqrt( dist2 );
+
+      g_CollisionStats.SphereRejects++;
+      miss_distance = dist - reach;
+      poc = m_vPosition + offset * ( m_BoundRadius / dist );
+      return 0;
+   }
+
+   // Tier 2: world axis aligned box
+   C_vector clamped;
+   dist2 = 0.0;
+
+   for( int i = 0; i < 3; i++ )
+   {
+      double d = offset.data[i];
+
+      if( d > m_pAabbExtent[i] ) d = m_pAabbExtent[i]; else
+      if( d < -m_pAabbExtent[i] ) d = -m_pAabbExtent[i];
+
+      clamped.data[i] = d;
+      dist2 += ( offset.data[i] - d ) * ( offset.data[i] - d );
+   }
+
+   if( dist2 > rad * rad )
+   {
+      g_CollisionStats.AabbRejects++;
+      miss_distance = sqrt( dist2 ) - rad;
+      poc = m_vPosition + clamped;
+      return 0;
+   }
+
+   // Tier 3: exact six face test
+   g_CollisionStats.NarrowPhase++;
+
    cuboid_center = m_vPosition;
    //cuboid_center.set_z(-cuboid_center.z());
 
@@ -475,15 +585,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -524,15 +626,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -573,15 +667,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -622,15 +708,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -671,15 +749,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-      
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -720,15 +790,7 @@ int C_cuboid::SphereCollision( const C_vector &pos, double rad, double& miss_dis
          else
             miss_distance = s2p_mag;
 
-         poc = poc + m_vPosition;
-
-         glm::mat4 model = glm::mat4(1.0f);
-         model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-         model = glm::inverse(model);
-
-         poc = C_vector( model[0][0] * poc.x() + model[0][1] * poc.y() + model[0][2] * poc.z(),
-                         model[1][0] * poc.x() + model[1][1] * poc.y() + model[1][2] * poc.z(),
-                         model[2][0] * poc.x() + model[2][1] * poc.y() + model[2][2] * poc.z());
+         poc = LocalToWorld( poc );
 
          return face;
       }
@@ -886,70 +948,65 @@ void C_cuboid::GetFaceCorners(int Face, C_vector& C1, C_vector& C2, C_vector& C3
    if (Face == 1)
    {
       // Front face
-      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
 
    }
    else if (Face == 2)
    {
       // Right face
-      c1 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
    }
    else if (Face == 3)
    {
       // Top face
-      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
    }
    else if (Face == 4)
    {
       // Left face
-      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
    }
    else if (Face == 5)
    {
       // Bottom face
-      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector(  m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector(  m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
    }
    else if (Face == 6)
    {
       // Back face
-      c1 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5) + m_vPosition;
-      c4 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5) + m_vPosition;
+      c1 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
+      c2 = C_vector( -m_pSize[DEPTH] * 0.5,  m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c3 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5, -m_pSize[HEIGHT] * 0.5);
+      c4 = C_vector( -m_pSize[DEPTH] * 0.5, -m_pSize[WIDTH] * 0.5,  m_pSize[HEIGHT] * 0.5);
    }
 
-   glm::mat4 model = glm::mat4(1.0f);
-   model = glm::rotate(model, glm::radians((float)-m_Yaw), glm::vec3(0.0f, 0.0f, 1.0f));
-   model = glm::inverse(model);
-
-   C1 = C_vector( model[0][0] * c1.x() + model[0][1] * c1.y() + model[0][2] * c1.z(),
-                  model[1][0] * c1.x() + model[1][1] * c1.y() + model[1][2] * c1.z(),
-                  model[2][0] * c1.x() + model[2][1] * c1.y() + model[2][2] * c1.z());
-
-   C2 = C_vector( model[0][0] * c2.x() + model[0][1] * c2.y() + model[0][2] * c2.z(),
-                  model[1][0] * c2.x() + model[1][1] * c2.y() + model[1][2] * c2.z(),
-                  model[2][0] * c2.x() + model[2][1] * c2.y() + model[2][2] * c2.z());
+   C1 = LocalToWorld( c1 );
+   C2 = LocalToWorld( c2 );
+   C3 = LocalToWorld( c3 );
+   C4 = LocalToWorld( c4 );
+}
 
-   C3 = C_vector( model[0][0] * c3.x() + model[0][1] * c3.y() + model[0][2] * c3.z(),
-                  model[1][0] * c3.x() + model[1][1] * c3.y() + model[1][2] * c3.z(),
-                  model[2][0] * c3.x() + model[2][1] * c3.y() + model[2][2] * c3.z());
+TCollisionStats& C_cuboid::Stats( void )
+{
+   return g_CollisionStats;
+}
 
-   C4 = C_vector( model[0][0] * c4.x() + model[0][1] * c4.y() + model[0][2] * c4.z(),
-                  model[1][0] * c4.x() + model[1][1] * c4.y() + model[1][2] * c4.z(),
-                  model[2][0] * c4.x() + model[2][1] * c4.y() + model[2][2] * c4.z());
+void C_cuboid::ResetStats( void )
+{
+   g_CollisionStats = {};
 }
@@ -2,11 +2,21 @@
 #ifndef CUBOID__
 #define CUBOID__
 
+#include "CommonTypes.h"
 #include "Vector.h"
 #include <stdio.h>
 
 #define XOUT_YLEFT_ZDOWN 1
 
+// Per-thread tally of which tier of SphereCollision settled each query
+struct TCollisionStats
+{
+   u64 Queries;
+   u64 SphereRejects;  // rejected by the boundary sphere
+   u64 AabbRejects;    // rejected by the world axis aligned box
+   u64 NarrowPhase;    // fell through to the six face test
+};
+
 class C_cuboid
 {
 public:
@@ -27,6 +37,10 @@ public:
    enum size_index{ WIDTH, HEIGHT, DEPTH };
 #endif
 
+   // Cached bounds, relative to m_vPosition (see UpdateBounds)
+   double m_BoundRadius;
+   double m_pAabbExtent[3];
+
    /****************
     * Constructors *
     ****************/
@@ -198,27 +212,61 @@ public:
    //! \param[in] x The roll in radians.
    void SetRoll( double x ); // Radians
 
+   //! void UpdateBounds()
+   //! \details Recomputes the cached boundary sphere radius and world AABB
+   //!          half extents from the size and orientation. The modifiers above
+   //!          call this, code writing m_pSize or m_pOrientation directly must
+   //!          call it before the next collision query.
+   void UpdateBounds( void );
+
+   //! C_vector LocalToWorld(const C_vector &local)
+   //! \details Maps a point given relative to the center along the cuboid's
+   //!          depth, width and height axes to world coordinates.
+   //! \return The world point.
+   C_vector LocalToWorld( const C_vector &local ) const;
+
    /***********************
     * Collision Detection *
     ***********************/
 
-   //! double SphereCollision(C_vector &pos, double rad)
-   //! \details If the supplied Sphere is NOT within the cuboids boundary
-   //!          sphere then the distance between the Sphere's edge and the
-   //!          closest possible distance to the cuboid center is returned. If
-   //!          the supplied Sphere is within the cuboids boundary sphere but
-   //!          not colliding with the cuboid itself the distance between the
-   //!          Sphere's edge and closest face is returned. If collision has
-   //!          occurred then 0.0 is returned.
+   //! double ClosestPoint(const C_vector &pos, C_vector &closest)
+   //! \details Finds the point of the cuboid, surface or inside, closest to pos.
+   //! \param[out] closest The closest point, pos itself if it is inside.
+   //! \return The distance from pos to the cuboid, 0.0 inside.
+   double ClosestPoint( const C_vector &pos, C_vector &closest ) const;
+
+   //! int SphereCollision(C_vector &pos, double rad, double &miss_distance, C_vector &poc)
+   //! \details The query is settled by the cheapest test that can decide it:
+   //!          1. If the supplied Sphere is NOT within the cuboids boundary
+   //!             sphere then the distance between the Sphere's edge and the
+   //!             boundary sphere is returned.
+   //!          2. If the supplied Sphere does not touch the cuboids world
+   //!             axis aligned box then the distance between the Sphere's
+   //!             edge and the box is returned.
+   //!          3. Otherwise the distance between the Sphere's edge and the
+   //!             face crossed by the line to the cuboid center is returned.
+   //!          Both early outs return a lower bound of the face distance. If
+   //!          collision has occurred then 0.0 is returned.
    //! \param[in] pos The position of the sphere.
    //! \param[in] rad The radius of the sphere.
-   //! \return The distance between the sphere edge and the closest point on
-   //!         this cuboid, a value of 0.0 indicates a collision.
+   //! \param[out] miss_distance The distance between the sphere edge and this
+   //!             cuboid, a value of 0.0 indicates a collision.
+   //! \param[out] poc The closest point on the boundary that settled the query.
+   //! \return The face (1-6) that was tested, 0 if the query was rejected by
+   //!         the boundary sphere or box, -1 if the sphere center is inside.
    int SphereCollision( const C_vector &pos, double rad, double& miss_distance, C_vector& poc );
 
    int SphereCollisionOld( const C_vector &pos, double rad, double& miss_distance, C_vector& poc );
 
    void GetFaceCorners(int Face, C_vector& C1, C_vector& C2, C_vector& C3, C_vector& C4);
+
+   //! TCollisionStats& Stats()
+   //! \details Returns the calling thread's SphereCollision tier counters.
+   static TCollisionStats& Stats( void );
+
+   //! void ResetStats()
+   //! \details Zeroes the calling thread's SphereCollision tier counters.
+   static void ResetStats( void );
 };
 
 #endif//CUBOID__
@@ -1,5 +1,7 @@
 
+#include <errno.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -35,3 +37,126 @@ TBuffer ReadEntireFile(const char* Filename)
 
    return Result;
 }
+
+TBuffer C_mappedFile::Map(const char* Filename, bool Populate)
+{
+   struct stat Stat;
+
+   Unmap();
+
+   int fd = open(Filename, O_RDONLY);
+   if (fd < 0)
+      return m_View;
+
+   if (fstat(fd, &Stat) != 0)
+   {
+      close(fd);
+      return m_View;
+   }
+
+   u64 size = (u64)Stat.st_size;
+   u64 page = (u64)sysconf(_SC_PAGESIZE);
+
+   // Reserve the file plus padding as zero pages, then map the file over the
+   // front. Past the end of the file its last page reads as zeros too.
+   m_Length = (size + PADDING + page - 1) / page * page;
+   m_Base   = mmap(nullptr, m_Length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+   if (m_Base == MAP_FAILED)
+   {
+      m_Base = nullptr;
+      close(fd);
+      return m_View;
+   }
+
+   if (size > 0)
+   {
+      int flags = MAP_PRIVATE | MAP_FIXED;
+
+#ifdef MAP_POPULATE
+      if (Populate)
+         flags |= MAP_POPULATE;
+#endif
+
+      if (mmap(m_Base, size, PROT_READ, flags, fd, 0) == MAP_FAILED)
+      {
+         close(fd);
+         Unmap();
+         return m_View;
+      }
+
+      madvise(m_Base, size, MADV_SEQUENTIAL);
+      madvise(m_Base, size, MADV_WILLNEED);
+   }
+
+   // The mapping holds its own reference to the file
+   close(fd);
+
+   m_View.Data = (u8*)m_Base;
+   m_View.Size = size;
+   return m_View;
+}
+
+void C_mappedFile::Unmap()
+{
+   if (m_Base)
+      munmap(m_Base, m_Length);
+
+   m_Base   = nullptr;
+   m_Length = 0;
+   m_View   = {};
+}
+
+bool C_chunkReader::Open(const char* Filename)
+{
+   struct stat Stat;
+
+   Close();
+
+   m_Fd = open(Filename, O_RDONLY);
+   if (m_Fd < 0)
+      return false;
+
+   if (fstat(m_Fd, &Stat) != 0)
+   {
+      Close();
+      return false;
+   }
+
+   m_Size   = Stat.st_size;
+   m_Offset = 0;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+   posix_fadvise(m_Fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+   return true;
+}
+
+void C_chunkReader::Close()
+{
+   if (m_Fd >= 0)
+      close(m_Fd);
+
+   m_Fd = -1;
+}
+
+u64 C_chunkReader::Read(u8* Dest, u64 Max)
+{
+   u64 total = 0;
+
+   while (m_Fd >= 0 && total < Max)
+   {
+      ssize_t got = read(m_Fd, Dest + total, Max - total);
+
+      if (got < 0 && errno == EINTR)
+         continue;
+      if (got <= 0)
+         break;
+
+      total += (u64)got;
+   }
+
+   m_Offset += total;
+   return total;
+}
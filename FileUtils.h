@@ -5,3 +5,75 @@
 
 TBuffer ReadEntireFile(const char* Filename);
 
+// A whole file mapped read only, unmapped again by Unmap() or the destructor.
+// The view starts page aligned and at least PADDING zero bytes past its end
+// are readable, so SIMD scanners may load whole blocks over the end.
+class C_mappedFile
+{
+public:
+
+   static constexpr u64 PADDING = 64;
+
+   C_mappedFile() : m_Base(nullptr), m_Length(0), m_View() {}
+   ~C_mappedFile() { Unmap(); }
+
+   C_mappedFile(const C_mappedFile&) = delete;
+   C_mappedFile& operator=(const C_mappedFile&) = delete;
+
+   //! TBuffer Map(const char* Filename, bool Populate)
+   //! \details Maps the file and advises the kernel it will be read
+   //!          sequentially and soon. Populate prefaults every page up front
+   //!          (MAP_POPULATE) instead of on first touch.
+   //! \return A view of the file, Data is nullptr if it cannot be mapped.
+   TBuffer Map(const char* Filename, bool Populate = false);
+
+   //! void Unmap()
+   //! \details Releases the mapping, the view becomes invalid.
+   void Unmap();
+
+   //! TBuffer View()
+   TBuffer View() const { return m_View; }
+
+private:
+
+   void*   m_Base;
+   u64     m_Length; // whole mapping, padding pages included
+   TBuffer m_View;
+};
+
+
+// Sequential reader for files too big to hold in memory, hands the file out
+// in caller sized pieces
+class C_chunkReader
+{
+public:
+
+   C_chunkReader() : m_Fd(-1), m_Size(0), m_Offset(0) {}
+   ~C_chunkReader() { Close(); }
+
+   //! bool Open(const char* Filename)
+   //! \return false if the file cannot be opened.
+   bool Open(const char* Filename);
+
+   //! void Close()
+   void Close();
+
+   //! u64 Read(u8* Dest, u64 Max)
+   //! \details Reads up to Max bytes, only short at the end of the file.
+   //! \return The bytes read, 0 at the end of the file or on error.
+   u64 Read(u8* Dest, u64 Max);
+
+   //! u64 Size()
+   //! \return The file size when it was opened.
+   u64 Size() const { return m_Size; }
+
+   //! u64 Offset()
+   //! \return The bytes read so far.
+   u64 Offset() const { return m_Offset; }
+
+private:
+
+   int m_Fd;
+   u64 m_Size;
+   u64 m_Offset;
+};
@@ -0,0 +1,245 @@
+
+#include <math.h>
+#include "Gjk.h"
+
+#define GJK_MAX_ITERATIONS 64
+#define GJK_REL_TOLERANCE  1.0e-10
+#define GJK_ABS_TOLERANCE  1.0e-18
+
+C_vector ConvexSupport(const TConvex& Shape, const C_vector& Dir)
+{
+   switch (Shape.Shape)
+   {
+      case CONVEX_OBB:
+      {
+         C_vector p = Shape.Center;
+
+         for (int k = 0; k < 3; k++)
+            p += Shape.Axis[k] * ((Shape.Axis[k] * Dir >= 0.0) ? Shape.Half[k] : -Shape.Half[k]);
+
+         return p;
+      }
+
+      case CONVEX_CONE:
+      {
+         // Either the apex or the point of the base rim farthest along Dir
+         const C_vector& axis = Shape.Axis[0];
+         C_vector        base = Shape.Center + axis * Shape.Half[0];
+         C_vector        side = Dir - axis * (axis * Dir);
+         f64             len  = abs(side);
+
+         if (len > 0.0)
+            base += side * (Shape.Half[1] / len);
+
+         return (base * Dir > Shape.Center * Dir) ? base : Shape.Center;
+      }
+
+      case CONVEX_HULL:
+      {
+         u32 best = 0;
+         f64 max  = Shape.Points[0] * Dir;
+
+         for (u32 i = 1; i < Shape.PointCount; i++)
+         {
+            f64 d = Shape.Points[i] * Dir;
+            if (d > max)
+            {
+               max  = d;
+               best = i;
+            }
+         }
+
+         return Shape.Points[best];
+      }
+   }
+
+   return Shape.Center;
+}
+
+// Closest point to the origin on triangle abc, the triangle vertices that
+// support it are moved to the front of W and their count returned in N
+static C_vector ClosestOnTriangle(C_vector W[4], u32& N)
+{
+   C_vector a  = W[0];
+   C_vector b  = W[1];
+   C_vector c  = W[2];
+   C_vector ab = b - a;
+   C_vector ac = c - a;
+   C_vector ap = a * -1.0;
+
+   f64 d1 = ab * ap;
+   f64 d2 = ac * ap;
+   if (d1 <= 0.0 && d2 <= 0.0) { N = 1; return a; }
+
+   C_vector bp = b * -1.0;
+   f64 d3 = ab * bp;
+   f64 d4 = ac * bp;
+   if (d3 >= 0.0 && d4 <= d3) { W[0] = b; N = 1; return b; }
+
+   f64 vc = d1 * d4 - d3 * d2;
+   if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+   {
+      N = 2;
+      return a + ab * (d1 / (d1 - d3));
+   }
+
+   C_vector cp = c * -1.0;
+   f64 d5 = ab * cp;
+   f64 d6 = ac * cp;
+   if (d6 >= 0.0 && d5 <= d6) { W[0] = c; N = 1; return c; }
+
+   f64 vb = d5 * d2 - d1 * d6;
+   if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+   {
+      W[1] = c;
+      N    = 2;
+      return a + ac * (d2 / (d2 - d6));
+   }
+
+   f64 va = d3 * d6 - d5 * d4;
+   if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+   {
+      W[0] = b;
+      W[1] = c;
+      N    = 2;
+      return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+   }
+
+   f64 denom = 1.0 / (va + vb + vc);
+   N = 3;
+   return a + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// Closest point to the origin on the simplex W[0..N), reducing W to the
+// smallest subset that supports it. Returns false if the origin is inside.
+static bool ClosestOnSimplex(C_vector W[4], u32& N, C_vector& V)
+{
+   if (N == 1)
+   {
+      V = W[0];
+      return true;
+   }
+
+   if (N == 2)
+   {
+      C_vector ab = W[1] - W[0];
+      f64      l2 = ab * ab;
+      f64      t  = (l2 > 0.0) ? -(W[0] * ab) / l2 : 0.0;
+
+      if (t <= 0.0)
+      {
+         N = 1;
+         V = W[0];
+      }
+      else if (t >= 1.0)
+      {
+         W[0] = W[1];
+         N    = 1;
+         V    = W[0];
+      }
+      else
+      {
+         V = W[0] + ab * t;
+      }
+      return true;
+   }
+
+   if (N == 3)
+   {
+      V = ClosestOnTriangle(W, N);
+      return true;
+   }
+
+   // Tetrahedron: test the origin against each face, seen from the opposite
+   // vertex. Degenerate (flat) faces are always examined.
+   static const int faces[4][4] = { { 0, 1, 2, 3 }, { 0, 2, 3, 1 }, { 0, 3, 1, 2 }, { 1, 3, 2, 0 } };
+
+   bool     outside = false;
+   f64      best    = -1.0;
+   C_vector best_w[4];
+   u32      best_n  = 0;
+
+   for (int f = 0; f < 4; f++)
+   {
+      const C_vector& a = W[faces[f][0]];
+      C_vector n        = cross(W[faces[f][1]] - a, W[faces[f][2]] - a);
+      f64      sign_o   = n * (a * -1.0);
+      f64      sign_d   = n * (W[faces[f][3]] - a);
+
+      if (sign_o * sign_d >= 0.0 && sign_d * sign_d > GJK_ABS_TOLERANCE)
+         continue;
+
+      C_vector tri[4] = { W[faces[f][0]], W[faces[f][1]], W[faces[f][2]] };
+      u32      n_tri  = 3;
+      C_vector p      = ClosestOnTriangle(tri, n_tri);
+      f64      d2     = p * p;
+
+      outside = true;
+
+      if (best < 0.0 || d2 < best)
+      {
+         best   = d2;
+         V      = p;
+         best_n = n_tri;
+         for (u32 i = 0; i < n_tri; i++)
+            best_w[i] = tri[i];
+      }
+   }
+
+   if (!outside)
+      return false;
+
+   N = best_n;
+   for (u32 i = 0; i < N; i++)
+      W[i] = best_w[i];
+
+   return true;
+}
+
+// Shared GJK iteration, returns the distance or 0.0 on overlap. With
+// EarlyOut set any separating direction ends the search (returns > 0.0).
+static f64 Gjk(const TConvex& A, const TConvex& B, bool EarlyOut)
+{
+   C_vector W[4];
+   u32      n = 0;
+   C_vector v = ConvexSupport(A, C_vector(1.0, 0.0, 0.0)) - ConvexSupport(B, C_vector(-1.0, 0.0, 0.0));
+
+   for (int iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++)
+   {
+      f64 v2 = v * v;
+
+      if (v2 <= GJK_ABS_TOLERANCE)
+         return 0.0;
+
+      C_vector w = ConvexSupport(A, v * -1.0) - ConvexSupport(B, v);
+      f64      vw = v * w;
+
+      if (EarlyOut && vw > 0.0)
+         return sqrt(v2);
+
+      // No support point gets meaningfully closer, v is the answer
+      if (v2 - vw <= GJK_REL_TOLERANCE * v2)
+         return sqrt(v2);
+
+      for (u32 i = 0; i < n; i++)
+         if (sum2(W[i] - w) <= GJK_ABS_TOLERANCE)
+            return sqrt(v2);
+
+      W[n++] = w;
+
+      if (!ClosestOnSimplex(W, n, v))
+         return 0.0;
+   }
+
+   return sqrt(v * v);
+}
+
+f64 GjkDistance(const TConvex& A, const TConvex& B)
+{
+   return Gjk(A, B, false);
+}
+
+bool GjkIntersect(const TConvex& A, const TConvex& B)
+{
+   return Gjk(A, B, true) == 0.0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CommonTypes.h"
+#include "Vector.h"
+
+enum EConvexShape
+{
+   CONVEX_OBB,  // Center, Axis[0..2] (unit), Half[0..2]
+   CONVEX_CONE, // apex at Center, unit Axis[0], Half[0] height, Half[1] base radius
+   CONVEX_HULL  // convex hull of Points[0..PointCount)
+};
+
+struct TConvex
+{
+   static constexpr u32 MAX_POINTS = 8;
+
+   EConvexShape Shape;
+   C_vector     Center;
+   C_vector     Axis[3];
+   f64          Half[3];
+   C_vector     Points[MAX_POINTS];
+   u32          PointCount;
+};
+
+//! C_vector ConvexSupport(const TConvex& Shape, const C_vector& Dir)
+//! \details Returns the point of the shape farthest along Dir.
+C_vector ConvexSupport(const TConvex& Shape, const C_vector& Dir);
+
+//! f64 GjkDistance(const TConvex& A, const TConvex& B)
+//! \details Gilbert-Johnson-Keerthi distance between two convex shapes.
+//! \return The distance between the closest points, 0.0 if they overlap.
+f64 GjkDistance(const TConvex& A, const TConvex& B);
+
+//! bool GjkIntersect(const TConvex& A, const TConvex& B)
+//! \details Same iteration as GjkDistance, but returns as soon as a
+//!          separating direction is found.
+//! \return true if the shapes overlap.
+bool GjkIntersect(const TConvex& A, const TConvex& B);
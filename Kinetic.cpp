@@ -0,0 +1,176 @@
+
+#include <math.h>
+#include <algorithm>
+#include "Kinetic.h"
+
+C_kineticScheduler::C_kineticScheduler()
+   : m_Now(0.0),
+     m_Stats()
+{
+   m_Entities.SetBroadphase(BROADPHASE_NONE);
+}
+
+// The shot position in the frame of the entity's last sample, so the exact
+// test can run against the stored cuboid. Velocity is the closing velocity.
+C_vector C_kineticScheduler::Relative(const TShotState& Shot, const TEntityState& Entity, f64 Time, C_vector& Velocity) const
+{
+   Velocity = Shot.Shot.Velocity - Entity.Velocity;
+
+   return Shot.Shot.Position + Shot.Shot.Velocity * (Time - Shot.Shot.Time) - Entity.Velocity * (Time - Entity.Time);
+}
+
+// Earliest time at or after From the shot sphere can reach the entity's
+// boundary sphere, the pair is not queued if it never can before expiry
+void C_kineticScheduler::Schedule(u32 Shot, u32 Entity, f64 From)
+{
+   const TShotState&   shot   = m_Shots[Shot];
+   const TEntityState& entity = m_EntityState[Entity];
+   C_vector            velocity;
+
+   From = std::max(From, shot.Shot.Time);
+   if (From > shot.Shot.Expiry)
+      return;
+
+   C_vector d     = Relative(shot, entity, From, velocity);
+   f64      reach = m_Entities.m_Radius[Entity] + shot.Shot.Radius;
+   f64      time  = From;
+
+   for (int k = 0; k < 3; k++)
+      d.data[k] -= m_Entities.m_Center[k][Entity];
+
+   f64 c = d * d - reach * reach;
+
+   if (c > 0.0)
+   {
+      f64 a = velocity * velocity;
+      f64 b = d * velocity;
+
+      // Outside the sphere and not closing, or closing but passing it by
+      if (b >= 0.0 || a == 0.0)
+         return;
+
+      f64 disc = b * b - a * c;
+      if (disc < 0.0)
+         return;
+
+      time = From + (-b - sqrt(disc)) / a;
+   }
+
+   if (time > shot.Shot.Expiry)
+      return;
+
+   m_Queue.push({ time, Shot, Entity, shot.Version, entity.Version });
+   m_Stats.Scheduled++;
+}
+
+u32 C_kineticScheduler::AddEntity(const C_cuboid& Cuboid, u32 Id, const C_vector& Velocity, f64 Time)
+{
+   u32 entity = m_Entities.Add(Cuboid, Id);
+
+   m_EntityState.push_back({ Velocity, Time, 0 });
+
+   for (u32 s = 0; s < m_Shots.size(); s++)
+      if (m_Shots[s].Alive)
+         Schedule(s, entity, std::max(m_Now, Time));
+
+   return entity;
+}
+
+void C_kineticScheduler::UpdateEntity(u32 Entity, const C_cuboid& Cuboid, const C_vector& Velocity, f64 Time)
+{
+   TEntityState& state = m_EntityState[Entity];
+
+   m_Entities.Set(Entity, Cuboid);
+   state.Velocity = Velocity;
+   state.Time     = Time;
+   state.Version++;
+
+   for (u32 s = 0; s < m_Shots.size(); s++)
+      if (m_Shots[s].Alive && m_Touched.find(PairKey(s, Entity)) == m_Touched.end())
+         Schedule(s, Entity, std::max(m_Now, Time));
+}
+
+u32 C_kineticScheduler::AddShot(const TKineticShot& Shot)
+{
+   u32 shot;
+
+   if (m_FreeShots.empty())
+   {
+      shot = (u32)m_Shots.size();
+      m_Shots.push_back({ Shot, 0, true });
+   }
+   else
+   {
+      shot = m_FreeShots.back();
+      m_FreeShots.pop_back();
+
+      m_Shots[shot].Shot  = Shot;
+      m_Shots[shot].Alive = true;
+   }
+
+   for (u32 e = 0; e < m_EntityState.size(); e++)
+      Schedule(shot, e, m_Now);
+
+   return shot;
+}
+
+void C_kineticScheduler::RemoveShot(u32 Shot)
+{
+   TShotState& state = m_Shots[Shot];
+
+   if (!state.Alive)
+      return;
+
+   state.Alive = false;
+   state.Version++;
+
+   for (u32 e = 0; e < m_EntityState.size(); e++)
+      m_Touched.erase(PairKey(Shot, e));
+
+   m_FreeShots.push_back(Shot);
+}
+
+u32 C_kineticScheduler::Advance(f64 Time, std::vector<TKineticContact>& Contacts)
+{
+   u32 found = 0;
+
+   while (!m_Queue.empty() && m_Queue.top().Time <= Time)
+   {
+      TEvent event = m_Queue.top();
+      m_Queue.pop();
+
+      const TShotState&   shot   = m_Shots[event.Shot];
+      const TEntityState& entity = m_EntityState[event.Entity];
+
+      if (!shot.Alive || shot.Version != event.ShotVersion || entity.Version != event.EntityVersion)
+      {
+         m_Stats.Stale++;
+         continue;
+      }
+
+      m_Now = std::max(m_Now, event.Time);
+      m_Stats.Evaluated++;
+
+      C_vector velocity;
+      C_vector closest;
+      C_vector point = Relative(shot, entity, event.Time, velocity);
+      f64      miss  = m_Entities.PointDistance(event.Entity, point, closest) - shot.Shot.Radius;
+
+      if (miss <= 0.0)
+      {
+         m_Touched.insert(PairKey(event.Shot, event.Entity));
+         Contacts.push_back({ event.Shot, event.Entity, event.Time, closest + entity.Velocity * (event.Time - entity.Time) });
+         m_Stats.Contacts++;
+         found++;
+         continue;
+      }
+
+      // The gap cannot close faster than the relative speed
+      f64 speed = abs(velocity);
+      if (speed > 0.0)
+         Schedule(event.Shot, event.Entity, event.Time + std::max(miss / speed, MIN_STEP));
+   }
+
+   m_Now = std::max(m_Now, Time);
+   return found;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <queue>
+#include <unordered_set>
+#include <vector>
+#include "CommonTypes.h"
+#include "Scene.h"
+
+// A round in flight, moving in a straight line from Position at Time
+struct TKineticShot
+{
+   u32      Id;       // caller supplied round id
+   C_vector Position; // world position at Time
+   C_vector Velocity; // m/s
+   f64      Radius;   // lethal radius in meters
+   f64      Time;     // seconds
+   f64      Expiry;   // no contacts are reported after this time
+};
+
+struct TKineticContact
+{
+   u32      Shot;   // handle returned by AddShot
+   u32      Entity; // handle returned by AddEntity
+   f64      Time;   // first time the pair was found touching
+   C_vector Point;  // closest point on the cuboid at Time
+};
+
+struct TKineticStats
+{
+   u64 Scheduled;  // events pushed on the queue
+   u64 Evaluated;  // exact distance tests run
+   u64 Stale;      // events dropped because the shot or entity changed
+   u64 Contacts;
+};
+
+// Kinetic collision detection between rounds and entities. Every pair gets
+// a conservative earliest contact time from the relative velocity and the
+// entity's boundary sphere, and only the earliest pending pair is tested.
+// A miss reschedules the pair by its miss distance over the closing speed,
+// so a pair is never tested while it provably cannot touch. Entities move
+// linearly between state updates, an update invalidates and reschedules
+// every pair of that entity.
+class C_kineticScheduler
+{
+public:
+
+   // Smallest reschedule step in seconds, stops grazing pairs stalling
+   static constexpr f64 MIN_STEP = 1.0e-4;
+
+   C_kineticScheduler();
+
+   //! u32 AddEntity(const C_cuboid& Cuboid, u32 Id, const C_vector& Velocity, f64 Time)
+   //! \details Adds an entity whose state Cuboid was sampled at Time and
+   //!          schedules it against every live shot.
+   //! \return The entity handle.
+   u32 AddEntity(const C_cuboid& Cuboid, u32 Id, const C_vector& Velocity, f64 Time);
+
+   //! void UpdateEntity(u32 Entity, const C_cuboid& Cuboid, const C_vector& Velocity, f64 Time)
+   //! \details Replaces the entity state with a new sample. Pending events of
+   //!          the entity become stale and its pairs are rescheduled, pairs
+   //!          that already touched stay reported once.
+   void UpdateEntity(u32 Entity, const C_cuboid& Cuboid, const C_vector& Velocity, f64 Time);
+
+   //! u32 AddShot(const TKineticShot& Shot)
+   //! \details Schedules the shot against every entity.
+   //! \return The shot handle, handles of removed shots are reused.
+   u32 AddShot(const TKineticShot& Shot);
+
+   //! void RemoveShot(u32 Shot)
+   //! \details Drops the shot, its pending events become stale.
+   void RemoveShot(u32 Shot);
+
+   //! u32 Advance(f64 Time, std::vector<TKineticContact>& Contacts)
+   //! \details Runs every event due up to Time, in time order.
+   //! \param[out] Contacts New contacts are appended.
+   //! \return The number of contacts appended.
+   u32 Advance(f64 Time, std::vector<TKineticContact>& Contacts);
+
+   //! f64 Now()
+   //! \return The time of the last Advance().
+   f64 Now() const { return m_Now; }
+
+   //! u32 Pending()
+   //! \return The number of queued events, stale ones included.
+   u32 Pending() const { return (u32)m_Queue.size(); }
+
+   //! const TKineticStats& Stats()
+   const TKineticStats& Stats() const { return m_Stats; }
+
+private:
+
+   struct TEvent
+   {
+      f64 Time;
+      u32 Shot;
+      u32 Entity;
+      u32 ShotVersion;
+      u32 EntityVersion;
+
+      bool operator>(const TEvent& Other) const { return Time > Other.Time; }
+   };
+
+   struct TEntityState
+   {
+      C_vector Velocity;
+      f64      Time;
+      u32      Version;
+   };
+
+   struct TShotState
+   {
+      TKineticShot Shot;
+      u32          Version;
+      bool         Alive;
+   };
+
+   void Schedule(u32 Shot, u32 Entity, f64 From);
+   C_vector Relative(const TShotState& Shot, const TEntityState& Entity, f64 Time, C_vector& Velocity) const;
+   static u64 PairKey(u32 Shot, u32 Entity) { return ((u64)Shot << 32) | Entity; }
+
+   C_scene                   m_Entities;  // entity states at their sample times
+   std::vector<TEntityState> m_EntityState;
+   std::vector<TShotState>   m_Shots;
+   std::vector<u32>          m_FreeShots;
+   std::unordered_set<u64>   m_Touched;   // pairs already reported
+
+   std::priority_queue<TEvent, std::vector<TEvent>, std::greater<TEvent>> m_Queue;
+
+   f64                       m_Now;
+   TKineticStats             m_Stats;
+};
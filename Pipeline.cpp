@@ -0,0 +1,203 @@
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include "FileUtils.h"
+#include "Pipeline.h"
+
+using pipeline_clock = std::chrono::steady_clock;
+
+static f64 Elapsed(pipeline_clock::time_point Start)
+{
+   return std::chrono::duration<f64>(pipeline_clock::now() - Start).count();
+}
+
+C_replayPipeline::C_replayPipeline(C_replay& Replay, u32 QueueDepth, EReadBackend Backend)
+   : m_Replay(Replay),
+     m_Reader(QueueDepth, CHUNK_SIZE, Backend),
+     m_Text(BUFFERS),
+     m_Records(BUFFERS),
+     m_Scores(BUFFERS)
+{
+   for (TTextChunk& chunk : m_Text)
+      chunk.Data = new u8[CHUNK_SIZE + MAX_LINE + PADDING];
+}
+
+C_replayPipeline::~C_replayPipeline()
+{
+   for (TTextChunk& chunk : m_Text)
+      delete [] chunk.Data;
+}
+
+bool C_replayPipeline::Run(const char* Filename, FILE* Out, bool HitsOnly, TPipelineStats& Stats)
+{
+   s32 file = m_Reader.Open(Filename);
+
+   if (file < 0)
+      return false;
+
+   C_blockingQueue<TTextChunk*>   free_text(BUFFERS),    text(BUFFERS);
+   C_blockingQueue<TRecordBatch*> free_records(BUFFERS), records(BUFFERS);
+   C_blockingQueue<TScoreBatch*>  free_scores(BUFFERS),  scores(BUFFERS);
+
+   for (u32 i = 0; i < BUFFERS; i++)
+   {
+      free_text.Push(&m_Text[i]);
+      free_records.Push(&m_Records[i]);
+      free_scores.Push(&m_Scores[i]);
+   }
+
+   memset(&Stats, 0, sizeof(Stats));
+
+   bool failed = false;
+
+   // Read: fills chunks that end on a line boundary, the partial last line
+   // is carried to the front of the next chunk
+   std::thread read_stage([&]
+   {
+      u8  carry[MAX_LINE];
+      u64 carried = 0;
+
+      for (;;)
+      {
+         TTextChunk* chunk = free_text.Pop();
+         auto        start = pipeline_clock::now();
+
+         TAsyncChunk piece = {};
+
+         memcpy(chunk->Data, carry, carried);
+
+         // The reader keeps the next reads in flight while this one is copied
+         if (m_Reader.Next(file, piece))
+         {
+            memcpy(chunk->Data + carried, piece.Data, piece.Size);
+            m_Reader.Release(file, piece);
+         }
+
+         // A failed read ends the file early, what came before it is still
+         // replayed but the run reports the failure
+         failed = m_Reader.Failed(file);
+
+         u64 got  = piece.Size;
+         u64 size = carried + got;
+
+         chunk->Last = (got == 0);
+         carried     = 0;
+
+         if (!chunk->Last)
+         {
+            u64 end = size;
+            while (end > 0 && chunk->Data[end - 1] != '\n')
+               end--;
+
+            // A line longer than MAX_LINE is cut, the parser rejects both pieces
+            if (end > 0 && size - end <= MAX_LINE)
+            {
+               carried = size - end;
+               memcpy(carry, chunk->Data + end, carried);
+               size = end;
+            }
+         }
+
+         chunk->Size = size;
+         memset(chunk->Data + size, 0, PADDING);
+
+         Stats.Bytes += got;
+         Stats.Chunks++;
+         Stats.ReadSeconds += Elapsed(start);
+
+         text.Push(chunk);
+
+         if (chunk->Last)
+            break;
+      }
+   });
+
+   std::thread parse_stage([&]
+   {
+      for (;;)
+      {
+         TTextChunk*   chunk = text.Pop();
+         TRecordBatch* batch = free_records.Pop();
+         auto          start = pipeline_clock::now();
+
+         batch->Records.Clear();
+         ParseRecordingColumns(chunk->Data, chunk->Size, batch->Records, &Stats.Malformed);
+         batch->Last = chunk->Last;
+
+         Stats.ParseSeconds += Elapsed(start);
+
+         free_text.Push(chunk);
+         records.Push(batch);
+
+         if (batch->Last)
+            break;
+      }
+   });
+
+   // Score in slices small enough that one score batch stays under
+   // C_replay::SCORE_PAIRS whatever the number of entities
+   std::thread score_stage([&]
+   {
+      for (;;)
+      {
+         TRecordBatch* batch = records.Pop();
+         u64           count = batch->Records.Count();
+         u64           first = 0;
+
+         do
+         {
+            TScoreBatch* out   = free_scores.Pop();
+            auto         start = pipeline_clock::now();
+            u64          slice = m_Replay.ScoreSlice();
+
+            slice = std::min(slice, count - first);
+
+            out->Scores.clear();
+            m_Replay.Replay(batch->Records, first, slice, out->Scores);
+            first     += slice;
+            out->Last  = batch->Last && first == count;
+
+            Stats.ScoreSeconds += Elapsed(start);
+            scores.Push(out);
+         }
+         while (first < count);
+
+         bool last = batch->Last;
+         free_records.Push(batch);
+
+         if (last)
+            break;
+      }
+   });
+
+   // Write on the calling thread
+   for (;;)
+   {
+      TScoreBatch* batch = scores.Pop();
+      auto         start = pipeline_clock::now();
+      bool         last  = batch->Last;
+
+      C_replay::WriteScores(Out, batch->Scores.data(), batch->Scores.size(), HitsOnly);
+
+      Stats.WriteSeconds += Elapsed(start);
+      free_scores.Push(batch);
+
+      if (last)
+         break;
+   }
+
+   read_stage.join();
+   parse_stage.join();
+   score_stage.join();
+
+   m_Reader.Close(file);
+
+   Stats.ReadStalls  = free_text.Waits();
+   Stats.ParseStalls = free_records.Waits();
+   Stats.ScoreStalls = free_scores.Waits();
+   Stats.WriteStalls = scores.Waits();
+
+   return !failed;
+}
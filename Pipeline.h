@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stdio.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "AsyncReader.h"
+#include "CommonTypes.h"
+#include "Recording.h"
+#include "Replay.h"
+
+// Bounded blocking FIFO between pipeline stages, Push waits while full and
+// Pop while empty. The waits are counted, they are the backpressure.
+template <typename T>
+class C_blockingQueue
+{
+public:
+
+   C_blockingQueue(u32 Capacity) : m_Capacity(Capacity), m_Waits(0) {}
+
+   void Push(const T& Item)
+   {
+      std::unique_lock<std::mutex> lock(m_Lock);
+
+      if (m_Items.size() >= m_Capacity)
+      {
+         m_Waits++;
+         m_NotFull.wait(lock, [&] { return m_Items.size() < m_Capacity; });
+      }
+
+      m_Items.push_back(Item);
+      m_NotEmpty.notify_one();
+   }
+
+   T Pop()
+   {
+      std::unique_lock<std::mutex> lock(m_Lock);
+
+      if (m_Items.empty())
+      {
+         m_Waits++;
+         m_NotEmpty.wait(lock, [&] { return !m_Items.empty(); });
+      }
+
+      T item = m_Items.front();
+      m_Items.pop_front();
+      m_NotFull.notify_one();
+      return item;
+   }
+
+   //! u64 Waits()
+   //! \return How often Push found the queue full or Pop found it empty.
+   u64 Waits()
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      return m_Waits;
+   }
+
+private:
+
+   std::mutex              m_Lock;
+   std::condition_variable m_NotFull;
+   std::condition_variable m_NotEmpty;
+   std::deque<T>           m_Items;
+   u32                     m_Capacity;
+   u64                     m_Waits;
+};
+
+struct TPipelineStats
+{
+   u64 Bytes;
+   u64 Chunks;
+   u64 Malformed;    // lines that did not parse
+   f64 ReadSeconds;  // time each stage spent working, not waiting
+   f64 ParseSeconds;
+   f64 ScoreSeconds;
+   f64 WriteSeconds;
+   u64 ReadStalls;   // waits for a free buffer (downstream is behind)
+   u64 ParseStalls;
+   u64 ScoreStalls;
+   u64 WriteStalls;  // waits for scores (upstream is behind)
+};
+
+// Streams a recording through read -> parse -> score -> write, one thread
+// per stage. Each stage hands its output to the next in buffers drawn from
+// a fixed pool, and gets buffers back once the next stage is done with
+// them. A slow stage leaves the stages before it waiting for free buffers,
+// so memory stays at the pool size whatever the file size.
+class C_replayPipeline
+{
+public:
+
+   static constexpr u64 CHUNK_SIZE  = 4 << 20; // text bytes per chunk
+   static constexpr u64 MAX_LINE    = 4096;    // longest line carried between chunks
+   static constexpr u64 PADDING     = 64;      // readable past the end of every chunk
+   static constexpr u32 BUFFERS     = 4;       // of each kind in flight
+   static constexpr u32 QUEUE_DEPTH = 4;       // file reads in flight
+
+   //! Constructor C_replayPipeline(C_replay& Replay, u32 QueueDepth, EReadBackend Backend)
+   //! \details Allocates the buffer pools once. The read stage keeps
+   //!          QueueDepth reads of CHUNK_SIZE in flight on the async reader.
+   C_replayPipeline(C_replay& Replay, u32 QueueDepth = QUEUE_DEPTH, EReadBackend Backend = READ_BACKEND_URING);
+   ~C_replayPipeline();
+
+   //! EReadBackend Backend()
+   //! \return The read backend in use, io_uring unless the kernel lacks it.
+   EReadBackend Backend() const { return m_Reader.Backend(); }
+
+   //! bool Run(const char* Filename, FILE* Out, bool HitsOnly, TPipelineStats& Stats)
+   //! \details Replays the whole file, writing scores as C_replay::WriteScores.
+   //! \return false if the file cannot be opened or a read of it fails.
+   bool Run(const char* Filename, FILE* Out, bool HitsOnly, TPipelineStats& Stats);
+
+private:
+
+   struct TTextChunk
+   {
+      u8* Data;
+      u64 Size;
+      bool Last;
+   };
+
+   struct TRecordBatch
+   {
+      TRecordColumns Records;
+      bool           Last;
+   };
+
+   struct TScoreBatch
+   {
+      std::vector<TPairScore> Scores;
+      bool                    Last;
+   };
+
+   C_replay&                     m_Replay;
+   C_asyncReader                 m_Reader;
+   std::vector<TTextChunk>       m_Text;
+   std::vector<TRecordBatch>     m_Records;
+   std::vector<TScoreBatch>      m_Scores;
+};
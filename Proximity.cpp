@@ -0,0 +1,162 @@
+
+#include <math.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include "Proximity.h"
+
+#define PROXIMITY_CHUNK 256
+
+// Collects the partners of cuboid A with a higher index, sorted by index
+static void ProximityOne(const C_scene& Scene, u32 A, f64 Distance, std::vector<TProximityPair>& Pairs,
+                         std::vector<u32>& Scratch, TProximityStats& Stats)
+{
+   f64 min[3];
+   f64 max[3];
+
+   for (int k = 0; k < 3; k++)
+   {
+      min[k] = Scene.m_Center[k][A] - Scene.m_Extent[k][A] - Distance;
+      max[k] = Scene.m_Center[k][A] + Scene.m_Extent[k][A] + Distance;
+   }
+
+   Scratch.clear();
+
+   if (Scene.m_Broadphase == BROADPHASE_NONE || Scene.m_BvhNodes.empty())
+   {
+      for (u32 b = A + 1; b < Scene.Count(); b++)
+         Scratch.push_back(b);
+   }
+   else
+   {
+      u32 stack[C_scene::BVH_STACK_DEPTH];
+      int sp = 0;
+
+      stack[sp++] = 0;
+
+      while (sp > 0)
+      {
+         const TBvhNode& node    = Scene.m_BvhNodes[stack[--sp]];
+         bool            overlap = true;
+
+         for (int k = 0; k < 3; k++)
+            if (node.Max[k] < min[k] || node.Min[k] > max[k])
+               overlap = false;
+
+         if (!overlap)
+            continue;
+
+         if (node.Count)
+         {
+            for (u32 i = node.First; i < node.First + node.Count; i++)
+               if (Scene.m_BvhItems[i] > A)
+                  Scratch.push_back(Scene.m_BvhItems[i]);
+            continue;
+         }
+
+         stack[sp++] = node.First + 1;
+         stack[sp++] = node.First;
+      }
+
+      std::sort(Scratch.begin(), Scratch.end());
+   }
+
+   TConvex box_a;
+   TConvex box_b;
+   bool    have_a = false;
+
+   for (u32 b : Scratch)
+   {
+      f64 d[3];
+      f64 gap2 = 0.0;
+
+      Stats.Candidates++;
+
+      for (int k = 0; k < 3; k++)
+         d[k] = Scene.m_Center[k][b] - Scene.m_Center[k][A];
+
+      f64 reach = Scene.m_Radius[A] + Scene.m_Radius[b] + Distance;
+      if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] > reach * reach)
+      {
+         Stats.Rejected++;
+         continue;
+      }
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 gap = fabs(d[k]) - Scene.m_Extent[k][A] - Scene.m_Extent[k][b];
+         if (gap > 0.0)
+            gap2 += gap * gap;
+      }
+
+      if (gap2 > Distance * Distance)
+      {
+         Stats.Rejected++;
+         continue;
+      }
+
+      if (!have_a)
+      {
+         Scene.GetConvex(A, box_a);
+         have_a = true;
+      }
+
+      Stats.Exact++;
+      Scene.GetConvex(b, box_b);
+
+      f64 dist = GjkDistance(box_a, box_b);
+
+      if (dist <= Distance)
+         Pairs.push_back({ A, b, dist });
+   }
+}
+
+void ProximityPairs(const C_scene& Scene, f64 Distance, std::vector<TProximityPair>& Pairs, u32 Threads, TProximityStats* Stats)
+{
+   u32 count  = Scene.Count();
+   u32 chunks = (count + PROXIMITY_CHUNK - 1) / PROXIMITY_CHUNK;
+
+   if (Threads == 0)
+      Threads = std::max(1u, std::thread::hardware_concurrency());
+   if (Threads > chunks)
+      Threads = std::max(1u, chunks);
+
+   std::vector<std::vector<TProximityPair>> results(chunks);
+   std::vector<TProximityStats>             stats(Threads, TProximityStats());
+   std::vector<std::thread>                 workers;
+   std::atomic<u32>                         next(0);
+
+   auto run = [&](u32 Worker)
+   {
+      std::vector<u32> scratch;
+
+      for (u32 chunk = next++; chunk < chunks; chunk = next++)
+      {
+         u32 last = std::min(count, (chunk + 1) * PROXIMITY_CHUNK);
+
+         for (u32 a = chunk * PROXIMITY_CHUNK; a < last; a++)
+            ProximityOne(Scene, a, Distance, results[chunk], scratch, stats[Worker]);
+      }
+   };
+
+   for (u32 t = 1; t < Threads; t++)
+      workers.emplace_back(run, t);
+   run(0);
+
+   for (std::thread& worker : workers)
+      worker.join();
+
+   Pairs.clear();
+   for (u32 chunk = 0; chunk < chunks; chunk++)
+      Pairs.insert(Pairs.end(), results[chunk].begin(), results[chunk].end());
+
+   if (Stats)
+   {
+      for (u32 t = 0; t < Threads; t++)
+      {
+         Stats->Candidates += stats[t].Candidates;
+         Stats->Rejected   += stats[t].Rejected;
+         Stats->Exact      += stats[t].Exact;
+      }
+   }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+#include "Scene.h"
+
+struct TProximityPair
+{
+   u32 A;        // scene index, always less than B
+   u32 B;
+   f64 Distance; // exact distance between the two cuboids, 0.0 if they overlap
+};
+
+struct TProximityStats
+{
+   u64 Candidates; // pairs returned by the broadphase
+   u64 Rejected;   // dropped by the boundary sphere or AABB gap
+   u64 Exact;      // needed the GJK distance
+};
+
+//! void ProximityPairs(const C_scene& Scene, f64 Distance, std::vector<TProximityPair>& Pairs, u32 Threads, TProximityStats* Stats)
+//! \details Self join of the scene: every pair of cuboids closer than
+//!          Distance. Each cuboid queries the broadphase with its AABB grown
+//!          by Distance and keeps only partners with a higher index, so each
+//!          pair is found once. Candidates pass the boundary sphere and AABB
+//!          gap filters before the exact GJK distance. Work is handed out in
+//!          fixed chunks of cuboids and merged in chunk order, so the output
+//!          is sorted by (A, B) for any thread count.
+//! \param[in] Distance The alert threshold in meters.
+//! \param[out] Pairs Replaced with the pairs, sorted by (A, B).
+//! \param[in] Threads The number of threads, 0 uses every core.
+//! \param[in,out] Stats Optional stage counters, accumulated.
+void ProximityPairs(const C_scene& Scene, f64 Distance, std::vector<TProximityPair>& Pairs, u32 Threads, TProximityStats* Stats);
@@ -0,0 +1,630 @@
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <emmintrin.h>
+#include <algorithm>
+#include <charconv>
+#include "Recording.h"
+
+#define RECORD_MAX_FIELDS 16
+#define RECORD_MAX_LINE   512
+
+// Type, id and flags are read as doubles. Casting one that is not a whole
+// number in range of its integer is undefined, such a line is malformed.
+static bool WholeInRange(f64 Value, f64 Low, f64 High)
+{
+   return Value >= Low && Value <= High && Value == floor(Value);
+}
+
+static bool IntegerFieldsValid(const f64* Field, u32 Fields)
+{
+   if (!WholeInRange(Field[0], 0.0, (f64)UINT32_MAX) || !WholeInRange(Field[1], 0.0, (f64)UINT32_MAX))
+      return false;
+
+   return Fields != RECORD_SHOT_FIELDS || WholeInRange(Field[5], (f64)INT32_MIN, (f64)INT32_MAX);
+}
+
+bool ParseRecordLine(const char* Line, const char* End, TRecord& Record)
+{
+   char        text[RECORD_MAX_LINE];
+   f64         field[RECORD_MAX_FIELDS] = {}; // fields past the last parsed one stay zero
+   u32         fields = 0;
+   u64         length = (u64)(End - Line);
+
+   // strtod needs a terminated copy, trailing '\r' and blanks are dropped
+   while (length && (Line[length - 1] == '\r' || Line[length - 1] == ' ' || Line[length - 1] == '\t'))
+      length--;
+
+   if (length == 0 || length >= sizeof(text))
+      return false;
+
+   memcpy(text, Line, length);
+   text[length] = '\0';
+
+   // A trailing comma leaves an empty last field, it is not counted
+   char* p = text;
+   while (*p && fields < RECORD_MAX_FIELDS)
+   {
+      char* next;
+
+      field[fields] = strtod(p, &next);
+      if (next == p)
+         return false;
+
+      fields++;
+      p = next;
+
+      while (*p == ' ' || *p == '\t')
+         p++;
+
+      if (*p == ',')
+         p++;
+      else if (*p)
+         return false;
+   }
+
+   if (*p || (fields != RECORD_SHOT_FIELDS && fields != RECORD_ENTITY_FIELDS) || !IntegerFieldsValid(field, fields))
+      return false;
+
+   memset(&Record, 0, sizeof(Record));
+   Record.Type = (u32)field[0];
+   Record.Id   = (u32)field[1];
+
+   for (int k = 0; k < 3; k++)
+      Record.Position[k] = field[2 + k];
+
+   if (fields == RECORD_SHOT_FIELDS)
+   {
+      Record.Kind  = RECORD_SHOT;
+      Record.Flags = (s32)field[5];
+      return true;
+   }
+
+   if (fields == RECORD_ENTITY_FIELDS)
+   {
+      Record.Kind = RECORD_ENTITY;
+
+      for (int k = 0; k < 3; k++)
+      {
+         Record.Center[k] = field[5 + k];
+         Record.Size[k]   = field[8 + k];
+      }
+
+      Record.Heading = field[11];
+      return true;
+   }
+
+   return false;
+}
+
+u64 ParseRecording(const u8* Data, u64 Size, std::vector<TRecord>& Records, u64* Malformed)
+{
+   const char* p     = (const char*)Data;
+   const char* end   = p + Size;
+   u64         count = 0;
+   u64         bad   = 0;
+
+   while (p < end)
+   {
+      const char* eol = (const char*)memchr(p, '\n', (size_t)(end - p));
+      TRecord     record;
+
+      if (!eol)
+         eol = end;
+
+      if (ParseRecordLine(p, eol, record))
+      {
+         Records.push_back(record);
+         count++;
+      }
+      else if (eol > p && !(eol - p == 1 && *p == '\r'))
+      {
+         bad++;
+      }
+
+      p = eol + 1;
+   }
+
+   if (Malformed)
+      *Malformed += bad;
+
+   return count;
+}
+
+void TRecordColumns::Resize(u64 Count)
+{
+   Kind.resize(Count);
+   Type.resize(Count);
+   Id.resize(Count);
+   Heading.resize(Count);
+   Flags.resize(Count);
+
+   for (int k = 0; k < 3; k++)
+   {
+      Position[k].resize(Count);
+      Center[k].resize(Count);
+      Size[k].resize(Count);
+   }
+}
+
+void TRecordColumns::Get(u64 Index, TRecord& Record) const
+{
+   memset(&Record, 0, sizeof(Record));
+
+   Record.Kind    = (ERecordKind)Kind[Index];
+   Record.Type    = Type[Index];
+   Record.Id      = Id[Index];
+   Record.Heading = Heading[Index];
+   Record.Flags   = Flags[Index];
+
+   for (int k = 0; k < 3; k++)
+   {
+      Record.Position[k] = Position[k][Index];
+      Record.Center[k]   = Center[k][Index];
+      Record.Size[k]     = Size[k][Index];
+   }
+}
+
+void TRecordColumns::Append(const TRecordColumns& Source, u64 First, u64 Count)
+{
+   auto append = [&](auto& To, const auto& From)
+   {
+      To.insert(To.end(), From.begin() + First, From.begin() + First + Count);
+   };
+
+   append(Kind, Source.Kind);
+   append(Type, Source.Type);
+   append(Id, Source.Id);
+   append(Heading, Source.Heading);
+   append(Flags, Source.Flags);
+
+   for (int k = 0; k < 3; k++)
+   {
+      append(Position[k], Source.Position[k]);
+      append(Center[k], Source.Center[k]);
+      append(Size[k], Source.Size[k]);
+   }
+}
+
+// Powers of ten that are exact doubles
+static const f64 g_Pow10[23] =
+{
+   1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Integer powers of ten for the 8 digit steps
+static const u64 g_Pow10Int[9] =
+{
+   1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+};
+
+// Count of leading decimal digits in the 8 bytes Chunk, first byte lowest
+static inline u32 DigitRun(u64 Chunk)
+{
+   u64 t    = Chunk ^ 0x3030303030303030ULL;
+   u64 bad  = ((t + 0x7676767676767676ULL) | t) & 0x8080808080808080ULL;
+
+   // A carry out of a non digit byte only reaches bytes above it
+   return bad ? (u32)__builtin_ctzll(bad) >> 3 : 8;
+}
+
+// Value of the first Count (1 to 8) digits of Chunk
+static inline u32 DigitValue(u64 Chunk, u32 Count)
+{
+   u64 v = (Chunk ^ 0x3030303030303030ULL) << (8 * (8 - Count));
+
+   v = v * 10 + (v >> 8);
+   v = (((v & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+        (((v >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+
+   return (u32)v;
+}
+
+// Accumulates the digit run at P into Mantissa, eight bytes per step while
+// a full load stays below Limit
+static inline const char* ParseDigits(const char* P, const char* Limit, u64& Mantissa, u32& Digits)
+{
+   while (P + 8 <= Limit)
+   {
+      u64 chunk;
+      memcpy(&chunk, P, 8);
+
+      u32 run = DigitRun(chunk);
+      if (run == 0)
+         return P;
+
+      Mantissa = Mantissa * g_Pow10Int[run] + DigitValue(chunk, run);
+      Digits  += run;
+      P       += run;
+
+      if (run < 8)
+         return P;
+   }
+
+   while (P < Limit && (u8)(*P - '0') < 10)
+   {
+      Mantissa = Mantissa * 10 + (u8)(*P++ - '0');
+      Digits++;
+   }
+
+   return P;
+}
+
+// Parses [P, End) as a whole number, bytes up to Limit may be read. Plain
+// decimals whose digits fit a u64 below 2^53 with at most 22 decimals are
+// exact in an integer, and one correctly rounded division by an exact power
+// of ten gives the same double strtod would. Everything else falls back to
+// std::from_chars.
+static bool ParseField(const char* P, const char* End, const char* Limit, f64& Value)
+{
+   const char* p        = P;
+   bool        negative = false;
+   u64         mantissa = 0;
+   u32         digits   = 0;
+   u32         decimals = 0;
+
+   if (p < End && (*p == '-' || *p == '+'))
+   {
+      negative = (*p == '-');
+      p++;
+   }
+
+   p = ParseDigits(p, Limit, mantissa, digits);
+
+   if (p < End && *p == '.')
+   {
+      u32 whole = digits;
+
+      p        = ParseDigits(p + 1, Limit, mantissa, digits);
+      decimals = digits - whole;
+   }
+
+   // Over 19 digits the mantissa may have wrapped, from_chars decides
+   if (p == End && digits > 0 && digits <= 19 && decimals <= 22 && mantissa <= (1ULL << 53))
+   {
+      f64 value = (f64)mantissa / g_Pow10[decimals];
+      Value = negative ? -value : value;
+      return true;
+   }
+
+   // from_chars takes no leading '+'
+   if (P < End && *P == '+')
+      P++;
+
+   std::from_chars_result result = std::from_chars(P, End, Value);
+   return result.ec == std::errc() && result.ptr == End;
+}
+
+// Bit i set where Block[i] is C
+static inline u64 MatchMask(const u8* Block, char C)
+{
+   __m128i c  = _mm_set1_epi8(C);
+   u64     m0 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Block +  0)), c));
+   u64     m1 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Block + 16)), c));
+   u64     m2 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Block + 32)), c));
+   u64     m3 = (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(Block + 48)), c));
+
+   return m0 | (m1 << 16) | (m2 << 32) | (m3 << 48);
+}
+
+#define RECORD_COLUMN_GROWTH 4096
+
+// Raw column pointers, so the byte wide Kind stores do not make the compiler
+// reload every vector's data pointer per row
+struct TColumnPointers
+{
+   u8*  Kind;
+   u32* Type;
+   u32* Id;
+   f64* Position[3];
+   f64* Center[3];
+   f64* Size[3];
+   f64* Heading;
+   s32* Flags;
+
+   void Bind(TRecordColumns& Columns)
+   {
+      Kind    = Columns.Kind.data();
+      Type    = Columns.Type.data();
+      Id      = Columns.Id.data();
+      Heading = Columns.Heading.data();
+      Flags   = Columns.Flags.data();
+
+      for (int k = 0; k < 3; k++)
+      {
+         Position[k] = Columns.Position[k].data();
+         Center[k]   = Columns.Center[k].data();
+         Size[k]     = Columns.Size[k].data();
+      }
+   }
+};
+
+// Parses the lines of [Data, Data + Size) into rows Row on of Columns, which
+// holds Allocated rows and only grows once they are used up
+// \return One past the last row written.
+static u64 ParseRows(const u8* Data, u64 Size, TRecordColumns& Columns, u64 Row, u64 Allocated, u64& Bad)
+{
+   const char* text       = (const char*)Data;
+   const char* limit      = text + Size;
+   u64         row        = Row;
+   u64         first_row  = row;
+   u64         allocated  = Allocated;
+   u64&        bad        = Bad;
+   u64         line_start = 0;
+   u32         fields     = 0;
+   bool        overflow   = false;
+   u64         field_end[RECORD_MAX_FIELDS];
+   TColumnPointers out;
+
+   out.Bind(Columns);
+
+   // Converts the fields of the line [line_start, End) into the next row
+   auto finish_line = [&](u64 End)
+   {
+      u64 end = End;
+
+      // Trailing blanks and '\r' belong to no field
+      while (end > line_start && (text[end - 1] == '\r' || text[end - 1] == ' ' || text[end - 1] == '\t'))
+         end--;
+
+      if (end == line_start)
+      {
+         // Only a lone '\r' (or nothing) counts as a blank line, as in ParseRecording
+         if (End > line_start && !(End - line_start == 1 && text[line_start] == '\r'))
+            bad++;
+         return;
+      }
+
+      // The last field ends at the line end, unless the line ends in a comma
+      if (!overflow && (fields == 0 || field_end[fields - 1] + 1 < end))
+      {
+         if (fields < RECORD_MAX_FIELDS)
+            field_end[fields++] = end;
+         else
+            overflow = true;
+      }
+
+      if (overflow || (fields != RECORD_SHOT_FIELDS && fields != RECORD_ENTITY_FIELDS))
+      {
+         bad++;
+         return;
+      }
+
+      f64         value[RECORD_ENTITY_FIELDS];
+      const char* p = text + line_start;
+
+      for (u32 f = 0; f < fields; f++)
+      {
+         const char* e = text + field_end[f];
+
+         // Blanks around a field are rare, they are trimmed on a retry
+         if (!ParseField(p, e, limit, value[f]))
+         {
+            const char* b = p;
+            const char* t = e;
+
+            while (b < t && (*b == ' ' || *b == '\t'))
+               b++;
+            while (t > b && (t[-1] == ' ' || t[-1] == '\t'))
+               t--;
+
+            if ((b == p && t == e) || !ParseField(b, t, limit, value[f]))
+            {
+               bad++;
+               return;
+            }
+         }
+
+         p = e + 1;
+      }
+
+      if (!IntegerFieldsValid(value, fields))
+      {
+         bad++;
+         return;
+      }
+
+      if (row == allocated)
+      {
+         allocated += RECORD_COLUMN_GROWTH + (allocated - first_row);
+         Columns.Resize(allocated);
+         out.Bind(Columns);
+      }
+
+      out.Type[row] = (u32)value[0];
+      out.Id[row]   = (u32)value[1];
+
+      for (int k = 0; k < 3; k++)
+         out.Position[k][row] = value[2 + k];
+
+      if (fields == RECORD_SHOT_FIELDS)
+      {
+         out.Kind[row]    = RECORD_SHOT;
+         out.Flags[row]   = (s32)value[5];
+         out.Heading[row] = 0.0;
+
+         for (int k = 0; k < 3; k++)
+            out.Center[k][row] = out.Size[k][row] = 0.0;
+      }
+      else
+      {
+         out.Kind[row]    = RECORD_ENTITY;
+         out.Flags[row]   = 0;
+         out.Heading[row] = value[11];
+
+         for (int k = 0; k < 3; k++)
+         {
+            out.Center[k][row] = value[5 + k];
+            out.Size[k][row]   = value[8 + k];
+         }
+      }
+
+      row++;
+   };
+
+   // Walks the delimiter bits of one 64 byte block at Base
+   auto scan = [&](const u8* Block, u64 Base, u64 Valid)
+   {
+      u64 newlines = MatchMask(Block, '\n');
+      u64 marks    = newlines | MatchMask(Block, ',');
+
+      if (Valid < 64)
+         marks &= (1ULL << Valid) - 1;
+
+      while (marks)
+      {
+         u32 bit = (u32)__builtin_ctzll(marks);
+         u64 pos = Base + bit;
+
+         marks &= marks - 1;
+
+         if (newlines & (1ULL << bit))
+         {
+            finish_line(pos);
+            line_start = pos + 1;
+            fields     = 0;
+            overflow   = false;
+         }
+         else if (fields < RECORD_MAX_FIELDS)
+         {
+            field_end[fields++] = pos;
+         }
+         else
+         {
+            overflow = true;
+         }
+      }
+   };
+
+   u64 offset = 0;
+
+   for (; offset + 64 <= Size; offset += 64)
+      scan(Data + offset, offset, 64);
+
+   // The tail is scanned from a zeroed copy, nothing is read past Size
+   if (offset < Size)
+   {
+      u8 tail[64] = {};
+
+      memcpy(tail, Data + offset, (size_t)(Size - offset));
+      scan(tail, offset, Size - offset);
+   }
+
+   if (line_start < Size)
+      finish_line(Size);
+
+   return row;
+}
+
+u64 ParseRecordingColumns(const u8* Data, u64 Size, TRecordColumns& Columns, u64* Malformed)
+{
+   u64 first = Columns.Count();
+   u64 bad   = 0;
+   u64 end   = ParseRows(Data, Size, Columns, first, first, bad);
+
+   Columns.Resize(end);
+
+   if (Malformed)
+      *Malformed += bad;
+
+   return end - first;
+}
+
+// Number of lines in [Data, Data + Size), a last line without a newline included
+static u64 CountLines(const u8* Data, u64 Size)
+{
+   u64 lines  = 0;
+   u64 offset = 0;
+
+   for (; offset + 64 <= Size; offset += 64)
+      lines += (u64)__builtin_popcountll(MatchMask(Data + offset, '\n'));
+
+   for (; offset < Size; offset++)
+      lines += (Data[offset] == '\n');
+
+   return lines + (Size > 0 && Data[Size - 1] != '\n');
+}
+
+// Moves Count rows of Columns from row From down to row To
+static void MoveRows(TRecordColumns& Columns, u64 To, u64 From, u64 Count)
+{
+   memmove(&Columns.Kind[To],    &Columns.Kind[From],    Count * sizeof(u8));
+   memmove(&Columns.Type[To],    &Columns.Type[From],    Count * sizeof(u32));
+   memmove(&Columns.Id[To],      &Columns.Id[From],      Count * sizeof(u32));
+   memmove(&Columns.Heading[To], &Columns.Heading[From], Count * sizeof(f64));
+   memmove(&Columns.Flags[To],   &Columns.Flags[From],   Count * sizeof(s32));
+
+   for (int k = 0; k < 3; k++)
+   {
+      memmove(&Columns.Position[k][To], &Columns.Position[k][From], Count * sizeof(f64));
+      memmove(&Columns.Center[k][To],   &Columns.Center[k][From],   Count * sizeof(f64));
+      memmove(&Columns.Size[k][To],     &Columns.Size[k][From],     Count * sizeof(f64));
+   }
+}
+
+u64 ParseRecordingParallel(const u8* Data, u64 Size, TRecordColumns& Columns, C_threadPool& Pool, u64* Malformed)
+{
+   u64 ranges = std::min<u64>((u64)Pool.Threads() * 4, Size / RECORD_PARALLEL_RANGE);
+
+   if (ranges <= 1)
+      return ParseRecordingColumns(Data, Size, Columns, Malformed);
+
+   // Range r starts after the first newline at or past its even cut
+   std::vector<u64> start(ranges + 1);
+
+   start[0]      = 0;
+   start[ranges] = Size;
+
+   for (u64 r = 1; r < ranges; r++)
+   {
+      u64         cut = std::max(Size * r / ranges, start[r - 1] + 1);
+      const void* eol = memchr(Data + cut - 1, '\n', (size_t)(Size - cut + 1));
+
+      start[r] = eol ? (u64)((const u8*)eol - Data) + 1 : Size;
+   }
+
+   // A range never yields more rows than lines, so counting them first
+   // gives every range a fixed slot in Columns to parse straight into
+   std::vector<u64> lines(ranges);
+   std::vector<u64> rows(ranges);
+   std::vector<u64> bad(ranges, 0);
+   std::vector<u64> slot(ranges + 1);
+
+   Pool.ParallelFor((u32)ranges, 1, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 r = Begin; r < End; r++)
+         lines[r] = CountLines(Data + start[r], start[r + 1] - start[r]);
+   });
+
+   slot[0] = Columns.Count();
+   for (u64 r = 0; r < ranges; r++)
+      slot[r + 1] = slot[r] + lines[r];
+
+   Columns.Resize(slot[ranges]);
+
+   Pool.ParallelFor((u32)ranges, 1, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 r = Begin; r < End; r++)
+         rows[r] = ParseRows(Data + start[r], start[r + 1] - start[r], Columns, slot[r], slot[r + 1], bad[r]) - slot[r];
+   });
+
+   // Blank and malformed lines leave gaps, close them in file order
+   u64 end = slot[0] + rows[0];
+
+   for (u64 r = 1; r < ranges; r++)
+   {
+      if (end != slot[r] && rows[r])
+         MoveRows(Columns, end, slot[r], rows[r]);
+      end += rows[r];
+   }
+
+   Columns.Resize(end);
+
+   if (Malformed)
+      for (u64 r = 0; r < ranges; r++)
+         *Malformed += bad[r];
+
+   return end - slot[0];
+}
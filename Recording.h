@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+#include "ThreadPool.h"
+
+// One line of an exercise recording. Both kinds start with the message type
+// (78) and an id, the field count tells them apart:
+//   shot    78,<shooter id>,x,y,z,<flags>
+//   entity  78,<entity id>,x,y,z,cx,cy,cz,<width>,<height>,<depth>,<heading deg>
+enum ERecordKind
+{
+   RECORD_SHOT,
+   RECORD_ENTITY
+};
+
+#define RECORD_SHOT_FIELDS   6
+#define RECORD_ENTITY_FIELDS 12
+
+struct TRecord
+{
+   ERecordKind Kind;
+   u32         Type;        // message type, 78
+   u32         Id;          // shooter id for shots, entity id for entities
+   f64         Position[3]; // round or entity reference position
+   f64         Center[3];   // cuboid center (entities)
+   f64         Size[3];     // width, height, depth as C_cuboid takes them (entities)
+   f64         Heading;     // degrees (entities)
+   s32         Flags;       // last field of a shot line
+};
+
+//! bool ParseRecordLine(const char* Line, const char* End, TRecord& Record)
+//! \details Parses one line, without its newline.
+//! \return false for blank lines, lines of neither shape and lines whose
+//!         type, id or flags are not whole numbers in range of their field.
+bool ParseRecordLine(const char* Line, const char* End, TRecord& Record);
+
+//! u64 ParseRecording(const u8* Data, u64 Size, std::vector<TRecord>& Records, u64* Malformed)
+//! \details Parses every line of a recording held in memory. A last line
+//!          without a newline is parsed too.
+//! \param[out] Records Parsed records are appended, in file order.
+//! \param[out] Malformed Optional count of non blank lines that did not parse.
+//! \return The number of records appended.
+u64 ParseRecording(const u8* Data, u64 Size, std::vector<TRecord>& Records, u64* Malformed);
+
+// The same records as structure of arrays, one column per field, filled
+// straight from the text by ParseRecordingColumns. Shot rows hold 0.0 in the
+// entity only columns.
+struct TRecordColumns
+{
+   std::vector<u8>  Kind;        // ERecordKind
+   std::vector<u32> Type;
+   std::vector<u32> Id;
+   std::vector<f64> Position[3];
+   std::vector<f64> Center[3];
+   std::vector<f64> Size[3];
+   std::vector<f64> Heading;
+   std::vector<s32> Flags;
+
+   u64  Count() const { return Kind.size(); }
+   void Clear() { Resize(0); }
+   void Resize(u64 Count);
+
+   //! void Get(u64 Index, TRecord& Record)
+   //! \details Gathers one row back into a TRecord.
+   void Get(u64 Index, TRecord& Record) const;
+
+   //! void Append(const TRecordColumns& Source, u64 First, u64 Count)
+   //! \details Copies rows [First, First + Count) of Source to the end.
+   void Append(const TRecordColumns& Source, u64 First, u64 Count);
+};
+
+//! u64 ParseRecordingColumns(const u8* Data, u64 Size, TRecordColumns& Columns, u64* Malformed)
+//! \details ParseRecording into columns. Delimiters and newlines are found
+//!          64 bytes at a time with SSE2 compares, numbers of up to 19
+//!          digits with at most 22 decimals (every field of a normal
+//!          recording) are accumulated eight digits per step and converted
+//!          exactly by one division, anything else goes through
+//!          std::from_chars. The
+//!          values are bit-identical to ParseRecording.
+//! \param[out] Columns Parsed rows are appended, in file order.
+//! \param[out] Malformed Optional count of non blank lines that did not parse.
+//! \return The number of rows appended.
+u64 ParseRecordingColumns(const u8* Data, u64 Size, TRecordColumns& Columns, u64* Malformed);
+
+#define RECORD_PARALLEL_RANGE (1 << 20) // smallest byte range parsed by one task
+
+//! u64 ParseRecordingParallel(const u8* Data, u64 Size, TRecordColumns& Columns, C_threadPool& Pool, u64* Malformed)
+//! \details ParseRecordingColumns on the pool. The text is cut into byte
+//!          ranges, a few per worker so idle workers can steal, and each
+//!          cut is moved forward past the next newline so every range holds
+//!          whole lines. Each range counts its lines first and then parses
+//!          straight into its own slice of Columns, the gaps left by blank
+//!          and malformed lines are closed in file order afterwards, so the
+//!          rows come out exactly as ParseRecordingColumns gives them.
+//! \param[out] Columns Parsed rows are appended, in file order.
+//! \param[out] Malformed Optional count of non blank lines that did not parse.
+//! \return The number of rows appended.
+u64 ParseRecordingParallel(const u8* Data, u64 Size, TRecordColumns& Columns, C_threadPool& Pool, u64* Malformed);
@@ -0,0 +1,704 @@
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include "RecordingFile.h"
+
+#define RECORD_CONVERT_CHUNK (4 << 20)
+#define RECORD_BLOCK_COLUMNS 13 // of an entity block
+
+static u64 AlignColumn(u64 Offset)
+{
+   return (Offset + RECORD_FILE_ALIGN - 1) & ~(u64)(RECORD_FILE_ALIGN - 1);
+}
+
+// Column offsets from the start of a block, the writer and the reader both
+// derive them from the kind and the row count
+struct TBlockLayout
+{
+   u64 Row;
+   u64 Type;
+   u64 Id;
+   u64 Flags;
+   u64 Heading;
+   u64 Position[3];
+   u64 Center[3];
+   u64 Size[3];
+   u64 Bytes;
+};
+
+static void BlockLayout(u32 Kind, u64 Count, TBlockLayout& Layout)
+{
+   u64 at = sizeof(TRecordBlockHeader);
+
+   auto column = [&](u64 Width)
+   {
+      u64 start = at;
+      at = AlignColumn(at + Width * Count);
+      return start;
+   };
+
+   memset(&Layout, 0, sizeof(Layout));
+
+   Layout.Row  = column(sizeof(u64));
+   Layout.Type = column(sizeof(u32));
+   Layout.Id   = column(sizeof(u32));
+
+   if (Kind == RECORD_SHOT)
+      Layout.Flags = column(sizeof(s32));
+   else
+      Layout.Heading = column(sizeof(f64));
+
+   for (int k = 0; k < 3; k++)
+      Layout.Position[k] = column(sizeof(f64));
+
+   if (Kind == RECORD_ENTITY)
+   {
+      for (int k = 0; k < 3; k++)
+         Layout.Center[k] = column(sizeof(f64));
+      for (int k = 0; k < 3; k++)
+         Layout.Size[k] = column(sizeof(f64));
+   }
+
+   Layout.Bytes = at;
+}
+
+enum EColumnType
+{
+   COLUMN_U64,
+   COLUMN_U32,
+   COLUMN_S32,
+   COLUMN_F64
+};
+
+struct TBlockColumn
+{
+   u64         Offset;
+   EColumnType Type;
+};
+
+// The columns of a block in file order, coded blocks keep the same order
+static u32 BlockColumns(u32 Kind, const TBlockLayout& Layout, TBlockColumn* Columns)
+{
+   u32 count = 0;
+
+   Columns[count++] = { Layout.Row,  COLUMN_U64 };
+   Columns[count++] = { Layout.Type, COLUMN_U32 };
+   Columns[count++] = { Layout.Id,   COLUMN_U32 };
+
+   if (Kind == RECORD_SHOT)
+      Columns[count++] = { Layout.Flags, COLUMN_S32 };
+   else
+      Columns[count++] = { Layout.Heading, COLUMN_F64 };
+
+   for (int k = 0; k < 3; k++)
+      Columns[count++] = { Layout.Position[k], COLUMN_F64 };
+
+   if (Kind == RECORD_ENTITY)
+   {
+      for (int k = 0; k < 3; k++)
+         Columns[count++] = { Layout.Center[k], COLUMN_F64 };
+      for (int k = 0; k < 3; k++)
+         Columns[count++] = { Layout.Size[k], COLUMN_F64 };
+   }
+
+   return count;
+}
+
+// The rows of a block must strictly increase inside the range its index
+// entry claims, readers merge and search them by record number
+static bool BlockRowsValid(const TRecordBlockIndex& Index, const TRecordBlock& View)
+{
+   u64 prev = Index.FirstRow;
+
+   for (u32 i = 0; i < View.Count; i++)
+   {
+      if (View.Row[i] < prev || (i > 0 && View.Row[i] == prev) || View.Row[i] > Index.LastRow)
+         return false;
+
+      prev = View.Row[i];
+   }
+
+   return true;
+}
+
+// Points View at the columns of an uncoded block starting at Base
+static void BlockView(const u8* Base, u32 Kind, u32 Count, TRecordBlock& View)
+{
+   TBlockLayout layout;
+
+   BlockLayout(Kind, Count, layout);
+
+   bool entity = (Kind == RECORD_ENTITY);
+
+   View.Kind    = (ERecordKind)Kind;
+   View.Count   = Count;
+   View.Row     = (const u64*)(Base + layout.Row);
+   View.Type    = (const u32*)(Base + layout.Type);
+   View.Id      = (const u32*)(Base + layout.Id);
+   View.Flags   = entity ? nullptr : (const s32*)(Base + layout.Flags);
+   View.Heading = entity ? (const f64*)(Base + layout.Heading) : nullptr;
+
+   for (int k = 0; k < 3; k++)
+   {
+      View.Position[k] = (const f64*)(Base + layout.Position[k]);
+      View.Center[k]   = entity ? (const f64*)(Base + layout.Center[k]) : nullptr;
+      View.Size[k]     = entity ? (const f64*)(Base + layout.Size[k]) : nullptr;
+   }
+}
+
+void TRecordBlock::Get(u32 Index, TRecord& Record) const
+{
+   memset(&Record, 0, sizeof(Record));
+
+   Record.Kind = Kind;
+   Record.Type = Type[Index];
+   Record.Id   = Id[Index];
+
+   for (int k = 0; k < 3; k++)
+      Record.Position[k] = Position[k][Index];
+
+   if (Kind == RECORD_SHOT)
+   {
+      Record.Flags = Flags[Index];
+      return;
+   }
+
+   Record.Heading = Heading[Index];
+
+   for (int k = 0; k < 3; k++)
+   {
+      Record.Center[k] = Center[k][Index];
+      Record.Size[k]   = Size[k][Index];
+   }
+}
+
+C_recordingWriter::C_recordingWriter()
+   : m_File(nullptr),
+     m_Codec(RECORD_CODEC_NONE),
+     m_Ok(false),
+     m_Offset(0),
+     m_Rows(0)
+{
+}
+
+C_recordingWriter::~C_recordingWriter()
+{
+   if (m_File)
+      fclose(m_File);
+}
+
+bool C_recordingWriter::Open(const char* Filename, ERecordCodec Codec)
+{
+   TRecordFileHeader header = {};
+
+   m_File   = fopen(Filename, "wb");
+   m_Codec  = Codec;
+   m_Ok     = (m_File != nullptr);
+   m_Offset = 0;
+   m_Rows   = 0;
+
+   // The row count is patched in by Close()
+   header.Magic   = RECORD_FILE_MAGIC;
+   header.Version = RECORD_FILE_VERSION;
+   header.Codec   = Codec;
+
+   return Write(&header, sizeof(header));
+}
+
+bool C_recordingWriter::Write(const void* Data, u64 Size)
+{
+   if (m_Ok && Size && fwrite(Data, 1, Size, m_File) != Size)
+      m_Ok = false;
+
+   m_Offset += Size;
+   return m_Ok;
+}
+
+bool C_recordingWriter::Append(const TRecordColumns& Records, u64 First, u64 Count)
+{
+   for (u64 i = First; i < First + Count; i++)
+   {
+      u32             kind    = Records.Kind[i];
+      TRecordColumns& pending = m_Pending[kind];
+
+      pending.Kind.push_back(Records.Kind[i]);
+      pending.Type.push_back(Records.Type[i]);
+      pending.Id.push_back(Records.Id[i]);
+      pending.Heading.push_back(Records.Heading[i]);
+      pending.Flags.push_back(Records.Flags[i]);
+
+      for (int k = 0; k < 3; k++)
+      {
+         pending.Position[k].push_back(Records.Position[k][i]);
+         pending.Center[k].push_back(Records.Center[k][i]);
+         pending.Size[k].push_back(Records.Size[k][i]);
+      }
+
+      m_PendingRow[kind].push_back(m_Rows++);
+
+      if (m_PendingRow[kind].size() == RECORD_BLOCK_ROWS && !Flush(kind))
+         return false;
+   }
+
+   return m_Ok;
+}
+
+bool C_recordingWriter::Flush(u32 Kind)
+{
+   const TRecordColumns&   pending = m_Pending[Kind];
+   const std::vector<u64>& rows    = m_PendingRow[Kind];
+   u64                     count   = rows.size();
+
+   if (count == 0)
+      return m_Ok;
+
+   TBlockLayout       layout;
+   TRecordBlockHeader header = {};
+   TRecordBlockIndex  index  = {};
+   static const u8    zeros[RECORD_FILE_ALIGN] = {};
+
+   BlockLayout(Kind, count, layout);
+
+   header.Magic = RECORD_FILE_MAGIC;
+   header.Kind  = Kind;
+   header.Count = (u32)count;
+   header.Bytes = layout.Bytes;
+
+   index.Offset   = m_Offset;
+   index.FirstRow = rows.front();
+   index.LastRow  = rows.back();
+   index.Kind     = Kind;
+   index.Count    = (u32)count;
+   index.MinId    = *std::min_element(pending.Id.begin(), pending.Id.end());
+   index.MaxId    = *std::max_element(pending.Id.begin(), pending.Id.end());
+
+   // The uncoded block is put together in memory, then written or coded
+   m_Image.assign(layout.Bytes / sizeof(u64), 0);
+
+   u8* image = (u8*)m_Image.data();
+
+   auto column = [&](u64 Offset, const void* Data, u64 Width)
+   {
+      memcpy(image + Offset, Data, Width * count);
+   };
+
+   memcpy(image, &header, sizeof(header));
+   column(layout.Row,  rows.data(),         sizeof(u64));
+   column(layout.Type, pending.Type.data(), sizeof(u32));
+   column(layout.Id,   pending.Id.data(),   sizeof(u32));
+
+   if (Kind == RECORD_SHOT)
+      column(layout.Flags, pending.Flags.data(), sizeof(s32));
+   else
+      column(layout.Heading, pending.Heading.data(), sizeof(f64));
+
+   for (int k = 0; k < 3; k++)
+      column(layout.Position[k], pending.Position[k].data(), sizeof(f64));
+
+   if (Kind == RECORD_ENTITY)
+   {
+      for (int k = 0; k < 3; k++)
+         column(layout.Center[k], pending.Center[k].data(), sizeof(f64));
+      for (int k = 0; k < 3; k++)
+         column(layout.Size[k], pending.Size[k].data(), sizeof(f64));
+
+      // One key per distinct id in the block
+      std::vector<u32> ids(pending.Id);
+
+      std::sort(ids.begin(), ids.end());
+      ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+
+      for (u32 id : ids)
+         m_EntityKeys.push_back(((u64)id << 32) | (u32)m_Index.size());
+   }
+
+   if (m_Codec == RECORD_CODEC_NONE)
+      Write(image, layout.Bytes);
+   else
+   {
+      TBlockColumn columns[RECORD_BLOCK_COLUMNS];
+      TCodecColumn codecs[RECORD_BLOCK_COLUMNS];
+      u32          used = BlockColumns(Kind, layout, columns);
+
+      m_Coded.clear();
+
+      for (u32 c = 0; c < used; c++)
+      {
+         const u8* data = image + columns[c].Offset;
+
+         switch (columns[c].Type)
+         {
+            case COLUMN_U64: EncodeColumn((const u64*)data, count, m_Coded, codecs[c]); break;
+            case COLUMN_U32: EncodeColumn((const u32*)data, count, m_Coded, codecs[c]); break;
+            case COLUMN_S32: EncodeColumn((const s32*)data, count, m_Coded, codecs[c]); break;
+            case COLUMN_F64: EncodeColumn((const f64*)data, count, m_Coded, codecs[c]); break;
+         }
+      }
+
+      u64 start = m_Offset;
+
+      header.Bytes = AlignColumn(sizeof(header) + used * sizeof(TCodecColumn) + m_Coded.size());
+
+      Write(&header, sizeof(header));
+      Write(codecs, used * sizeof(TCodecColumn));
+      Write(m_Coded.data(), m_Coded.size());
+      Write(zeros, start + header.Bytes - m_Offset);
+   }
+
+   m_Index.push_back(index);
+   m_Pending[Kind].Clear();
+   m_PendingRow[Kind].clear();
+
+   return m_Ok;
+}
+
+bool C_recordingWriter::Close(TRecordConvertStats* Stats)
+{
+   if (!m_File)
+      return false;
+
+   Flush(RECORD_SHOT);
+   Flush(RECORD_ENTITY);
+
+   // Entity index, sorted by id then block number
+   std::vector<TRecordEntityIndex> entities;
+   std::vector<u32>                blocks;
+
+   std::sort(m_EntityKeys.begin(), m_EntityKeys.end());
+
+   for (u64 key : m_EntityKeys)
+   {
+      u32 id = (u32)(key >> 32);
+
+      if (entities.empty() || entities.back().Id != id)
+         entities.push_back({ id, (u32)blocks.size(), 0, 0 });
+
+      entities.back().Count++;
+      blocks.push_back((u32)key);
+   }
+
+   TRecordFileTrailer trailer = {};
+
+   trailer.IndexOffset  = m_Offset;
+   trailer.Blocks       = (u32)m_Index.size();
+   trailer.Entities     = (u32)entities.size();
+   trailer.EntityBlocks = blocks.size();
+   trailer.Magic        = RECORD_FILE_MAGIC;
+   trailer.Version      = RECORD_FILE_VERSION;
+
+   Write(m_Index.data(), m_Index.size() * sizeof(TRecordBlockIndex));
+   Write(entities.data(), entities.size() * sizeof(TRecordEntityIndex));
+   Write(blocks.data(), blocks.size() * sizeof(u32));
+   Write(&trailer, sizeof(trailer));
+
+   TRecordFileHeader header = {};
+
+   header.Magic   = RECORD_FILE_MAGIC;
+   header.Version = RECORD_FILE_VERSION;
+   header.Rows    = m_Rows;
+   header.Codec   = m_Codec;
+
+   if (m_Ok && (fseek(m_File, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, m_File) != 1))
+      m_Ok = false;
+
+   if (fclose(m_File) != 0)
+      m_Ok = false;
+
+   m_File = nullptr;
+
+   if (Stats)
+   {
+      Stats->Rows      = m_Rows;
+      Stats->FileBytes = m_Offset;
+      Stats->Blocks    = (u32)m_Index.size();
+   }
+
+   m_Index.clear();
+   m_EntityKeys.clear();
+
+   return m_Ok;
+}
+
+bool ConvertRecording(const char* TextFile, const char* BinaryFile, TRecordConvertStats& Stats, ERecordCodec Codec)
+{
+   C_chunkReader     reader;
+   C_recordingWriter writer;
+
+   memset(&Stats, 0, sizeof(Stats));
+
+   if (!reader.Open(TextFile) || !writer.Open(BinaryFile, Codec))
+      return false;
+
+   std::vector<u8> buffer;
+   TRecordColumns  columns;
+   u64             carried = 0;
+   bool            ok      = true;
+
+   for (;;)
+   {
+      buffer.resize(carried + RECORD_CONVERT_CHUNK);
+
+      u64 got  = reader.Read(buffer.data() + carried, RECORD_CONVERT_CHUNK);
+      u64 size = carried + got;
+      u64 end  = size;
+
+      // Until the end of the file only whole lines are parsed
+      if (got)
+         while (end > 0 && buffer[end - 1] != '\n')
+            end--;
+
+      columns.Clear();
+      ParseRecordingColumns(buffer.data(), end, columns, &Stats.Malformed);
+      ok = writer.Append(columns, 0, columns.Count()) && ok;
+
+      carried = size - end;
+      memmove(buffer.data(), buffer.data() + end, carried);
+
+      Stats.Bytes += got;
+
+      if (!got)
+         break;
+   }
+
+   return writer.Close(&Stats) && ok;
+}
+
+C_recordingFile::C_recordingFile()
+   : m_Index(nullptr),
+     m_Entities(nullptr),
+     m_EntityBlocks(nullptr),
+     m_Rows(0),
+     m_Codec(RECORD_CODEC_NONE),
+     m_Blocks(0),
+     m_EntityCount(0)
+{
+}
+
+bool C_recordingFile::Open(const char* Filename)
+{
+   Close();
+
+   TBuffer file = m_Mapping.Map(Filename);
+
+   if (!file.Data || file.Size < sizeof(TRecordFileHeader) + sizeof(TRecordFileTrailer))
+   {
+      Close();
+      return false;
+   }
+
+   const TRecordFileHeader* header = (const TRecordFileHeader*)file.Data;
+   TRecordFileTrailer       trailer;
+
+   // The trailer follows the u32 block list, it need not be 8 byte aligned
+   memcpy(&trailer, file.Data + file.Size - sizeof(trailer), sizeof(trailer));
+
+   // EntityBlocks is 64 bits, bounded first so the index size cannot wrap
+   u64 index_bytes = (u64)trailer.Blocks * sizeof(TRecordBlockIndex) +
+                     (u64)trailer.Entities * sizeof(TRecordEntityIndex) +
+                     std::min<u64>(trailer.EntityBlocks, file.Size) * sizeof(u32);
+
+   if (trailer.EntityBlocks > file.Size || trailer.IndexOffset > file.Size || header->Magic != RECORD_FILE_MAGIC || header->Version != RECORD_FILE_VERSION ||
+       trailer.Magic != RECORD_FILE_MAGIC || trailer.Version != RECORD_FILE_VERSION ||
+       header->Codec > RECORD_CODEC_DELTA || trailer.IndexOffset + index_bytes + sizeof(trailer) != file.Size)
+   {
+      Close();
+      return false;
+   }
+
+   m_Rows         = header->Rows;
+   m_Codec        = (ERecordCodec)header->Codec;
+   m_Blocks       = trailer.Blocks;
+   m_EntityCount  = trailer.Entities;
+   m_Index        = (const TRecordBlockIndex*)(file.Data + trailer.IndexOffset);
+   m_Entities     = (const TRecordEntityIndex*)(m_Index + m_Blocks);
+   m_EntityBlocks = (const u32*)(m_Entities + m_EntityCount);
+
+   for (u32 b = 0; b < m_Blocks; b++)
+   {
+      const TRecordBlockIndex& index = m_Index[b];
+      TBlockLayout             layout;
+
+      BlockLayout(index.Kind, index.Count, layout);
+
+      u64 bytes = layout.Bytes;
+
+      // Coded blocks carry their size, checked against the index
+      if (m_Codec != RECORD_CODEC_NONE && index.Offset + sizeof(TRecordBlockHeader) <= trailer.IndexOffset)
+      {
+         const TRecordBlockHeader* block = (const TRecordBlockHeader*)(file.Data + index.Offset);
+
+         bytes = (block->Magic == RECORD_FILE_MAGIC && block->Kind == index.Kind && block->Count == index.Count)
+                 ? block->Bytes : ~0ULL;
+      }
+
+      if (index.Kind > RECORD_ENTITY || bytes > trailer.IndexOffset || index.Offset + bytes > trailer.IndexOffset)
+      {
+         Close();
+         return false;
+      }
+
+      // BlocksInRange and the replay merge rely on the blocks of a kind
+      // covering increasing, disjoint record number ranges
+      std::vector<u32>& kind = m_KindBlocks[index.Kind];
+
+      if (index.FirstRow > index.LastRow || (!kind.empty() && m_Index[kind.back()].LastRow >= index.FirstRow))
+      {
+         Close();
+         return false;
+      }
+
+      kind.push_back(b);
+   }
+
+   // EntityBlocks() binary searches the ids and hands out slices of the
+   // block list, both must stay inside the file
+   for (u32 e = 0; e < m_EntityCount; e++)
+   {
+      const TRecordEntityIndex& entity = m_Entities[e];
+
+      if ((u64)entity.First + entity.Count > trailer.EntityBlocks || (e > 0 && m_Entities[e - 1].Id >= entity.Id))
+      {
+         Close();
+         return false;
+      }
+   }
+
+   for (u64 i = 0; i < trailer.EntityBlocks; i++)
+   {
+      if (m_EntityBlocks[i] >= m_Blocks)
+      {
+         Close();
+         return false;
+      }
+   }
+
+   return true;
+}
+
+void C_recordingFile::Close()
+{
+   m_Mapping.Unmap();
+
+   m_Index        = nullptr;
+   m_Entities     = nullptr;
+   m_EntityBlocks = nullptr;
+   m_Rows         = 0;
+   m_Codec        = RECORD_CODEC_NONE;
+   m_Blocks       = 0;
+   m_EntityCount  = 0;
+
+   m_KindBlocks[RECORD_SHOT].clear();
+   m_KindBlocks[RECORD_ENTITY].clear();
+}
+
+void C_recordingFile::Block(u32 Block, TRecordBlock& View) const
+{
+   const TRecordBlockIndex& index = m_Index[Block];
+
+   BlockView(m_Mapping.View().Data + index.Offset, index.Kind, index.Count, View);
+}
+
+bool C_recordingFile::Decode(u32 Block, std::vector<u64>& Buffer, TRecordBlock& View) const
+{
+   if (m_Codec == RECORD_CODEC_NONE)
+   {
+      this->Block(Block, View);
+
+      if (BlockRowsValid(m_Index[Block], View))
+         return true;
+
+      View.Count = 0;
+      return false;
+   }
+
+   const TRecordBlockIndex&  index  = m_Index[Block];
+   const u8*                 block  = m_Mapping.View().Data + index.Offset;
+   const u8*                 end    = block + ((const TRecordBlockHeader*)block)->Bytes;
+   TBlockLayout              layout;
+   TBlockColumn              columns[RECORD_BLOCK_COLUMNS];
+
+   BlockLayout(index.Kind, index.Count, layout);
+
+   u32                 used   = BlockColumns(index.Kind, layout, columns);
+   const TCodecColumn* codecs = (const TCodecColumn*)(block + sizeof(TRecordBlockHeader));
+   const u8*           data   = (const u8*)(codecs + used);
+   bool                ok     = (data <= end);
+
+   Buffer.resize(layout.Bytes / sizeof(u64));
+
+   u8* base = (u8*)Buffer.data();
+
+   for (u32 c = 0; ok && c < used; c++)
+   {
+      u8* out = base + columns[c].Offset;
+
+      ok = codecs[c].Bytes <= (u64)(end - data);
+
+      if (ok)
+      {
+         switch (columns[c].Type)
+         {
+            case COLUMN_U64: ok = DecodeColumn(codecs[c], data, index.Count, (u64*)out); break;
+            case COLUMN_U32: ok = DecodeColumn(codecs[c], data, index.Count, (u32*)out); break;
+            case COLUMN_S32: ok = DecodeColumn(codecs[c], data, index.Count, (s32*)out); break;
+            case COLUMN_F64: ok = DecodeColumn(codecs[c], data, index.Count, (f64*)out); break;
+         }
+
+         data += codecs[c].Bytes;
+      }
+   }
+
+   BlockView(base, index.Kind, index.Count, View);
+
+   ok = ok && BlockRowsValid(index, View);
+
+   if (!ok)
+      View.Count = 0;
+
+   return ok;
+}
+
+bool C_recordingFile::DecodeBlocks(const u32* Blocks, u32 Count, std::vector<u64>* Buffers, TRecordBlock* Views, C_threadPool& Pool) const
+{
+   std::atomic<bool> ok(true);
+
+   Pool.ParallelFor(Count, 1, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 b = Begin; b < End; b++)
+         if (!Decode(Blocks[b], Buffers[b], Views[b]))
+            ok = false;
+   });
+
+   return ok;
+}
+
+void C_recordingFile::BlocksInRange(ERecordKind Kind, u64 FirstRow, u64 LastRow, std::vector<u32>& Blocks) const
+{
+   const std::vector<u32>& blocks = m_KindBlocks[Kind];
+
+   // Blocks of one kind cover increasing, disjoint record number ranges
+   auto first = std::lower_bound(blocks.begin(), blocks.end(), FirstRow,
+                                 [&](u32 Block, u64 Row) { return m_Index[Block].LastRow < Row; });
+
+   Blocks.clear();
+
+   for (auto b = first; b != blocks.end() && m_Index[*b].FirstRow <= LastRow; ++b)
+      Blocks.push_back(*b);
+}
+
+const u32* C_recordingFile::EntityBlocks(u32 Id, u32& Count) const
+{
+   const TRecordEntityIndex* end   = m_Entities + m_EntityCount;
+   const TRecordEntityIndex* found = std::lower_bound(m_Entities, end, Id,
+                                                      [](const TRecordEntityIndex& Entry, u32 Id) { return Entry.Id < Id; });
+
+   if (found == end || found->Id != Id)
+   {
+      Count = 0;
+      return nullptr;
+   }
+
+   Count = found->Count;
+   return m_EntityBlocks + found->First;
+}
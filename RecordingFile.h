@@ -0,0 +1,241 @@
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include "BlockCodec.h"
+#include "CommonTypes.h"
+#include "FileUtils.h"
+#include "Recording.h"
+#include "ThreadPool.h"
+
+// Binary columnar recording. Rows keep their record number (the ordinal of
+// the record in the text file, recordings carry no clock) and are split by
+// kind into blocks of up to RECORD_BLOCK_ROWS rows:
+//
+//   header   TRecordFileHeader
+//   blocks   TRecordBlockHeader, then one column after the other, each
+//            starting on a RECORD_FILE_ALIGN boundary:
+//              shot    Row, Type, Id, Flags, Position x y z
+//              entity  Row, Type, Id, Heading, Position x y z, Center x y z, Size x y z
+//   index    TRecordBlockIndex per block, in file order
+//            TRecordEntityIndex per entity id, sorted by id
+//            u32 block numbers the entity index points into
+//   trailer  TRecordFileTrailer, the last bytes of the file
+//
+// Files written with RECORD_CODEC_DELTA store every block coded instead:
+// TRecordBlockHeader (Bytes is the coded size), a TCodecColumn per column
+// in the order above, then the coded columns back to back, padded to
+// RECORD_FILE_ALIGN. Blocks decode on their own into the layout above.
+//
+// Every block of one kind follows the previous one of that kind in record
+// number order, so merging the two kinds by Row gives back the text order.
+
+#define RECORD_FILE_MAGIC   0x43455243 // "CREC"
+#define RECORD_FILE_VERSION 1
+#define RECORD_FILE_ALIGN   64
+#define RECORD_BLOCK_ROWS   65536
+
+enum ERecordCodec
+{
+   RECORD_CODEC_NONE,  // columns stored as they are, mapped in place
+   RECORD_CODEC_DELTA  // columns coded by BlockCodec
+};
+
+struct TRecordFileHeader
+{
+   u32 Magic;
+   u32 Version;
+   u64 Rows;        // records in the file, both kinds
+   u32 Codec;       // ERecordCodec of every block
+   u32 Reserved0;
+   u64 Reserved[5];
+};
+
+struct TRecordBlockHeader
+{
+   u32 Magic;
+   u32 Kind;        // ERecordKind
+   u32 Count;       // rows in the block
+   u32 Reserved;
+   u64 Bytes;       // header and columns
+   u64 Pad[5];
+};
+
+struct TRecordBlockIndex
+{
+   u64 Offset;      // of the block header in the file
+   u64 FirstRow;    // record numbers covered, inclusive
+   u64 LastRow;
+   u32 Kind;
+   u32 Count;
+   u32 MinId;
+   u32 MaxId;
+};
+
+struct TRecordEntityIndex
+{
+   u32 Id;
+   u32 First;       // first entry in the entity block list
+   u32 Count;       // entity blocks holding a state of this id
+   u32 Reserved;
+};
+
+struct TRecordFileTrailer
+{
+   u64 IndexOffset;
+   u32 Blocks;
+   u32 Entities;
+   u64 EntityBlocks; // entries in the entity block list
+   u32 Magic;
+   u32 Version;
+};
+
+// Columns of one block, pointing into the mapped file. Entity only columns
+// are nullptr in shot blocks and Flags is nullptr in entity blocks.
+struct TRecordBlock
+{
+   ERecordKind Kind;
+   u32         Count;
+   const u64*  Row;
+   const u32*  Type;
+   const u32*  Id;
+   const s32*  Flags;
+   const f64*  Heading;
+   const f64*  Position[3];
+   const f64*  Center[3];
+   const f64*  Size[3];
+
+   //! void Get(u32 Index, TRecord& Record)
+   //! \details Gathers one row into a TRecord.
+   void Get(u32 Index, TRecord& Record) const;
+};
+
+struct TRecordConvertStats
+{
+   u64 Bytes;      // text read
+   u64 Rows;
+   u64 Malformed;
+   u64 FileBytes;  // binary written
+   u32 Blocks;
+};
+
+// Writes a binary recording from parsed rows appended in text order
+class C_recordingWriter
+{
+public:
+
+   C_recordingWriter();
+   ~C_recordingWriter();
+
+   //! bool Open(const char* Filename, ERecordCodec Codec)
+   //! \return false if the file cannot be created.
+   bool Open(const char* Filename, ERecordCodec Codec = RECORD_CODEC_NONE);
+
+   //! bool Append(const TRecordColumns& Records, u64 First, u64 Count)
+   //! \details Adds rows [First, First + Count), full blocks are written out.
+   //! \return false on a write error.
+   bool Append(const TRecordColumns& Records, u64 First, u64 Count);
+
+   //! bool Close(TRecordConvertStats* Stats)
+   //! \details Writes the partial blocks, the index and the trailer.
+   //! \return false on a write error.
+   bool Close(TRecordConvertStats* Stats = nullptr);
+
+private:
+
+   bool Write(const void* Data, u64 Size);
+   bool Flush(u32 Kind);
+
+   FILE*                          m_File;
+   ERecordCodec                   m_Codec;
+   bool                           m_Ok;
+   u64                            m_Offset;
+   u64                            m_Rows;
+   TRecordColumns                 m_Pending[2];     // per kind, the block being built
+   std::vector<u64>               m_PendingRow[2];  // record numbers of those rows
+   std::vector<TRecordBlockIndex> m_Index;
+   std::vector<u64>               m_EntityKeys;     // id << 32 | block, per entity in a block
+   std::vector<u64>               m_Image;          // the block being written, uncoded
+   std::vector<u8>                m_Coded;
+};
+
+//! bool ConvertRecording(const char* TextFile, const char* BinaryFile, TRecordConvertStats& Stats, ERecordCodec Codec)
+//! \details Streams a text recording through ParseRecordingColumns into a
+//!          binary recording, memory stays at one chunk and two blocks.
+//! \return false if either file cannot be opened or written.
+bool ConvertRecording(const char* TextFile, const char* BinaryFile, TRecordConvertStats& Stats,
+                      ERecordCodec Codec = RECORD_CODEC_NONE);
+
+// Memory mapped binary recording. Uncoded blocks hand out column pointers
+// straight into the mapping, nothing is parsed or copied. Coded blocks are
+// decoded into caller buffers, any number of them at once.
+class C_recordingFile
+{
+public:
+
+   C_recordingFile();
+
+   //! bool Open(const char* Filename)
+   //! \return false if the file is not a binary recording of this version.
+   bool Open(const char* Filename);
+
+   //! void Close()
+   void Close();
+
+   //! u64 Rows()
+   u64 Rows() const { return m_Rows; }
+
+   //! u32 Blocks()
+   u32 Blocks() const { return m_Blocks; }
+
+   //! ERecordCodec Codec()
+   ERecordCodec Codec() const { return m_Codec; }
+
+   //! const TRecordBlockIndex& Index(u32 Block)
+   const TRecordBlockIndex& Index(u32 Block) const { return m_Index[Block]; }
+
+   //! void Block(u32 Block, TRecordBlock& View)
+   //! \details Points View at the columns of a block of an uncoded file.
+   //!          Its rows are not checked, Decode() checks them.
+   void Block(u32 Block, TRecordBlock& View) const;
+
+   //! bool Decode(u32 Block, std::vector<u64>& Buffer, TRecordBlock& View)
+   //! \details Decodes a block into Buffer and points View at it. Blocks of
+   //!          uncoded files are viewed in place and Buffer is left alone.
+   //! \return false if the block is damaged, its columns do not decode or
+   //!         its rows do not strictly increase inside the index range.
+   //!         View is then empty.
+   bool Decode(u32 Block, std::vector<u64>& Buffer, TRecordBlock& View) const;
+
+   //! bool DecodeBlocks(const u32* Blocks, u32 Count, std::vector<u64>* Buffers, TRecordBlock* Views, C_threadPool& Pool)
+   //! \details Decodes Count blocks across the pool, block i into Buffers[i].
+   //! \return false if any of them is damaged.
+   bool DecodeBlocks(const u32* Blocks, u32 Count, std::vector<u64>* Buffers, TRecordBlock* Views, C_threadPool& Pool) const;
+
+   //! const std::vector<u32>& KindBlocks(ERecordKind Kind)
+   //! \return The blocks of one kind in record number order.
+   const std::vector<u32>& KindBlocks(ERecordKind Kind) const { return m_KindBlocks[Kind]; }
+
+   //! void BlocksInRange(ERecordKind Kind, u64 FirstRow, u64 LastRow, std::vector<u32>& Blocks)
+   //! \details Binary searches the blocks of one kind covering any record
+   //!          number in [FirstRow, LastRow].
+   //! \param[out] Blocks Replaced, in record number order.
+   void BlocksInRange(ERecordKind Kind, u64 FirstRow, u64 LastRow, std::vector<u32>& Blocks) const;
+
+   //! const u32* EntityBlocks(u32 Id, u32& Count)
+   //! \details Binary searches the entity index.
+   //! \return The entity blocks holding states of Id, nullptr if it has none.
+   const u32* EntityBlocks(u32 Id, u32& Count) const;
+
+private:
+
+   C_mappedFile              m_Mapping;
+   const TRecordBlockIndex*  m_Index;
+   const TRecordEntityIndex* m_Entities;
+   const u32*                m_EntityBlocks;
+   u64                       m_Rows;
+   ERecordCodec              m_Codec;
+   u32                       m_Blocks;
+   u32                       m_EntityCount;
+   std::vector<u32>          m_KindBlocks[2];
+};
@@ -0,0 +1,218 @@
+
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "RecordingTail.h"
+
+C_recordingTail::C_recordingTail()
+   : m_File(-1),
+     m_Notify(-1),
+     m_Watch(-1),
+     m_Offset(0),
+     m_Backlog(false),
+     m_Gone(false),
+     m_Partial(false),
+     m_Carried(0),
+     m_Stats()
+{
+}
+
+C_recordingTail::~C_recordingTail()
+{
+   Close();
+}
+
+bool C_recordingTail::Open(const char* Filename, bool FromEnd)
+{
+   Close();
+
+   m_File   = open(Filename, O_RDONLY | O_CLOEXEC);
+   m_Notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+   // The watch goes on before the first read, no write can fall between them
+   if (m_File >= 0 && m_Notify >= 0)
+      m_Watch = inotify_add_watch(m_Notify, Filename, IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+
+   struct stat Stat;
+
+   if (m_Watch < 0 || fstat(m_File, &Stat) != 0)
+   {
+      Close();
+      return false;
+   }
+
+   m_Offset  = FromEnd ? (u64)Stat.st_size : 0;
+   m_Backlog = !FromEnd;
+
+   // The end may fall inside a line still being written, the rest of it
+   // arrives first and cannot be parsed
+   u8 before = '\n';
+
+   if (m_Offset && pread(m_File, &before, 1, (off_t)(m_Offset - 1)) != 1)
+   {
+      Close();
+      return false;
+   }
+
+   m_Partial = (before != '\n');
+
+   return true;
+}
+
+void C_recordingTail::Close()
+{
+   if (m_Notify >= 0)
+      close(m_Notify);
+   if (m_File >= 0)
+      close(m_File);
+
+   m_File    = -1;
+   m_Notify  = -1;
+   m_Watch   = -1;
+   m_Offset  = 0;
+   m_Backlog = false;
+   m_Gone    = false;
+   m_Partial = false;
+   m_Carried = 0;
+   m_Stats   = TTailStats();
+
+   m_Buffer.clear();
+}
+
+// Reads the queued inotify events
+// \return true if any arrived
+bool C_recordingTail::Drain()
+{
+   alignas(inotify_event) u8 events[4096];
+   bool                       any = false;
+
+   for (;;)
+   {
+      ssize_t got = read(m_Notify, events, sizeof(events));
+
+      if (got <= 0)
+         break;
+
+      any = true;
+
+      for (ssize_t at = 0; at < got;)
+      {
+         const inotify_event* event = (const inotify_event*)(events + at);
+
+         if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            m_Gone = true;
+
+         // Our descriptor keeps an unlinked file alive, IN_DELETE_SELF only
+         // comes after it is closed. The unlink shows as a link count change.
+         struct stat Stat;
+
+         if ((event->mask & IN_ATTRIB) && fstat(m_File, &Stat) == 0 && Stat.st_nlink == 0)
+            m_Gone = true;
+
+         at += sizeof(inotify_event) + event->len;
+      }
+   }
+
+   m_Stats.Wakeups += any;
+   return any;
+}
+
+u64 C_recordingTail::ReadAppended(TRecordColumns& Columns)
+{
+   struct stat Stat;
+
+   m_Backlog = false;
+
+   if (fstat(m_File, &Stat) != 0)
+      return 0;
+
+   u64 size = (u64)Stat.st_size;
+
+   // A truncated file is being rewritten, follow it from the start
+   if (size < m_Offset)
+   {
+      m_Offset  = 0;
+      m_Partial = false;
+      m_Carried = 0;
+      m_Stats.Truncations++;
+   }
+
+   u64 want = std::min<u64>(size - m_Offset, READ_SIZE);
+
+   if (want == 0)
+      return 0;
+
+   m_Buffer.resize(m_Carried + want);
+
+   u64 got = 0;
+
+   while (got < want)
+   {
+      ssize_t n = pread(m_File, m_Buffer.data() + m_Carried + got, want - got, (off_t)(m_Offset + got));
+
+      if (n <= 0)
+         break;
+
+      got += (u64)n;
+   }
+
+   m_Offset      += got;
+   m_Backlog      = (m_Offset < size);
+   m_Stats.Bytes += got;
+
+   u64 size_read = m_Carried + got;
+
+   // Nothing is carried while the partial line is dropped
+   if (m_Partial)
+   {
+      const u8* eol = (const u8*)memchr(m_Buffer.data(), '\n', size_read);
+
+      if (!eol)
+         return 0;
+
+      u64 skip = (u64)(eol - m_Buffer.data()) + 1;
+
+      size_read -= skip;
+      memmove(m_Buffer.data(), m_Buffer.data() + skip, size_read);
+      m_Partial = false;
+   }
+
+   // Only whole lines are parsed, the rest waits for its newline
+   const u8* last    = (const u8*)memrchr(m_Buffer.data(), '\n', size_read);
+   u64       end     = last ? (u64)(last - m_Buffer.data()) + 1 : 0;
+   u64       records = ParseRecordingColumns(m_Buffer.data(), end, Columns, &m_Stats.Malformed);
+
+   m_Carried = size_read - end;
+   memmove(m_Buffer.data(), m_Buffer.data() + end, m_Carried);
+
+   m_Stats.Records += records;
+   return records;
+}
+
+ETailState C_recordingTail::Poll(s32 TimeoutMs, TRecordColumns& Columns)
+{
+   if (m_File < 0)
+      return TAIL_GONE;
+
+   if (!m_Backlog && !Drain())
+   {
+      pollfd wait = { m_Notify, POLLIN, 0 };
+
+      if (poll(&wait, 1, TimeoutMs) <= 0)
+         return TAIL_WAITING;
+
+      Drain();
+   }
+
+   // Appended lines are still read after the file is unlinked
+   u64 records = ReadAppended(Columns);
+
+   if (records)
+      return TAIL_RECORDS;
+
+   return (m_Gone && !m_Backlog) ? TAIL_GONE : TAIL_WAITING;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+#include "Recording.h"
+
+enum ETailState
+{
+   TAIL_WAITING,   // nothing new before the timeout
+   TAIL_RECORDS,   // lines were parsed
+   TAIL_GONE       // the file was deleted or moved away
+};
+
+struct TTailStats
+{
+   u64 Bytes;       // read since Open
+   u64 Records;
+   u64 Malformed;
+   u64 Wakeups;     // inotify reads that had events
+   u64 Truncations; // times the file shrank and was followed from its start
+};
+
+// Follows a text recording that is still being written. An inotify watch
+// wakes Poll() on every write, each wake reads only the bytes appended
+// since the last one and parses the complete lines among them. A partial
+// last line is carried until its newline arrives.
+class C_recordingTail
+{
+public:
+
+   static constexpr u64 READ_SIZE = 4 << 20; // most bytes parsed per Poll()
+
+   C_recordingTail();
+   ~C_recordingTail();
+
+   //! bool Open(const char* Filename, bool FromEnd)
+   //! \details Starts watching the file, then reads it from the start, or
+   //!          from its current end if FromEnd is set. An end inside a line
+   //!          skips the rest of that line, only whole lines are parsed.
+   //! \return false if the file cannot be opened or watched.
+   bool Open(const char* Filename, bool FromEnd = false);
+
+   //! void Close()
+   void Close();
+
+   //! ETailState Poll(s32 TimeoutMs, TRecordColumns& Columns)
+   //! \details Parses what was appended since the last call. If nothing was,
+   //!          waits up to TimeoutMs (-1 forever) for the next write. A
+   //!          backlog over READ_SIZE is handed out over several calls that
+   //!          do not wait.
+   //! \param[out] Columns Parsed rows are appended, in file order.
+   ETailState Poll(s32 TimeoutMs, TRecordColumns& Columns);
+
+   //! u64 Offset()
+   //! \return The file offset of the first byte not yet read.
+   u64 Offset() const { return m_Offset; }
+
+   //! const TTailStats& Stats()
+   const TTailStats& Stats() const { return m_Stats; }
+
+private:
+
+   bool Drain();
+   u64  ReadAppended(TRecordColumns& Columns);
+
+   int             m_File;
+   int             m_Notify;
+   int             m_Watch;
+   u64             m_Offset;    // of the next byte to read
+   bool            m_Backlog;   // the last read stopped at READ_SIZE
+   bool            m_Gone;
+   bool            m_Partial;   // drop the bytes up to the next newline, FromEnd landed mid-line
+   std::vector<u8> m_Buffer;    // the carried partial line, then new bytes
+   u64             m_Carried;
+   TTailStats      m_Stats;
+};
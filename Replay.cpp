@@ -0,0 +1,134 @@
+
+#include <string.h>
+#include "Replay.h"
+
+C_replay::C_replay(f64 Radius, u32 Threads, bool MissPoints)
+   : m_Radius(Radius),
+     m_MissPoints(MissPoints),
+     m_Pool(Threads),
+     m_NextShot(0),
+     m_Stats()
+{
+}
+
+void C_replay::ApplyEntity(const TRecord& Record)
+{
+   C_cuboid cuboid(C_vector(Record.Center[0], Record.Center[1], Record.Center[2]), Record.Size[0], Record.Size[1], Record.Size[2]);
+
+   cuboid.SetYaw_D(Record.Heading);
+
+   auto found = m_Index.find(Record.Id);
+
+   if (found == m_Index.end())
+   {
+      m_Index[Record.Id] = (u32)m_Entities.size();
+      m_Entities.push_back(cuboid);
+      m_Ids.push_back(Record.Id);
+   }
+   else
+   {
+      m_Entities[found->second] = cuboid;
+   }
+
+   m_Stats.EntityUpdates++;
+   m_Stats.Records++;
+}
+
+void C_replay::ScoreShots(const f64* const Position[3], const u32* Source, u64 Count, std::vector<TPairScore>& Scores)
+{
+   u64 entities = m_Entities.size();
+   u64 first    = Scores.size();
+
+   Scores.resize(first + Count * entities);
+
+   m_Pool.ParallelFor((u32)Count, GRAIN, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 s = Begin; s < End; s++)
+      {
+         C_vector    round(Position[0][s], Position[1][s], Position[2][s]);
+         TPairScore* out = &Scores[first + s * entities];
+
+         for (u64 e = 0; e < entities; e++)
+         {
+            TPairScore& score = out[e];
+
+            score.Shot   = m_NextShot + s;
+            score.Source = Source[s];
+            score.Entity = m_Ids[e];
+            score.Face   = m_Entities[e].SphereCollision(round, m_Radius, score.Miss, score.Point);
+            score.Hit    = (score.Miss <= 0.0) ? 1 : 0;
+
+            // The early outs report points on the boundary sphere or the
+            // world box and a distance to those, a miss with its point takes
+            // the distance to that point too so the two columns agree
+            if (score.Hit)
+               m_Entities[e].ClosestPoint(round, score.Point);
+            else if (m_MissPoints)
+               score.Miss = std::max(0.0, m_Entities[e].ClosestPoint(round, score.Point) - m_Radius);
+         }
+      }
+   });
+
+   for (u64 i = first; i < Scores.size(); i++)
+      m_Stats.Hits += Scores[i].Hit;
+
+   m_Stats.Records += Count;
+   m_Stats.Shots   += Count;
+   m_Stats.Pairs   += Count * entities;
+   m_NextShot      += Count;
+}
+
+void C_replay::Replay(const TRecordColumns& Records, u64 First, u64 Count, std::vector<TPairScore>& Scores)
+{
+   u64 i   = First;
+   u64 end = First + Count;
+
+   while (i < end)
+   {
+      if (Records.Kind[i] == RECORD_ENTITY)
+      {
+         TRecord record;
+
+         Records.Get(i++, record);
+         ApplyEntity(record);
+         continue;
+      }
+
+      u64 run = i;
+      while (run < end && Records.Kind[run] == RECORD_SHOT)
+         run++;
+
+      const f64* position[3] = { &Records.Position[0][i], &Records.Position[1][i], &Records.Position[2][i] };
+
+      ScoreShots(position, &Records.Id[i], run - i, Scores);
+      i = run;
+   }
+}
+
+u64 C_replay::WriteScores(FILE* File, const TPairScore* Scores, u64 Count, bool HitsOnly)
+{
+   char buffer[1 << 16];
+   u64  used    = 0;
+   u64  written = 0;
+
+   for (u64 i = 0; i < Count; i++)
+   {
+      const TPairScore& s = Scores[i];
+
+      if (HitsOnly && !s.Hit)
+         continue;
+
+      used += snprintf(buffer + used, sizeof(buffer) - used, "%llu,%u,%u,%d,%d,%.6f,%.6f,%.6f,%.6f\n",
+                       (unsigned long long)s.Shot, s.Source, s.Entity, s.Hit, s.Face, s.Miss,
+                       s.Point.x(), s.Point.y(), s.Point.z());
+
+      if (used > sizeof(buffer) - 256)
+      {
+         written += fwrite(buffer, 1, used, File);
+         used     = 0;
+      }
+   }
+
+   written += fwrite(buffer, 1, used, File);
+   return written;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stdio.h>
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+#include "CommonTypes.h"
+#include "Cuboid.h"
+#include "Recording.h"
+#include "ThreadPool.h"
+
+// The score of one shot against one entity
+struct TPairScore
+{
+   u64      Shot;   // shot ordinal in the recording
+   u32      Source; // shooter id from the shot line
+   u32      Entity; // entity id
+   s32      Face;   // as SphereCollision returns it
+   s32      Hit;    // 1 if the round touches the entity
+   f64      Miss;   // distance from the round's edge to Point, 0.0 on a hit
+   C_vector Point;  // point of the entity's box closest to the round, the round
+                    // itself inside. Without miss points both are left as
+                    // SphereCollision reports them for misses, a miss settled
+                    // by an early out is then measured to the boundary sphere
+                    // or world box, a lower bound.
+};
+
+struct TReplayStats
+{
+   u64 Records;
+   u64 Shots;
+   u64 EntityUpdates;
+   u64 Pairs;
+   u64 Hits;
+};
+
+// Replays recorded records in order: entity lines update the entity table,
+// shot lines are scored against every entity known at that point
+class C_replay
+{
+public:
+
+   static constexpr u32 GRAIN       = 64;      // shots per pool chunk
+   static constexpr u64 SCORE_PAIRS = 1 << 18; // shot/entity pairs per score batch
+   static constexpr u64 SCORE_ROOT  = 1 << 9;  // sqrt(SCORE_PAIRS)
+
+   //! Constructor C_replay(f64 Radius, u32 Threads, bool MissPoints)
+   //! \param[in] Radius The round radius passed to SphereCollision.
+   //! \param[in] Threads Scoring threads, 0 uses every core.
+   //! \param[in] MissPoints Find TPairScore::Point for misses too. Replays
+   //!            that only write hits skip it, it costs more than most misses.
+   C_replay(f64 Radius, u32 Threads = 0, bool MissPoints = true);
+
+   //! void Replay(const TRecordColumns& Records, u64 First, u64 Count, std::vector<TPairScore>& Scores)
+   //! \details Applies rows [First, First + Count) in order. Runs of
+   //!          consecutive shots are scored together on the pool against the
+   //!          table as it stood when the run started.
+   //! \param[out] Scores Appended, ordered by shot then entity table order.
+   void Replay(const TRecordColumns& Records, u64 First, u64 Count, std::vector<TPairScore>& Scores);
+
+   //! void ApplyEntity(const TRecord& Record)
+   //! \details Adds the entity, or replaces the state of a known id.
+   void ApplyEntity(const TRecord& Record);
+
+   //! void ScoreShots(const f64* const Position[3], const u32* Source, u64 Count, std::vector<TPairScore>& Scores)
+   //! \details Scores Count consecutive shots, given as columns, on the pool
+   //!          against the current entity table.
+   //! \param[out] Scores Appended, ordered by shot then entity table order.
+   void ScoreShots(const f64* const Position[3], const u32* Source, u64 Count, std::vector<TPairScore>& Scores);
+
+   //! void SkipShots(u64 Count)
+   //! \details Counts shots that are not replayed (e.g. before a window), so
+   //!          later ones keep their ordinal in the recording.
+   void SkipShots(u64 Count) { m_NextShot += Count; }
+
+   //! u64 ScoreSlice()
+   //! \details The most records to replay at once for the scores to stay
+   //!          under SCORE_PAIRS pairs. A slice of n records can add up to n
+   //!          entities, so with E known entities n (E + n) must fit, which
+   //!          n = SCORE_PAIRS / (E + sqrt(SCORE_PAIRS)) guarantees.
+   //! \return At least 1, past SCORE_PAIRS entities records go one at a time.
+   u64 ScoreSlice() const { return std::max<u64>(1, SCORE_PAIRS / (m_Entities.size() + SCORE_ROOT)); }
+
+   //! u32 Entities()
+   //! \return The number of distinct entities seen so far.
+   u32 Entities() const { return (u32)m_Entities.size(); }
+
+   //! const TReplayStats& Stats()
+   const TReplayStats& Stats() const { return m_Stats; }
+
+   //! C_threadPool& Pool()
+   //! \return The scoring pool, idle between Replay() calls.
+   C_threadPool& Pool() { return m_Pool; }
+
+   //! void WriteScores(FILE* File, const TPairScore* Scores, u64 Count, bool HitsOnly)
+   //! \details Writes one CSV line per score:
+   //!          shot,shooter,entity,hit,face,miss,x,y,z
+   //! \return The number of bytes written.
+   static u64 WriteScores(FILE* File, const TPairScore* Scores, u64 Count, bool HitsOnly);
+
+private:
+
+   f64                             m_Radius;
+   bool                            m_MissPoints;
+   C_threadPool                    m_Pool;
+   std::vector<C_cuboid>           m_Entities;
+   std::vector<u32>                m_Ids;
+   std::unordered_map<u32, u32>    m_Index; // entity id -> table slot
+   u64                             m_NextShot;
+   TReplayStats                    m_Stats;
+};
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "CommonTypes.h"
+
+// Bounded lock-free ring (D. Vyukov's sequence-per-cell design). Any number of
+// producers; one consumer unless MultiConsumer is set. Producers claim a slot
+// with one CAS on the head index and never block or take a mutex.
+template <typename T, bool MultiConsumer = false>
+class C_ringQueue
+{
+public:
+
+   static constexpr u32 CACHE_LINE = 64;
+
+   //! Constructor C_ringQueue(u32 Capacity)
+   //! \details Capacity is rounded up to a power of two.
+   C_ringQueue(u32 Capacity)
+   {
+      u32 capacity = 2;
+      while (capacity < Capacity)
+         capacity <<= 1;
+
+      m_Mask  = capacity - 1;
+      m_Cells.reset(new TCell[capacity]);
+
+      for (u32 i = 0; i < capacity; i++)
+         m_Cells[i].Sequence.store(i, std::memory_order_relaxed);
+
+      m_Head.store(0, std::memory_order_relaxed);
+      m_Tail.store(0, std::memory_order_relaxed);
+      m_Overflow.store(0, std::memory_order_relaxed);
+      m_Dropped.store(0, std::memory_order_relaxed);
+   }
+
+   //! u32 Capacity()
+   u32 Capacity() const { return m_Mask + 1; }
+
+   //! bool TryPush(const T& Item)
+   //! \details Enqueues Item unless the ring is full.
+   //! \return false if the ring was full (counted as an overflow).
+   bool TryPush(const T& Item)
+   {
+      u64 pos = m_Head.load(std::memory_order_relaxed);
+
+      for (;;)
+      {
+         TCell& cell = m_Cells[pos & m_Mask];
+         u64    seq  = cell.Sequence.load(std::memory_order_acquire);
+         s64    diff = (s64)seq - (s64)pos;
+
+         if (diff == 0)
+         {
+            if (m_Head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+               cell.Data = Item;
+               cell.Sequence.store(pos + 1, std::memory_order_release);
+               return true;
+            }
+         }
+         else if (diff < 0)
+         {
+            m_Overflow.fetch_add(1, std::memory_order_relaxed);
+            return false;
+         }
+         else
+         {
+            pos = m_Head.load(std::memory_order_relaxed);
+         }
+      }
+   }
+
+   //! bool PushOrDrop(const T& Item)
+   //! \details Enqueues Item, or discards it if the ring is full (counted as
+   //!          both an overflow and a drop). For receivers that must not stall.
+   //! \return false if the item was dropped.
+   bool PushOrDrop(const T& Item)
+   {
+      if (TryPush(Item))
+         return true;
+
+      m_Dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+   }
+
+   //! bool TryPop(T& Item)
+   //! \return false if the ring was empty.
+   bool TryPop(T& Item)
+   {
+      u64 pos = m_Tail.load(std::memory_order_relaxed);
+
+      for (;;)
+      {
+         TCell& cell = m_Cells[pos & m_Mask];
+         u64    seq  = cell.Sequence.load(std::memory_order_acquire);
+         s64    diff = (s64)seq - (s64)(pos + 1);
+
+         if (diff < 0)
+            return false;
+
+         if (diff == 0)
+         {
+            if (MultiConsumer)
+            {
+               if (!m_Tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                  continue;
+            }
+            else
+            {
+               m_Tail.store(pos + 1, std::memory_order_relaxed);
+            }
+
+            Item = cell.Data;
+            cell.Sequence.store(pos + m_Mask + 1, std::memory_order_release);
+            return true;
+         }
+
+         pos = m_Tail.load(std::memory_order_relaxed);
+      }
+   }
+
+   //! u32 PopBatch(T* Items, u32 Max)
+   //! \details Dequeues up to Max items. A single consumer walks the ready
+   //!          cells and publishes the new tail once for the whole batch.
+   //! \return The number of items dequeued.
+   u32 PopBatch(T* Items, u32 Max)
+   {
+      if (MultiConsumer)
+      {
+         u32 count = 0;
+         while (count < Max && TryPop(Items[count]))
+            count++;
+         return count;
+      }
+
+      u64 pos   = m_Tail.load(std::memory_order_relaxed);
+      u32 count = 0;
+
+      while (count < Max)
+      {
+         TCell& cell = m_Cells[(pos + count) & m_Mask];
+
+         if (cell.Sequence.load(std::memory_order_acquire) != pos + count + 1)
+            break;
+
+         Items[count] = cell.Data;
+         cell.Sequence.store(pos + count + m_Mask + 1, std::memory_order_release);
+         count++;
+      }
+
+      if (count)
+         m_Tail.store(pos + count, std::memory_order_relaxed);
+
+      return count;
+   }
+
+   //! u64 Overflows()
+   //! \return The number of pushes that found the ring full.
+   u64 Overflows() const { return m_Overflow.load(std::memory_order_relaxed); }
+
+   //! u64 Drops()
+   //! \return The number of items discarded by PushOrDrop.
+   u64 Drops() const { return m_Dropped.load(std::memory_order_relaxed); }
+
+   //! u64 Size()
+   //! \return An estimate of the number of queued items.
+   u64 Size() const
+   {
+      u64 head = m_Head.load(std::memory_order_relaxed);
+      u64 tail = m_Tail.load(std::memory_order_relaxed);
+      return (head > tail) ? head - tail : 0;
+   }
+
+private:
+
+   struct TCell
+   {
+      std::atomic<u64> Sequence;
+      T                Data;
+   };
+
+   // Producers and the consumer each get their own cache line
+   alignas(CACHE_LINE) std::atomic<u64> m_Head;
+   alignas(CACHE_LINE) std::atomic<u64> m_Tail;
+   alignas(CACHE_LINE) std::atomic<u64> m_Overflow;
+   std::atomic<u64>                     m_Dropped;
+   alignas(CACHE_LINE) u32              m_Mask;
+   std::unique_ptr<TCell[]>             m_Cells;
+};
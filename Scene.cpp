@@ -0,0 +1,859 @@
+
+#include <float.h>
+#include <math.h>
+#include <immintrin.h>
+#include <algorithm>
+#include "Scene.h"
+
+#define SCENE_ZERO 0.0000000001
+
+static thread_local TPacketStats g_PacketStats = {};
+
+// The packet node test below is built for AVX2 and chosen at run time,
+// the rest of the build keeps the baseline instruction set
+static const bool g_Avx2 = __builtin_cpu_supports("avx2");
+
+// Entry fraction of 8 lanes into a node's box, DBL_MAX for the lanes that
+// miss it or reach it past their Best. Same arithmetic as the scalar lanes.
+__attribute__((target("avx2")))
+static void NodeLanesAvx2(const TBvhNode& Node, const f64 Org[3][8], const f64 Inv[3][8], const f64 Best[8], f64 Enter[8])
+{
+   for (u32 l = 0; l < 8; l += 4)
+   {
+      __m256d t_near = _mm256_setzero_pd();
+      __m256d t_far  = _mm256_loadu_pd(Best + l);
+
+      for (int k = 0; k < 3; k++)
+      {
+         __m256d org = _mm256_loadu_pd(Org[k] + l);
+         __m256d inv = _mm256_loadu_pd(Inv[k] + l);
+         __m256d t1  = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(Node.Min[k]), org), inv);
+         __m256d t2  = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(Node.Max[k]), org), inv);
+
+         t_near = _mm256_max_pd(t_near, _mm256_min_pd(t1, t2));
+         t_far  = _mm256_min_pd(t_far,  _mm256_max_pd(t1, t2));
+      }
+
+      __m256d inside = _mm256_cmp_pd(t_near, t_far, _CMP_LE_OQ);
+
+      _mm256_storeu_pd(Enter + l, _mm256_blendv_pd(_mm256_set1_pd(DBL_MAX), t_near, inside));
+   }
+}
+
+// Face hit when entering through the negative/positive side of each local axis
+static const s32 SlabFace[3][2] =
+{
+   { 6, 1 }, // depth:  back,   front
+   { 2, 4 }, // width:  right,  left
+   { 5, 3 }  // height: bottom, top
+};
+
+// Slab test of the segment From + t * Delta against a node's box, returns the
+// entry fraction in TEnter when the box is reached before TMax
+static bool RayAabb(const TBvhNode& Node, const f64 From[3], const f64 Delta[3], f64 TMax, f64& TEnter)
+{
+   f64 t_near = 0.0;
+   f64 t_far  = TMax;
+
+   for (int k = 0; k < 3; k++)
+   {
+      if (fabs(Delta[k]) < SCENE_ZERO)
+      {
+         if (From[k] < Node.Min[k] || From[k] > Node.Max[k])
+            return false;
+         continue;
+      }
+
+      f64 inv = 1.0 / Delta[k];
+      f64 t1  = (Node.Min[k] - From[k]) * inv;
+      f64 t2  = (Node.Max[k] - From[k]) * inv;
+
+      if (t1 > t2) std::swap(t1, t2);
+      if (t1 > t_near) t_near = t1;
+      if (t2 < t_far)  t_far  = t2;
+
+      if (t_near > t_far)
+         return false;
+   }
+
+   TEnter = t_near;
+   return true;
+}
+
+C_scene::C_scene()
+   : m_Broadphase(BROADPHASE_BVH)
+{
+}
+
+void C_scene::Clear()
+{
+   m_Id.clear();
+   m_Radius.clear();
+
+   for (int i = 0; i < 3; i++)
+   {
+      m_Center[i].clear();
+      m_Half[i].clear();
+      m_Extent[i].clear();
+
+      for (int j = 0; j < 3; j++)
+         m_Axis[i][j].clear();
+   }
+
+   m_BvhNodes.clear();
+   m_BvhItems.clear();
+}
+
+u32 C_scene::Add(const C_cuboid& Cuboid, u32 Id)
+{
+   u32 index = Count();
+
+   m_Id.push_back(Id);
+   m_Radius.push_back(Cuboid.m_BoundRadius);
+
+   for (int i = 0; i < 3; i++)
+   {
+      m_Center[i].push_back(Cuboid.m_vPosition.data[i]);
+      m_Half[i].push_back(Cuboid.m_pSize[i] * 0.5);
+      m_Extent[i].push_back(Cuboid.m_pAabbExtent[i]);
+
+      for (int j = 0; j < 3; j++)
+         m_Axis[i][j].push_back(Cuboid.m_pOrientation[i][j]);
+   }
+
+   return index;
+}
+
+void C_scene::Set(u32 Index, const C_cuboid& Cuboid)
+{
+   m_Radius[Index] = Cuboid.m_BoundRadius;
+
+   for (int i = 0; i < 3; i++)
+   {
+      m_Center[i][Index] = Cuboid.m_vPosition.data[i];
+      m_Half[i][Index]   = Cuboid.m_pSize[i] * 0.5;
+      m_Extent[i][Index] = Cuboid.m_pAabbExtent[i];
+
+      for (int j = 0; j < 3; j++)
+         m_Axis[i][j][Index] = Cuboid.m_pOrientation[i][j];
+   }
+}
+
+void C_scene::Build()
+{
+   m_BvhNodes.clear();
+   m_BvhItems.clear();
+
+   if (m_Broadphase != BROADPHASE_BVH || Count() == 0)
+      return;
+
+   m_BvhItems.resize(Count());
+   for (u32 i = 0; i < Count(); i++)
+      m_BvhItems[i] = i;
+
+   m_BvhNodes.reserve(2 * Count());
+   m_BvhNodes.push_back(TBvhNode());
+   BuildNode(0, 0, Count());
+}
+
+void C_scene::BuildNode(u32 Node, u32 First, u32 Count)
+{
+   TBvhNode node;
+   f64      cmin[3];
+   f64      cmax[3];
+
+   for (int k = 0; k < 3; k++)
+   {
+      node.Min[k] = cmin[k] =  DBL_MAX;
+      node.Max[k] = cmax[k] = -DBL_MAX;
+   }
+
+   for (u32 i = First; i < First + Count; i++)
+   {
+      u32 item = m_BvhItems[i];
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 c = m_Center[k][item];
+
+         node.Min[k] = std::min(node.Min[k], c - m_Extent[k][item]);
+         node.Max[k] = std::max(node.Max[k], c + m_Extent[k][item]);
+         cmin[k]     = std::min(cmin[k], c);
+         cmax[k]     = std::max(cmax[k], c);
+      }
+   }
+
+   // Split the centroids at the median of their widest axis
+   int axis = 0;
+   for (int k = 1; k < 3; k++)
+      if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+         axis = k;
+
+   if (Count <= BVH_LEAF_SIZE || cmax[axis] - cmin[axis] <= 0.0)
+   {
+      node.First = First;
+      node.Count = Count;
+      m_BvhNodes[Node] = node;
+      return;
+   }
+
+   u32  mid     = First + Count / 2;
+   u32* items   = m_BvhItems.data();
+   const std::vector<f64>& center = m_Center[axis];
+
+   std::nth_element(items + First, items + mid, items + First + Count,
+                    [&center](u32 a, u32 b) { return center[a] < center[b] || (center[a] == center[b] && a < b); });
+
+   u32 child = (u32)m_BvhNodes.size();
+   m_BvhNodes.push_back(TBvhNode());
+   m_BvhNodes.push_back(TBvhNode());
+
+   node.First = child;
+   node.Count = 0;
+   m_BvhNodes[Node] = node;
+
+   BuildNode(child,     First, mid - First);
+   BuildNode(child + 1, mid,   First + Count - mid);
+}
+
+bool C_scene::RayCuboid(u32 Index, const C_vector& From, const C_vector& Delta, f64 TMax, TRayHit& Hit) const
+{
+   f64 rel[3];
+   f64 o[3];
+   f64 d[3];
+   f64 t_near = -DBL_MAX;
+   f64 t_far  =  DBL_MAX;
+   int face   = -1;
+
+   for (int k = 0; k < 3; k++)
+      rel[k] = From.data[k] - m_Center[k][Index];
+
+   // Move the segment into the cuboid's frame
+   for (int k = 0; k < 3; k++)
+   {
+      o[k] = m_Axis[k][0][Index] * rel[0] + m_Axis[k][1][Index] * rel[1] + m_Axis[k][2][Index] * rel[2];
+      d[k] = m_Axis[k][0][Index] * Delta.data[0] + m_Axis[k][1][Index] * Delta.data[1] + m_Axis[k][2][Index] * Delta.data[2];
+   }
+
+   for (int k = 0; k < 3; k++)
+   {
+      f64 h = m_Half[k][Index];
+
+      if (fabs(d[k]) < SCENE_ZERO)
+      {
+         if (fabs(o[k]) > h)
+            return false;
+         continue;
+      }
+
+      f64 t1   = (-h - o[k]) / d[k];
+      f64 t2   = ( h - o[k]) / d[k];
+      int side = 0;
+
+      if (t1 > t2)
+      {
+         std::swap(t1, t2);
+         side = 1;
+      }
+
+      if (t1 > t_near)
+      {
+         t_near = t1;
+         face   = SlabFace[k][side];
+      }
+
+      if (t2 < t_far)
+         t_far = t2;
+
+      if (t_near > t_far)
+         return false;
+   }
+
+   if (t_far < 0.0 || t_near > TMax)
+      return false;
+
+   Hit.Entity = (s32)Index;
+
+   if (t_near < 0.0)
+   {
+      // Segment starts inside the cuboid
+      Hit.Face  = -1;
+      Hit.T     = 0.0;
+      Hit.Point = From;
+   }
+   else
+   {
+      Hit.Face  = face;
+      Hit.T     = t_near;
+      Hit.Point = From + Delta * t_near;
+   }
+
+   return true;
+}
+
+bool C_scene::RayCast(const C_vector& From, const C_vector& To, TRayHit& Hit) const
+{
+   C_vector delta = To - From;
+   TRayHit  hit;
+   f64      best  = 1.0;
+
+   Hit.Entity = -1;
+   Hit.Face   = -1;
+   Hit.T      = 1.0;
+   Hit.Point  = To;
+
+   if (m_Broadphase == BROADPHASE_NONE || m_BvhNodes.empty())
+   {
+      f64 len2 = delta * delta;
+
+      for (u32 i = 0; i < Count(); i++)
+      {
+         // Boundary sphere against the closest point of the segment
+         C_vector c(m_Center[0][i], m_Center[1][i], m_Center[2][i]);
+         C_vector rel = c - From;
+         f64      t   = (len2 > 0.0) ? (rel * delta) / len2 : 0.0;
+
+         t = std::min(1.0, std::max(0.0, t));
+         rel -= delta * t;
+
+         if (rel * rel > m_Radius[i] * m_Radius[i])
+            continue;
+
+         if (RayCuboid(i, From, delta, best, hit) && (Hit.Entity < 0 || hit.T < Hit.T))
+         {
+            Hit  = hit;
+            best = hit.T;
+         }
+      }
+
+      return Hit.Entity >= 0;
+   }
+
+   struct TEntry
+   {
+      u32 Node;
+      f64 T;
+   };
+
+   TEntry stack[BVH_STACK_DEPTH];
+   int    sp = 0;
+   f64    t_enter;
+
+   if (!RayAabb(m_BvhNodes[0], From.data, delta.data, best, t_enter))
+      return false;
+
+   stack[sp++] = { 0, t_enter };
+
+   while (sp > 0)
+   {
+      TEntry entry = stack[--sp];
+
+      // A closer hit was found after this node was pushed
+      if (entry.T > best)
+         continue;
+
+      const TBvhNode& node = m_BvhNodes[entry.Node];
+
+      if (node.Count)
+      {
+         for (u32 i = node.First; i < node.First + node.Count; i++)
+         {
+            u32 item = m_BvhItems[i];
+
+            if (RayCuboid(item, From, delta, best, hit) &&
+                (Hit.Entity < 0 || hit.T < Hit.T || (hit.T == Hit.T && hit.Entity < Hit.Entity)))
+            {
+               Hit  = hit;
+               best = hit.T;
+            }
+         }
+         continue;
+      }
+
+      // Push the farther child first so the nearer one is visited first
+      f64  t0, t1;
+      bool hit0 = RayAabb(m_BvhNodes[node.First],     From.data, delta.data, best, t0);
+      bool hit1 = RayAabb(m_BvhNodes[node.First + 1], From.data, delta.data, best, t1);
+
+      if (hit0 && hit1)
+      {
+         if (t0 <= t1)
+         {
+            stack[sp++] = { node.First + 1, t1 };
+            stack[sp++] = { node.First,     t0 };
+         }
+         else
+         {
+            stack[sp++] = { node.First,     t0 };
+            stack[sp++] = { node.First + 1, t1 };
+         }
+      }
+      else if (hit0)
+      {
+         stack[sp++] = { node.First, t0 };
+      }
+      else if (hit1)
+      {
+         stack[sp++] = { node.First + 1, t1 };
+      }
+   }
+
+   return Hit.Entity >= 0;
+}
+
+u32 C_scene::RayCastPacket(const C_vector* From, const C_vector* To, TRayHit* Hits, u32 Count) const
+{
+   static_assert(RAY_PACKET == 8, "NodeLanesAvx2 covers 8 lanes");
+
+   const u32 lanes = RAY_PACKET;
+
+   u32      hits = 0;
+   C_vector delta[lanes];
+   C_vector mean(0.0);
+   bool     coherent = (Count > 1 && Count <= lanes && m_Broadphase == BROADPHASE_BVH && !m_BvhNodes.empty());
+
+   for (u32 l = 0; coherent && l < Count; l++)
+   {
+      delta[l] = To[l] - From[l];
+
+      f64 len = abs(delta[l]);
+      if (len <= 0.0)
+         coherent = false;
+      else
+         mean += delta[l] / len;
+   }
+
+   if (coherent)
+   {
+      mean = unit(mean);
+
+      for (u32 l = 0; l < Count; l++)
+         if (unit(delta[l]) * mean < RAY_COHERENCE)
+            coherent = false;
+   }
+
+   g_PacketStats.Packets++;
+
+   if (!coherent)
+   {
+      for (u32 l = 0; l < Count; l++)
+         hits += RayCast(From[l], To[l], Hits[l]) ? 1 : 0;
+      return hits;
+   }
+
+   g_PacketStats.Coherent++;
+
+   // Lane arrays, unused lanes get an empty interval so they never hit
+   f64 org[3][lanes];
+   f64 inv[3][lanes];
+   f64 best[lanes];
+
+   for (u32 l = 0; l < lanes; l++)
+   {
+      u32 src = (l < Count) ? l : 0;
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 d = delta[src].data[k];
+
+         if (fabs(d) < SCENE_ZERO)
+            d = (d < 0.0) ? -SCENE_ZERO : SCENE_ZERO;
+
+         org[k][l] = From[src].data[k];
+         inv[k][l] = 1.0 / d;
+      }
+
+      best[l] = (l < Count) ? 1.0 : -1.0;
+
+      if (l < Count)
+      {
+         Hits[l].Entity = -1;
+         Hits[l].Face   = -1;
+         Hits[l].T      = 1.0;
+         Hits[l].Point  = To[l];
+      }
+   }
+
+   // Entry fraction of every lane into a node, > best when the lane misses
+   auto node_lanes = [&](const TBvhNode& Node, f64 Enter[lanes])
+   {
+      if (g_Avx2)
+      {
+         NodeLanesAvx2(Node, org, inv, best, Enter);
+         return;
+      }
+
+      for (u32 l = 0; l < lanes; l++)
+      {
+         f64 t_near = 0.0;
+         f64 t_far  = best[l];
+
+         for (int k = 0; k < 3; k++)
+         {
+            f64 t1 = (Node.Min[k] - org[k][l]) * inv[k][l];
+            f64 t2 = (Node.Max[k] - org[k][l]) * inv[k][l];
+
+            t_near = std::max(t_near, std::min(t1, t2));
+            t_far  = std::min(t_far,  std::max(t1, t2));
+         }
+
+         Enter[l] = (t_near <= t_far) ? t_near : DBL_MAX;
+      }
+   };
+
+   auto packet_enter = [&](const f64 Enter[lanes])
+   {
+      f64 t = DBL_MAX;
+
+      for (u32 l = 0; l < lanes; l++)
+         t = std::min(t, Enter[l]);
+
+      return t;
+   };
+
+   struct TEntry
+   {
+      u32 Node;
+      f64 T;
+   };
+
+   TEntry stack[BVH_STACK_DEPTH];
+   int    sp = 0;
+   f64    enter[lanes];
+   f64    enter1[lanes];
+   TRayHit hit;
+
+   node_lanes(m_BvhNodes[0], enter);
+   if (packet_enter(enter) == DBL_MAX)
+      return 0;
+
+   stack[sp++] = { 0, packet_enter(enter) };
+
+   while (sp > 0)
+   {
+      TEntry entry = stack[--sp];
+      f64    worst = -1.0;
+
+      for (u32 l = 0; l < Count; l++)
+         worst = std::max(worst, best[l]);
+
+      // Every lane already has a hit nearer than this node
+      if (entry.T > worst)
+         continue;
+
+      const TBvhNode& node = m_BvhNodes[entry.Node];
+
+      if (node.Count)
+      {
+         node_lanes(node, enter);
+
+         for (u32 l = 0; l < Count; l++)
+         {
+            if (enter[l] == DBL_MAX)
+               continue;
+
+            for (u32 i = node.First; i < node.First + node.Count; i++)
+            {
+               u32 item = m_BvhItems[i];
+
+               if (RayCuboid(item, From[l], delta[l], best[l], hit) &&
+                   (Hits[l].Entity < 0 || hit.T < Hits[l].T || (hit.T == Hits[l].T && hit.Entity < Hits[l].Entity)))
+               {
+                  Hits[l] = hit;
+                  best[l] = hit.T;
+               }
+            }
+         }
+         continue;
+      }
+
+      node_lanes(m_BvhNodes[node.First],     enter);
+      node_lanes(m_BvhNodes[node.First + 1], enter1);
+
+      f64 t0 = packet_enter(enter);
+      f64 t1 = packet_enter(enter1);
+
+      // Farther child first so the nearer one is popped next
+      if (t0 <= t1)
+      {
+         if (t1 != DBL_MAX) stack[sp++] = { node.First + 1, t1 };
+         if (t0 != DBL_MAX) stack[sp++] = { node.First,     t0 };
+      }
+      else
+      {
+         if (t0 != DBL_MAX) stack[sp++] = { node.First,     t0 };
+         if (t1 != DBL_MAX) stack[sp++] = { node.First + 1, t1 };
+      }
+   }
+
+   for (u32 l = 0; l < Count; l++)
+      hits += (Hits[l].Entity >= 0) ? 1 : 0;
+
+   return hits;
+}
+
+f64 C_scene::PointDistance(u32 Index, const C_vector& Point, C_vector& Closest) const
+{
+   f64 rel[3];
+   f64 dist2 = 0.0;
+
+   for (int k = 0; k < 3; k++)
+      rel[k] = Point.data[k] - m_Center[k][Index];
+
+   Closest = C_vector(m_Center[0][Index], m_Center[1][Index], m_Center[2][Index]);
+
+   // Clamp the local coordinates to the half sizes, then map the clamped
+   // point back to world through the transposed orientation
+   for (int k = 0; k < 3; k++)
+   {
+      f64 h = m_Half[k][Index];
+      f64 o = m_Axis[k][0][Index] * rel[0] + m_Axis[k][1][Index] * rel[1] + m_Axis[k][2][Index] * rel[2];
+      f64 c = std::min(h, std::max(-h, o));
+
+      dist2 += (o - c) * (o - c);
+
+      for (int j = 0; j < 3; j++)
+         Closest.data[j] += m_Axis[k][j][Index] * c;
+   }
+
+   if (dist2 == 0.0)
+      Closest = Point;
+
+   return sqrt(dist2);
+}
+
+u32 C_scene::RangeQuery(const C_vector& Point, f64 Radius, TRangeHit* Hits, u32 Capacity) const
+{
+   u32 found   = 0;
+   f64 radius2 = Radius * Radius;
+
+   // Boundary sphere, world AABB, then the exact distance
+   auto test = [&](u32 i)
+   {
+      f64 d[3];
+      f64 dist2 = 0.0;
+
+      for (int k = 0; k < 3; k++)
+         d[k] = Point.data[k] - m_Center[k][i];
+
+      f64 reach = m_Radius[i] + Radius;
+      if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] > reach * reach)
+         return;
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 out = fabs(d[k]) - m_Extent[k][i];
+         if (out > 0.0)
+            dist2 += out * out;
+      }
+
+      if (dist2 > radius2)
+         return;
+
+      TRangeHit hit;
+      hit.Entity   = (s32)i;
+      hit.Distance = PointDistance(i, Point, hit.Point);
+
+      if (hit.Distance > Radius)
+         return;
+
+      if (found < Capacity)
+         Hits[found] = hit;
+      found++;
+   };
+
+   if (m_Broadphase == BROADPHASE_NONE || m_BvhNodes.empty())
+   {
+      for (u32 i = 0; i < Count(); i++)
+         test(i);
+      return found;
+   }
+
+   u32 stack[BVH_STACK_DEPTH];
+   int sp = 0;
+
+   stack[sp++] = 0;
+
+   while (sp > 0)
+   {
+      const TBvhNode& node  = m_BvhNodes[stack[--sp]];
+      f64             dist2 = 0.0;
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 p = Point.data[k];
+
+         if (p < node.Min[k]) dist2 += (node.Min[k] - p) * (node.Min[k] - p); else
+         if (p > node.Max[k]) dist2 += (p - node.Max[k]) * (p - node.Max[k]);
+      }
+
+      if (dist2 > radius2)
+         continue;
+
+      if (node.Count)
+      {
+         for (u32 i = node.First; i < node.First + node.Count; i++)
+            test(m_BvhItems[i]);
+         continue;
+      }
+
+      stack[sp++] = node.First + 1;
+      stack[sp++] = node.First;
+   }
+
+   return found;
+}
+
+u32 C_scene::RangeQuery(const C_vector& Point, f64 Radius, C_arena& Arena, TRangeHit*& Hits) const
+{
+   u64 capacity;
+
+   Hits = Arena.AllocRest<TRangeHit>(16, capacity);
+
+   u32 found = RangeQuery(Point, Radius, Hits, (u32)std::min<u64>(capacity, 0xFFFFFFFF));
+
+   if (found > capacity)
+   {
+      Hits = Arena.Alloc<TRangeHit>(found);
+      RangeQuery(Point, Radius, Hits, found);
+   }
+   else
+   {
+      Arena.Shrink(Hits, found * sizeof(TRangeHit));
+   }
+
+   return found;
+}
+
+bool C_scene::Nearest(const C_vector& Point, f64 MaxDistance, TRangeHit& Hit) const
+{
+   f64 best = MaxDistance;
+
+   Hit.Entity   = -1;
+   Hit.Distance = MaxDistance;
+   Hit.Point    = Point;
+
+   auto test = [&](u32 i)
+   {
+      f64 d[3];
+      f64 dist2 = 0.0;
+
+      for (int k = 0; k < 3; k++)
+         d[k] = Point.data[k] - m_Center[k][i];
+
+      f64 reach = m_Radius[i] + best;
+      if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] > reach * reach)
+         return;
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 out = fabs(d[k]) - m_Extent[k][i];
+         if (out > 0.0)
+            dist2 += out * out;
+      }
+
+      if (dist2 > best * best)
+         return;
+
+      C_vector closest;
+      f64      dist = PointDistance(i, Point, closest);
+
+      if (dist < best || (dist == best && (Hit.Entity < 0 || (s32)i < Hit.Entity)))
+      {
+         best         = dist;
+         Hit.Entity   = (s32)i;
+         Hit.Distance = dist;
+         Hit.Point    = closest;
+      }
+   };
+
+   if (m_Broadphase == BROADPHASE_NONE || m_BvhNodes.empty())
+   {
+      for (u32 i = 0; i < Count(); i++)
+         test(i);
+      return Hit.Entity >= 0;
+   }
+
+   struct TEntry
+   {
+      u32 Node;
+      f64 Dist2;
+   };
+
+   auto node_dist2 = [&](const TBvhNode& Node)
+   {
+      f64 dist2 = 0.0;
+
+      for (int k = 0; k < 3; k++)
+      {
+         f64 p = Point.data[k];
+
+         if (p < Node.Min[k]) dist2 += (Node.Min[k] - p) * (Node.Min[k] - p); else
+         if (p > Node.Max[k]) dist2 += (p - Node.Max[k]) * (p - Node.Max[k]);
+      }
+
+      return dist2;
+   };
+
+   TEntry stack[BVH_STACK_DEPTH];
+   int    sp = 0;
+
+   stack[sp++] = { 0, node_dist2(m_BvhNodes[0]) };
+
+   while (sp > 0)
+   {
+      TEntry entry = stack[--sp];
+
+      if (entry.Dist2 > best * best)
+         continue;
+
+      const TBvhNode& node = m_BvhNodes[entry.Node];
+
+      if (node.Count)
+      {
+         for (u32 i = node.First; i < node.First + node.Count; i++)
+            test(m_BvhItems[i]);
+         continue;
+      }
+
+      f64 d0 = node_dist2(m_BvhNodes[node.First]);
+      f64 d1 = node_dist2(m_BvhNodes[node.First + 1]);
+
+      // Nearer child on top of the stack
+      if (d0 <= d1)
+      {
+         stack[sp++] = { node.First + 1, d1 };
+         stack[sp++] = { node.First,     d0 };
+      }
+      else
+      {
+         stack[sp++] = { node.First,     d0 };
+         stack[sp++] = { node.First + 1, d1 };
+      }
+   }
+
+   return Hit.Entity >= 0;
+}
+
+void C_scene::GetConvex(u32 Index, TConvex& Convex) const
+{
+   Convex.Shape      = CONVEX_OBB;
+   Convex.Center     = C_vector(m_Center[0][Index], m_Center[1][Index], m_Center[2][Index]);
+   Convex.PointCount = 0;
+
+   for (int k = 0; k < 3; k++)
+   {
+      Convex.Axis[k] = C_vector(m_Axis[k][0][Index], m_Axis[k][1][Index], m_Axis[k][2][Index]);
+      Convex.Half[k] = m_Half[k][Index];
+   }
+}
+
+TPacketStats& C_scene::PacketStats()
+{
+   return g_PacketStats;
+}
+
+void C_scene::ResetPacketStats()
+{
+   g_PacketStats = {};
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <vector>
+#include "Arena.h"
+#include "CommonTypes.h"
+#include "Cuboid.h"
+#include "Gjk.h"
+
+// Which acceleration structure the scene queries traverse
+enum EBroadphase
+{
+   BROADPHASE_NONE, // test every cuboid (boundary sphere early out only)
+   BROADPHASE_BVH   // bounding volume hierarchy over the world AABBs
+};
+
+struct TRayHit
+{
+   s32      Entity; // scene index of the cuboid hit, -1 if nothing was hit
+   s32      Face;   // 1-6 as SphereCollision numbers them, -1 if the segment starts inside
+   f64      T;      // fraction along the segment, 0.0 at the start, 1.0 at the end
+   C_vector Point;  // world contact point
+};
+
+struct TRangeHit
+{
+   s32      Entity;   // scene index of the cuboid
+   f64      Distance; // distance from the query point to the cuboid, 0.0 inside
+   C_vector Point;    // closest point on (or in) the cuboid
+};
+
+struct TBvhNode
+{
+   f64 Min[3];
+   f64 Max[3];
+   u32 First;  // first child for inner nodes, first entry of m_BvhItems for leaves
+   u32 Count;  // 0 for inner nodes, the children are First and First + 1
+};
+
+// Per-thread tally of which path RayCastPacket took
+struct TPacketStats
+{
+   u64 Packets;
+   u64 Coherent;   // walked the BVH as one packet
+};
+
+class C_scene
+{
+public:
+
+   static constexpr u32 BVH_LEAF_SIZE   = 4;
+   static constexpr u32 BVH_STACK_DEPTH = 64;
+   static constexpr u32 RAY_PACKET      = 8;
+   static constexpr f64 RAY_COHERENCE   = 0.996; // cos of the widest packet spread (~5 degrees)
+
+   // Cuboid set, structure of arrays indexed by scene index
+   std::vector<u32> m_Id;          // caller supplied entity id
+   std::vector<f64> m_Center[3];   // world position
+   std::vector<f64> m_Half[3];     // half size along local axis (depth, width, height)
+   std::vector<f64> m_Axis[3][3];  // orientation matrix rows, world to local
+   std::vector<f64> m_Radius;      // boundary sphere radius
+   std::vector<f64> m_Extent[3];   // world AABB half extents
+
+   // Broadphase
+   EBroadphase           m_Broadphase;
+   std::vector<TBvhNode> m_BvhNodes;
+   std::vector<u32>      m_BvhItems;
+
+   C_scene();
+   ~C_scene() = default;
+
+   //! void Clear()
+   //! \details Removes every cuboid and the broadphase built over them.
+   void Clear();
+
+   //! u32 Add(const C_cuboid& Cuboid, u32 Id)
+   //! \details Appends a copy of the cuboid's position, size, orientation and
+   //!          cached bounds. Build() must be called before querying.
+   //! \param[in] Cuboid The cuboid to add.
+   //! \param[in] Id The entity id reported back by queries.
+   //! \return The scene index of the cuboid.
+   u32 Add(const C_cuboid& Cuboid, u32 Id);
+
+   //! void Set(u32 Index, const C_cuboid& Cuboid)
+   //! \details Replaces the position, size, orientation and bounds of one
+   //!          cuboid in place. Build() must be called before querying.
+   void Set(u32 Index, const C_cuboid& Cuboid);
+
+   //! u32 Count()
+   //! \return The number of cuboids in the scene.
+   u32 Count() const { return (u32)m_Id.size(); }
+
+   //! void SetBroadphase(EBroadphase Broadphase)
+   //! \details Selects the broadphase used by the queries, takes effect at the
+   //!          next Build().
+   void SetBroadphase(EBroadphase Broadphase) { m_Broadphase = Broadphase; }
+
+   //! void Build()
+   //! \details Rebuilds the active broadphase over the current cuboid set.
+   void Build();
+
+   //! bool RayCast(const C_vector& From, const C_vector& To, TRayHit& Hit)
+   //! \details Finds the first cuboid crossed by the segment From -> To.
+   //!          The BVH is walked front to back and stops as soon as no node
+   //!          can beat the nearest hit found so far.
+   //! \param[in] From The start of the segment (e.g. previous round position).
+   //! \param[in] To The end of the segment.
+   //! \param[out] Hit The nearest hit, Hit.Entity is -1 when nothing was hit.
+   //! \return true if a cuboid was hit.
+   bool RayCast(const C_vector& From, const C_vector& To, TRayHit& Hit) const;
+
+   //! u32 RayCastPacket(const C_vector* From, const C_vector* To, TRayHit* Hits, u32 Count)
+   //! \details RayCast for up to RAY_PACKET segments at once (e.g. one burst).
+   //!          The segments walk the BVH together, every node test runs the
+   //!          slab test for all lanes at once, with AVX2 when the CPU has it,
+   //!          and a node is skipped once no lane can still improve on its
+   //!          nearest hit. If the directions differ by more than
+   //!          RAY_COHERENCE or the BVH is not active, each segment is cast
+   //!          on its own instead.
+   //! \param[out] Hits One result per segment, same as RayCast.
+   //! \return The number of segments that hit a cuboid.
+   u32 RayCastPacket(const C_vector* From, const C_vector* To, TRayHit* Hits, u32 Count) const;
+
+   //! bool RayCuboid(u32 Index, const C_vector& From, const C_vector& Delta, f64 TMax, TRayHit& Hit)
+   //! \details Exact slab test of the segment From -> From + Delta against
+   //!          one cuboid, only hits closer than TMax are reported.
+   bool RayCuboid(u32 Index, const C_vector& From, const C_vector& Delta, f64 TMax, TRayHit& Hit) const;
+
+   //! u32 RangeQuery(const C_vector& Point, f64 Radius, TRangeHit* Hits, u32 Capacity)
+   //! \details Finds every cuboid within Radius of Point, measured as the
+   //!          exact distance to the oriented cuboid. Candidates come from the
+   //!          active broadphase and are filtered by the boundary sphere and
+   //!          world AABB before the exact test.
+   //! \param[in] Point The query center (e.g. burst point).
+   //! \param[in] Radius The query radius in meters.
+   //! \param[out] Hits Caller owned buffer, filled in traversal order.
+   //! \param[in] Capacity The number of entries Hits can hold.
+   //! \return The number of cuboids in range, which may exceed Capacity (only
+   //!         the first Capacity are written).
+   u32 RangeQuery(const C_vector& Point, f64 Radius, TRangeHit* Hits, u32 Capacity) const;
+
+   //! u32 RangeQuery(const C_vector& Point, f64 Radius, C_arena& Arena, TRangeHit*& Hits)
+   //! \details RangeQuery with the results placed in Arena, so the caller
+   //!          needs no capacity guess. The free tail of the arena's current
+   //!          block is offered first and trimmed to fit, the query only
+   //!          runs twice if the hits do not fit in it.
+   //! \param[out] Hits All the hits, valid until the arena is reset.
+   //! \return The number of hits.
+   u32 RangeQuery(const C_vector& Point, f64 Radius, C_arena& Arena, TRangeHit*& Hits) const;
+
+   //! bool Nearest(const C_vector& Point, f64 MaxDistance, TRangeHit& Hit)
+   //! \details Finds the cuboid closest to Point (exact OBB distance). The BVH
+   //!          is visited nearer child first and pruned by the best distance.
+   //! \param[in] MaxDistance Cuboids farther than this are ignored.
+   //! \param[out] Hit The closest cuboid, Hit.Entity is -1 if none in range.
+   //! \return true if a cuboid was found within MaxDistance.
+   bool Nearest(const C_vector& Point, f64 MaxDistance, TRangeHit& Hit) const;
+
+   //! f64 PointDistance(u32 Index, const C_vector& Point, C_vector& Closest)
+   //! \details Exact distance from Point to one cuboid.
+   //! \param[out] Closest The closest point on the cuboid, Point if inside.
+   //! \return The distance, 0.0 if Point is inside the cuboid.
+   f64 PointDistance(u32 Index, const C_vector& Point, C_vector& Closest) const;
+
+   //! void GetConvex(u32 Index, TConvex& Convex)
+   //! \details Describes one cuboid as a CONVEX_OBB for the GJK queries.
+   void GetConvex(u32 Index, TConvex& Convex) const;
+
+   //! TPacketStats& PacketStats()
+   //! \details Returns the calling thread's RayCastPacket counters.
+   static TPacketStats& PacketStats();
+
+   //! void ResetPacketStats()
+   //! \details Zeroes the calling thread's RayCastPacket counters.
+   static void ResetPacketStats();
+
+private:
+
+   void BuildNode(u32 Node, u32 First, u32 Count);
+};
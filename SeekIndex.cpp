@@ -0,0 +1,199 @@
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "FileUtils.h"
+#include "SeekIndex.h"
+
+C_seekIndex::C_seekIndex()
+   : m_Header()
+{
+}
+
+std::string C_seekIndex::SidecarName(const char* Recording)
+{
+   return std::string(Recording) + ".idx";
+}
+
+bool C_seekIndex::Build(const char* Recording, u32 Stride)
+{
+   C_mappedFile   mapping;
+   TBuffer        file = mapping.Map(Recording);
+   struct stat    Stat;
+   TRecordColumns scratch;
+
+   m_Entries.clear();
+   memset(&m_Header, 0, sizeof(m_Header));
+
+   // A stride of no lines would never move past the first entry
+   if (Stride < 1 || !file.Data || stat(Recording, &Stat) != 0)
+      return false;
+
+   u64 offset  = 0;
+   u64 records = 0;
+
+   while (offset < file.Size)
+   {
+      u64 end = offset;
+
+      for (u32 line = 0; line < Stride && end < file.Size; line++)
+      {
+         const u8* eol = (const u8*)memchr(file.Data + end, '\n', (size_t)(file.Size - end));
+         end = eol ? (u64)(eol - file.Data) + 1 : file.Size;
+      }
+
+      m_Entries.push_back({ records, offset });
+
+      scratch.Clear();
+      records += ParseRecordingColumns(file.Data + offset, end - offset, scratch, nullptr);
+      offset   = end;
+   }
+
+   m_Header.Magic    = SEEK_INDEX_MAGIC;
+   m_Header.Version  = SEEK_INDEX_VERSION;
+   m_Header.Stride   = Stride;
+   m_Header.Entries  = m_Entries.size();
+   m_Header.Records  = records;
+   m_Header.FileSize = file.Size;
+   m_Header.FileTime = (s64)Stat.st_mtime;
+
+   return true;
+}
+
+bool C_seekIndex::Save(const char* Filename) const
+{
+   FILE* file = fopen(Filename, "wb");
+
+   if (!file)
+      return false;
+
+   bool ok = fwrite(&m_Header, sizeof(m_Header), 1, file) == 1 &&
+             fwrite(m_Entries.data(), sizeof(TSeekEntry), m_Entries.size(), file) == m_Entries.size();
+
+   return (fclose(file) == 0) && ok;
+}
+
+bool C_seekIndex::Load(const char* Filename, const char* Recording)
+{
+   FILE*       file = fopen(Filename, "rb");
+   struct stat Stat;
+   struct stat Sidecar;
+
+   m_Entries.clear();
+
+   if (!file)
+      return false;
+
+   // The entry count is checked against the sidecar's length before
+   // anything is allocated for it
+   bool ok = fread(&m_Header, sizeof(m_Header), 1, file) == 1 &&
+             m_Header.Magic == SEEK_INDEX_MAGIC && m_Header.Version == SEEK_INDEX_VERSION && m_Header.Stride >= 1 &&
+             stat(Recording, &Stat) == 0 && fstat(fileno(file), &Sidecar) == 0 &&
+             m_Header.FileSize == (u64)Stat.st_size && m_Header.FileTime == (s64)Stat.st_mtime &&
+             m_Header.Entries <= (u64)Sidecar.st_size / sizeof(TSeekEntry) &&
+             (u64)Sidecar.st_size == sizeof(m_Header) + m_Header.Entries * sizeof(TSeekEntry);
+
+   if (ok)
+   {
+      m_Entries.resize(m_Header.Entries);
+      ok = fread(m_Entries.data(), sizeof(TSeekEntry), m_Entries.size(), file) == m_Entries.size();
+   }
+
+   // Seek and Split search the entries and cut the recording at their
+   // offsets, both must be in order and inside the recording
+   for (u64 e = 0; ok && e < m_Entries.size(); e++)
+   {
+      ok = m_Entries[e].Offset <= m_Header.FileSize && m_Entries[e].Record <= m_Header.Records &&
+           (e == 0 || (m_Entries[e - 1].Offset <= m_Entries[e].Offset && m_Entries[e - 1].Record <= m_Entries[e].Record));
+   }
+
+   fclose(file);
+
+   if (!ok)
+   {
+      m_Entries.clear();
+      memset(&m_Header, 0, sizeof(m_Header));
+   }
+
+   return ok;
+}
+
+u64 C_seekIndex::Seek(u64 Record, u64& Skip) const
+{
+   // Entries of a stride of bad lines share a record count, the last one is
+   // still at or before the record
+   auto after = std::upper_bound(m_Entries.begin(), m_Entries.end(), Record,
+                                 [](u64 Record, const TSeekEntry& Entry) { return Record < Entry.Record; });
+
+   if (after == m_Entries.begin())
+   {
+      Skip = Record;
+      return 0;
+   }
+
+   Skip = Record - (after - 1)->Record;
+   return (after - 1)->Offset;
+}
+
+void C_seekIndex::Split(u64 First, u64 Count, u32 Parts, std::vector<TSeekRange>& Ranges) const
+{
+   Ranges.clear();
+
+   if (Count == 0 || First >= m_Header.Records || m_Entries.empty())
+      return;
+
+   auto record_before = [](u64 Record, const TSeekEntry& Entry) { return Record < Entry.Record; };
+   auto entry_before  = [](const TSeekEntry& Entry, u64 Record) { return Entry.Record < Record; };
+
+   // The last entry at or before First, the first one at or past the end
+   u64 first = (u64)(std::upper_bound(m_Entries.begin(), m_Entries.end(), First, record_before) - m_Entries.begin()) - 1;
+   u64 last  = (u64)(std::lower_bound(m_Entries.begin(), m_Entries.end(), First + Count, entry_before) - m_Entries.begin());
+   u64 spans = last - first;
+
+   Parts = (u32)std::min<u64>(std::max(Parts, 1u), spans);
+
+   for (u32 p = 0; p < Parts; p++)
+   {
+      u64 begin = first + spans * p / Parts;
+      u64 end   = first + spans * (p + 1) / Parts;
+
+      Ranges.push_back({ m_Entries[begin].Offset,
+                         (end < m_Entries.size()) ? m_Entries[end].Offset : m_Header.FileSize,
+                         m_Entries[begin].Record });
+   }
+}
+
+u64 ParseRecordingRange(const C_seekIndex& Index, const u8* Data, u64 Size, u64 First, u64 Count, TRecordColumns& Columns, C_threadPool& Pool)
+{
+   std::vector<TSeekRange> ranges;
+
+   Index.Split(First, Count, Pool.Threads() * 4, ranges);
+
+   std::vector<TRecordColumns> parts(ranges.size());
+
+   Pool.ParallelFor((u32)ranges.size(), 1, [&](u32 Begin, u32 End, u32)
+   {
+      for (u32 r = Begin; r < End; r++)
+         if (ranges[r].Offset < std::min(ranges[r].End, Size))
+            ParseRecordingColumns(Data + ranges[r].Offset, std::min(ranges[r].End, Size) - ranges[r].Offset, parts[r], nullptr);
+   });
+
+   // Keep the rows inside the window, the outer parts overhang it
+   u64 appended = 0;
+
+   for (u64 r = 0; r < ranges.size(); r++)
+   {
+      u64 record = ranges[r].Record;
+      u64 begin  = std::max(First, record);
+      u64 end    = std::min(First + Count, record + parts[r].Count());
+
+      if (end > begin)
+      {
+         Columns.Append(parts[r], begin - record, end - begin);
+         appended += end - begin;
+      }
+   }
+
+   return appended;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CommonTypes.h"
+#include "Recording.h"
+#include "ThreadPool.h"
+
+// Sidecar seek index of a text recording, <recording>.idx. Every Stride
+// lines it holds the byte offset of the line and the number of records
+// (lines that parse) before it. Recordings carry no clock, the record
+// number is the time axis, as in the binary format.
+//
+//   TSeekIndexHeader
+//   TSeekEntry[Entries], Record and Offset both non decreasing
+
+#define SEEK_INDEX_MAGIC   0x58444943 // "CIDX"
+#define SEEK_INDEX_VERSION 1
+
+struct TSeekIndexHeader
+{
+   u32 Magic;
+   u32 Version;
+   u32 Stride;    // lines per entry
+   u32 Reserved;
+   u64 Entries;
+   u64 Records;   // records in the whole recording
+   u64 FileSize;  // of the recording when indexed
+   s64 FileTime;  // its modification time, seconds
+};
+
+struct TSeekEntry
+{
+   u64 Record;    // records before the line
+   u64 Offset;    // byte offset of the line
+};
+
+// A byte range of whole lines and the number of its first record
+struct TSeekRange
+{
+   u64 Offset;
+   u64 End;
+   u64 Record;
+};
+
+class C_seekIndex
+{
+public:
+
+   static constexpr u32 STRIDE = 4096; // lines per entry
+
+   C_seekIndex();
+
+   //! static std::string SidecarName(const char* Recording)
+   //! \return The index file name for a recording.
+   static std::string SidecarName(const char* Recording);
+
+   //! bool Build(const char* Recording, u32 Stride)
+   //! \details Indexes the recording in one pass over a mapping of it. Each
+   //!          stride of lines is counted with ParseRecordingColumns, so
+   //!          record numbers match what the parsers hand out.
+   //! \return false if the recording cannot be read or Stride is 0.
+   bool Build(const char* Recording, u32 Stride = STRIDE);
+
+   //! bool Save(const char* Filename)
+   //! \return false if the index cannot be written.
+   bool Save(const char* Filename) const;
+
+   //! bool Load(const char* Filename, const char* Recording)
+   //! \details Reads an index, which must match the recording's current size
+   //!          and modification time. Its length must match its entry count
+   //!          and the entries must be in order, inside the recording.
+   //! \return false if it is missing, damaged or stale.
+   bool Load(const char* Filename, const char* Recording);
+
+   //! u64 Records()
+   u64 Records() const { return m_Header.Records; }
+
+   //! u64 Entries()
+   u64 Entries() const { return m_Entries.size(); }
+
+   //! u64 Seek(u64 Record, u64& Skip)
+   //! \details Binary searches the last entry at or before Record.
+   //! \param[out] Skip Records to drop after the returned offset before
+   //!             Record is reached, under one stride.
+   //! \return The byte offset to start parsing at.
+   u64 Seek(u64 Record, u64& Skip) const;
+
+   //! void Split(u64 First, u64 Count, u32 Parts, std::vector<TSeekRange>& Ranges)
+   //! \details Cuts the lines holding records [First, First + Count) into
+   //!          up to Parts ranges on entry boundaries. The first range may
+   //!          start before First and the last end after it.
+   //! \param[out] Ranges Replaced, in file order.
+   void Split(u64 First, u64 Count, u32 Parts, std::vector<TSeekRange>& Ranges) const;
+
+private:
+
+   TSeekIndexHeader        m_Header;
+   std::vector<TSeekEntry> m_Entries;
+};
+
+//! u64 ParseRecordingRange(const C_seekIndex& Index, const u8* Data, u64 Size, u64 First, u64 Count, TRecordColumns& Columns, C_threadPool& Pool)
+//! \details Parses only records [First, First + Count) of an indexed
+//!          recording held in memory. The range is split with the index, a
+//!          few parts per worker, and the parts parse on the pool.
+//! \param[out] Columns The records are appended, in file order.
+//! \return The number of records appended.
+u64 ParseRecordingRange(const C_seekIndex& Index, const u8* Data, u64 Size, u64 First, u64 Count, TRecordColumns& Columns, C_threadPool& Pool);
@@ -0,0 +1,348 @@
+
+#include <float.h>
+#include <math.h>
+#include <algorithm>
+#include <thread>
+#include "Sensor.h"
+
+enum ESensorClass
+{
+   SENSOR_OUTSIDE,
+   SENSOR_INSIDE,
+   SENSOR_PARTIAL
+};
+
+// Sphere against the cone, works in the (along axis, off axis) half plane
+static ESensorClass ConeSphere(const TSensorVolume& Volume, const C_vector& Center, f64 Radius)
+{
+   C_vector v     = Center - Volume.Origin;
+   f64      v2    = v * v;
+   f64      along = v * Volume.Forward;
+   f64      perp  = sqrt(std::max(0.0, v2 - along * along));
+
+   if (along - Radius > Volume.Range)
+      return SENSOR_OUTSIDE;
+
+   // Behind the apex the apex itself is the closest point of the cone
+   if (along * Volume.Cos + perp * Volume.Sin < 0.0)
+      return (v2 > Radius * Radius) ? SENSOR_OUTSIDE : SENSOR_PARTIAL;
+
+   // Signed distance to the lateral surface, negative inside
+   f64 side = perp * Volume.Cos - along * Volume.Sin;
+
+   if (side > Radius)
+      return SENSOR_OUTSIDE;
+
+   if (side <= -Radius && along + Radius <= Volume.Range)
+      return SENSOR_INSIDE;
+
+   return SENSOR_PARTIAL;
+}
+
+// Box against the frustum planes, Reach[i] is the box's projected half size
+// on plane i. Exact for rejection against a single plane, conservative overall.
+static ESensorClass FrustumBox(const TSensorVolume& Volume, const C_vector& Center, const f64 Reach[6])
+{
+   bool inside = true;
+
+   for (int i = 0; i < 6; i++)
+   {
+      f64 s = Volume.Normal[i] * Center - Volume.Offset[i];
+
+      if (s < -Reach[i])
+         return SENSOR_OUTSIDE;
+      if (s < Reach[i])
+         inside = false;
+   }
+
+   return inside ? SENSOR_INSIDE : SENSOR_PARTIAL;
+}
+
+void SensorPrepare(const TSensor& Sensor, TSensorVolume& Volume)
+{
+   Volume.Shape   = Sensor.Shape;
+   Volume.Origin  = Sensor.Origin;
+   Volume.Forward = Sensor.Forward;
+   Volume.Range   = Sensor.Range;
+   Volume.Sin     = sin(Sensor.HalfAngleH);
+   Volume.Cos     = cos(Sensor.HalfAngleH);
+
+   TConvex& convex = Volume.Convex;
+   convex.Center     = Sensor.Origin;
+   convex.PointCount = 0;
+
+   for (int k = 0; k < 3; k++)
+   {
+      Volume.Min[k] = Volume.Max[k] = Sensor.Origin.data[k];
+      convex.Axis[k] = C_vector(0.0);
+      convex.Half[k] = 0.0;
+   }
+
+   if (Sensor.Shape == SENSOR_CONE)
+   {
+      f64      radius = Sensor.Range * tan(Sensor.HalfAngleH);
+      C_vector base   = Sensor.Origin + Sensor.Forward * Sensor.Range;
+
+      convex.Shape   = CONVEX_CONE;
+      convex.Axis[0] = Sensor.Forward;
+      convex.Half[0] = Sensor.Range;
+      convex.Half[1] = radius;
+
+      // The base disk reaches radius * sin(angle between its normal and axis k)
+      for (int k = 0; k < 3; k++)
+      {
+         f64 f   = Sensor.Forward.data[k];
+         f64 ext = radius * sqrt(std::max(0.0, 1.0 - f * f));
+
+         Volume.Min[k] = std::min(Volume.Min[k], base.data[k] - ext);
+         Volume.Max[k] = std::max(Volume.Max[k], base.data[k] + ext);
+      }
+      return;
+   }
+
+   C_vector forward = Sensor.Forward;
+   C_vector up      = Sensor.Up;
+   C_vector right   = cross(forward, up);
+   f64      sh      = sin(Sensor.HalfAngleH);
+   f64      ch      = cos(Sensor.HalfAngleH);
+   f64      sv      = sin(Sensor.HalfAngleV);
+   f64      cv      = cos(Sensor.HalfAngleV);
+
+   Volume.Normal[0] = forward;
+   Volume.Offset[0] = forward * Sensor.Origin + Sensor.Near;
+   Volume.Normal[1] = forward * -1.0;
+   Volume.Offset[1] = -(forward * Sensor.Origin + Sensor.Range);
+   Volume.Normal[2] = forward * sh - right * ch;
+   Volume.Normal[3] = forward * sh + right * ch;
+   Volume.Normal[4] = forward * sv - up * cv;
+   Volume.Normal[5] = forward * sv + up * cv;
+
+   for (int i = 2; i < 6; i++)
+      Volume.Offset[i] = Volume.Normal[i] * Sensor.Origin;
+
+   convex.Shape = CONVEX_HULL;
+
+   for (int d = 0; d < 2; d++)
+   {
+      f64 dist = d ? Sensor.Range : Sensor.Near;
+
+      for (int c = 0; c < 4; c++)
+      {
+         f64      s = (c & 1) ? 1.0 : -1.0;
+         f64      t = (c & 2) ? 1.0 : -1.0;
+         C_vector p = Sensor.Origin + (forward + right * (s * sh / ch) + up * (t * sv / cv)) * dist;
+
+         convex.Points[convex.PointCount++] = p;
+
+         for (int k = 0; k < 3; k++)
+         {
+            Volume.Min[k] = std::min(Volume.Min[k], p.data[k]);
+            Volume.Max[k] = std::max(Volume.Max[k], p.data[k]);
+         }
+      }
+   }
+}
+
+u32 SensorQuery(const C_scene& Scene, const TSensorVolume& Volume, s32* Hits, u32 Capacity, TSensorStats* Stats)
+{
+   TSensorStats stats = {};
+   u32          found = 0;
+   TConvex      box;
+
+   auto test = [&](u32 i)
+   {
+      C_vector     center(Scene.m_Center[0][i], Scene.m_Center[1][i], Scene.m_Center[2][i]);
+      ESensorClass result;
+
+      stats.Candidates++;
+
+      for (int k = 0; k < 3; k++)
+      {
+         if (center.data[k] + Scene.m_Extent[k][i] < Volume.Min[k] ||
+             center.data[k] - Scene.m_Extent[k][i] > Volume.Max[k])
+         {
+            stats.Rejected++;
+            return;
+         }
+      }
+
+      if (Volume.Shape == SENSOR_CONE)
+      {
+         result = ConeSphere(Volume, center, Scene.m_Radius[i]);
+      }
+      else
+      {
+         f64 reach[6];
+
+         for (int p = 0; p < 6; p++)
+         {
+            const C_vector& n = Volume.Normal[p];
+
+            reach[p] = 0.0;
+            for (int k = 0; k < 3; k++)
+               reach[p] += Scene.m_Half[k][i] * fabs(n.data[0] * Scene.m_Axis[k][0][i] +
+                                                     n.data[1] * Scene.m_Axis[k][1][i] +
+                                                     n.data[2] * Scene.m_Axis[k][2][i]);
+         }
+
+         result = FrustumBox(Volume, center, reach);
+      }
+
+      if (result == SENSOR_OUTSIDE)
+      {
+         stats.Rejected++;
+         return;
+      }
+
+      if (result == SENSOR_PARTIAL)
+      {
+         stats.Exact++;
+         Scene.GetConvex(i, box);
+
+         if (!GjkIntersect(box, Volume.Convex))
+            return;
+
+         stats.ExactHits++;
+      }
+      else
+      {
+         stats.Accepted++;
+      }
+
+      if (found < Capacity)
+         Hits[found] = (s32)i;
+      found++;
+   };
+
+   if (Scene.m_Broadphase == BROADPHASE_NONE || Scene.m_BvhNodes.empty())
+   {
+      for (u32 i = 0; i < Scene.Count(); i++)
+         test(i);
+   }
+   else
+   {
+      u32 stack[C_scene::BVH_STACK_DEPTH];
+      int sp = 0;
+
+      stack[sp++] = 0;
+
+      while (sp > 0)
+      {
+         const TBvhNode& node = Scene.m_BvhNodes[stack[--sp]];
+         bool            cull = false;
+         C_vector        center;
+         f64             half[3];
+
+         for (int k = 0; k < 3; k++)
+         {
+            if (node.Max[k] < Volume.Min[k] || node.Min[k] > Volume.Max[k])
+               cull = true;
+
+            center.data[k] = (node.Min[k] + node.Max[k]) * 0.5;
+            half[k]        = (node.Max[k] - node.Min[k]) * 0.5;
+         }
+
+         if (!cull)
+         {
+            if (Volume.Shape == SENSOR_CONE)
+            {
+               cull = ConeSphere(Volume, center, sqrt(half[0] * half[0] + half[1] * half[1] + half[2] * half[2])) == SENSOR_OUTSIDE;
+            }
+            else
+            {
+               f64 reach[6];
+
+               for (int p = 0; p < 6; p++)
+                  reach[p] = fabs(Volume.Normal[p].data[0]) * half[0] +
+                             fabs(Volume.Normal[p].data[1]) * half[1] +
+                             fabs(Volume.Normal[p].data[2]) * half[2];
+
+               cull = FrustumBox(Volume, center, reach) == SENSOR_OUTSIDE;
+            }
+         }
+
+         if (cull)
+            continue;
+
+         if (node.Count)
+         {
+            for (u32 i = node.First; i < node.First + node.Count; i++)
+               test(Scene.m_BvhItems[i]);
+            continue;
+         }
+
+         stack[sp++] = node.First + 1;
+         stack[sp++] = node.First;
+      }
+   }
+
+   if (Stats)
+   {
+      Stats->Candidates += stats.Candidates;
+      Stats->Rejected   += stats.Rejected;
+      Stats->Accepted   += stats.Accepted;
+      Stats->Exact      += stats.Exact;
+      Stats->ExactHits  += stats.ExactHits;
+   }
+
+   return found;
+}
+
+void SensorQueryBatch(const C_scene& Scene, const TSensor* Sensors, u32 Count, std::vector<TSensorHit>& Hits, u32 Threads, TSensorStats* Stats)
+{
+   if (Threads == 0)
+      Threads = std::max(1u, std::thread::hardware_concurrency());
+   if (Threads > Count)
+      Threads = std::max(1u, Count);
+
+   std::vector<std::vector<TSensorHit>> hits(Threads);
+   std::vector<TSensorStats>            stats(Threads, TSensorStats());
+   std::vector<std::thread>             workers;
+
+   auto run = [&](u32 Worker)
+   {
+      u32              first = (u32)((u64)Count * Worker / Threads);
+      u32              last  = (u32)((u64)Count * (Worker + 1) / Threads);
+      std::vector<s32> scratch(64);
+      TSensorVolume    volume;
+
+      for (u32 s = first; s < last; s++)
+      {
+         SensorPrepare(Sensors[s], volume);
+
+         u32 found = SensorQuery(Scene, volume, scratch.data(), (u32)scratch.size(), &stats[Worker]);
+
+         // Rerun into a buffer that fits, rare for narrow sensors
+         if (found > scratch.size())
+         {
+            scratch.resize(found);
+            SensorQuery(Scene, volume, scratch.data(), found, nullptr);
+         }
+
+         for (u32 i = 0; i < found; i++)
+            hits[Worker].push_back({ s, scratch[i] });
+      }
+   };
+
+   for (u32 t = 1; t < Threads; t++)
+      workers.emplace_back(run, t);
+   run(0);
+
+   for (std::thread& worker : workers)
+      worker.join();
+
+   Hits.clear();
+   for (u32 t = 0; t < Threads; t++)
+   {
+      Hits.insert(Hits.end(), hits[t].begin(), hits[t].end());
+
+      if (Stats)
+      {
+         Stats->Candidates += stats[t].Candidates;
+         Stats->Rejected   += stats[t].Rejected;
+         Stats->Accepted   += stats[t].Accepted;
+         Stats->Exact      += stats[t].Exact;
+         Stats->ExactHits  += stats[t].ExactHits;
+      }
+   }
+}
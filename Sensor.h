@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include "CommonTypes.h"
+#include "Scene.h"
+
+enum ESensorShape
+{
+   SENSOR_CONE,   // circular cone of HalfAngleH, flat base at Range
+   SENSOR_FRUSTUM // pyramid of HalfAngleH x HalfAngleV, cut at Near and Range
+};
+
+struct TSensor
+{
+   ESensorShape Shape;
+   C_vector     Origin;     // observer position
+   C_vector     Forward;    // unit boresight
+   C_vector     Up;         // unit, orthogonal to Forward (frustum only)
+   f64          HalfAngleH; // cone half angle, frustum horizontal half angle (radians, < PI/2)
+   f64          HalfAngleV; // frustum vertical half angle (radians, < PI/2)
+   f64          Near;       // frustum near distance along Forward
+   f64          Range;      // far distance along Forward
+};
+
+struct TSensorHit
+{
+   u32 Sensor; // index into the batch
+   s32 Entity; // scene index of the cuboid in view
+};
+
+// Which stage settled each cuboid that survived the broadphase
+struct TSensorStats
+{
+   u64 Candidates; // cuboids returned by the broadphase
+   u64 Rejected;   // conservatively outside
+   u64 Accepted;   // conservatively inside
+   u64 Exact;      // needed the GJK test
+   u64 ExactHits;  // of which intersect
+};
+
+// A sensor with its derived planes, bounds and GJK shape
+struct TSensorVolume
+{
+   ESensorShape Shape;
+   C_vector     Origin;
+   C_vector     Forward;
+   f64          Sin;       // cone half angle
+   f64          Cos;
+   f64          Range;
+   C_vector     Normal[6]; // frustum planes, pointing inwards
+   f64          Offset[6];
+   f64          Min[3];    // world AABB of the volume
+   f64          Max[3];
+   TConvex      Convex;
+};
+
+//! void SensorPrepare(const TSensor& Sensor, TSensorVolume& Volume)
+//! \details Derives the planes, bounds and convex shape used by SensorQuery.
+void SensorPrepare(const TSensor& Sensor, TSensorVolume& Volume);
+
+//! u32 SensorQuery(const C_scene& Scene, const TSensorVolume& Volume, s32* Hits, u32 Capacity, TSensorStats* Stats)
+//! \details Finds every cuboid intersecting the sensor volume. The BVH (if
+//!          active) culls nodes outside the volume, each candidate is then
+//!          classified by its boundary sphere and, for frustums, the exact
+//!          OBB/plane test. Only cuboids left straddling the boundary run GJK.
+//! \param[out] Hits Caller owned buffer of scene indices, in traversal order.
+//! \param[in] Capacity The number of entries Hits can hold.
+//! \param[in,out] Stats Optional stage counters, accumulated.
+//! \return The number of cuboids in view, which may exceed Capacity.
+u32 SensorQuery(const C_scene& Scene, const TSensorVolume& Volume, s32* Hits, u32 Capacity, TSensorStats* Stats);
+
+//! void SensorQueryBatch(const C_scene& Scene, const TSensor* Sensors, u32 Count, std::vector<TSensorHit>& Hits, u32 Threads, TSensorStats* Stats)
+//! \details Runs SensorQuery for every sensor, splitting the sensors into
+//!          contiguous ranges over Threads threads (0 uses every core).
+//! \param[out] Hits Replaced with the hits ordered by sensor index.
+//! \param[in,out] Stats Optional stage counters, accumulated.
+void SensorQueryBatch(const C_scene& Scene, const TSensor* Sensors, u32 Count, std::vector<TSensorHit>& Hits, u32 Threads, TSensorStats* Stats);
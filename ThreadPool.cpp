@@ -0,0 +1,141 @@
+
+#include <algorithm>
+#include "ThreadPool.h"
+
+C_threadPool::C_threadPool(u32 Threads)
+   : m_Threads(Threads ? Threads : std::max(1u, std::thread::hardware_concurrency())),
+     m_Queues(new TQueue[m_Threads]),
+     m_Generation(0),
+     m_Active(0),
+     m_Stop(false),
+     m_Remaining(0)
+{
+   for (u32 w = 1; w < m_Threads; w++)
+      m_Workers.emplace_back(&C_threadPool::WorkerMain, this, w);
+}
+
+C_threadPool::~C_threadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+      m_Stop = true;
+   }
+
+   m_Wake.notify_all();
+
+   for (std::thread& worker : m_Workers)
+      worker.join();
+}
+
+bool C_threadPool::Pop(u32 Worker, TChunk& Chunk)
+{
+   // Own deque first, newest chunk (still warm in cache)
+   {
+      TQueue&                     queue = m_Queues[Worker];
+      std::lock_guard<std::mutex> lock(queue.Lock);
+
+      if (!queue.Chunks.empty())
+      {
+         Chunk = queue.Chunks.back();
+         queue.Chunks.pop_back();
+         return true;
+      }
+   }
+
+   // Steal the oldest chunk of the next busy worker
+   for (u32 i = 1; i < m_Threads; i++)
+   {
+      TQueue&                     victim = m_Queues[(Worker + i) % m_Threads];
+      std::lock_guard<std::mutex> lock(victim.Lock);
+
+      if (!victim.Chunks.empty())
+      {
+         Chunk = victim.Chunks.front();
+         victim.Chunks.pop_front();
+         return true;
+      }
+   }
+
+   return false;
+}
+
+void C_threadPool::Drain(u32 Worker)
+{
+   TChunk chunk;
+
+   while (Pop(Worker, chunk))
+   {
+      (*chunk.Body)(chunk.Begin, chunk.End, Worker);
+      m_Remaining.fetch_sub(1, std::memory_order_acq_rel);
+   }
+}
+
+void C_threadPool::WorkerMain(u32 Worker)
+{
+   u64 seen = 0;
+
+   for (;;)
+   {
+      std::unique_lock<std::mutex> lock(m_Lock);
+      m_Wake.wait(lock, [&] { return m_Stop || m_Generation != seen; });
+
+      if (m_Stop)
+         return;
+
+      seen = m_Generation;
+      m_Active++;
+      lock.unlock();
+
+      Drain(Worker);
+
+      lock.lock();
+      if (--m_Active == 0)
+         m_Done.notify_all();
+   }
+}
+
+void C_threadPool::ParallelFor(u32 Count, u32 Grain, const TBody& Body)
+{
+   if (Count == 0)
+      return;
+
+   if (Grain == 0)
+      Grain = 1;
+
+   u32 chunks = (Count + Grain - 1) / Grain;
+
+   if (m_Threads == 1 || chunks == 1)
+   {
+      for (u32 begin = 0; begin < Count; begin += Grain)
+         Body(begin, std::min(Count, begin + Grain), 0);
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(m_Lock);
+
+      m_Remaining.store(chunks, std::memory_order_relaxed);
+
+      // Deal contiguous runs of chunks so neighbouring shots stay together
+      for (u32 w = 0; w < m_Threads; w++)
+      {
+         TQueue&                     queue = m_Queues[w];
+         std::lock_guard<std::mutex> queue_lock(queue.Lock);
+         u32                         first = (u32)((u64)chunks * w / m_Threads);
+         u32                         last  = (u32)((u64)chunks * (w + 1) / m_Threads);
+
+         // Pushed in reverse so the owner pops them in ascending order
+         for (u32 c = last; c-- > first; )
+            queue.Chunks.push_back({ c * Grain, std::min(Count, (c + 1) * Grain), &Body });
+      }
+
+      m_Generation++;
+   }
+
+   m_Wake.notify_all();
+
+   Drain(0);
+
+   std::unique_lock<std::mutex> lock(m_Lock);
+   m_Done.wait(lock, [&] { return m_Active == 0 && m_Remaining.load(std::memory_order_acquire) == 0; });
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CommonTypes.h"
+
+// Work stealing pool: each worker owns a deque of chunks, pops its own work
+// from the back and steals from the front of the other workers' deques
+class C_threadPool
+{
+public:
+
+   typedef std::function<void(u32 Begin, u32 End, u32 Worker)> TBody;
+
+   //! Constructor C_threadPool(u32 Threads)
+   //! \details Starts Threads - 1 workers, the thread calling ParallelFor is
+   //!          worker 0. Threads 0 uses every core.
+   C_threadPool(u32 Threads = 0);
+   ~C_threadPool();
+
+   //! u32 Threads()
+   //! \return The number of workers, including the calling thread.
+   u32 Threads() const { return m_Threads; }
+
+   //! void ParallelFor(u32 Count, u32 Grain, const TBody& Body)
+   //! \details Runs Body over [0, Count) in chunks of at most Grain items and
+   //!          returns once every chunk has run. Chunks are dealt to the
+   //!          workers' deques in contiguous runs, idle workers steal.
+   //! \param[in] Worker passed to Body is in [0, Threads()), for per-worker
+   //!            scratch or counters.
+   void ParallelFor(u32 Count, u32 Grain, const TBody& Body);
+
+private:
+
+   struct TChunk
+   {
+      u32          Begin;
+      u32          End;
+      const TBody* Body;
+   };
+
+   struct alignas(64) TQueue
+   {
+      std::mutex         Lock;
+      std::deque<TChunk> Chunks;
+   };
+
+   bool Pop(u32 Worker, TChunk& Chunk);
+   void Drain(u32 Worker);
+   void WorkerMain(u32 Worker);
+
+   u32                       m_Threads;
+   std::unique_ptr<TQueue[]> m_Queues;
+   std::vector<std::thread>  m_Workers;
+
+   std::mutex                m_Lock;
+   std::condition_variable   m_Wake;
+   std::condition_variable   m_Done;
+   u64                       m_Generation;
+   u32                       m_Active;
+   bool                      m_Stop;
+   std::atomic<u32>          m_Remaining;
+};
@@ -0,0 +1,120 @@
+
+#include "World.h"
+
+C_world::C_world()
+   : m_Current(new TWorldSnapshot()),
+     m_Version(0),
+     m_Epoch(1),
+     m_Reclaimed(0)
+{
+   m_Current.load()->Version = 0;
+
+   for (u32 i = 0; i < MAX_READERS; i++)
+   {
+      m_Readers[i].Epoch.store(0);
+      m_Readers[i].InUse.store(false);
+   }
+}
+
+C_world::~C_world()
+{
+   for (TRetired& retired : m_Retired)
+      delete retired.Snapshot;
+
+   delete m_Current.load();
+}
+
+s32 C_world::RegisterReader()
+{
+   for (u32 i = 0; i < MAX_READERS; i++)
+   {
+      bool expected = false;
+
+      if (m_Readers[i].InUse.compare_exchange_strong(expected, true))
+         return (s32)i;
+   }
+
+   return -1;
+}
+
+void C_world::UnregisterReader(s32 Reader)
+{
+   m_Readers[Reader].Epoch.store(0);
+   m_Readers[Reader].InUse.store(false);
+}
+
+const TWorldSnapshot* C_world::Acquire(s32 Reader)
+{
+   // Announce the epoch before reading the pointer (both sequentially
+   // consistent), a writer that misses the announcement has already swapped
+   m_Readers[Reader].Epoch.store(m_Epoch.load());
+   return m_Current.load();
+}
+
+void C_world::Release(s32 Reader)
+{
+   m_Readers[Reader].Epoch.store(0, std::memory_order_release);
+}
+
+TWorldSnapshot* C_world::BeginUpdate()
+{
+   m_WriteLock.lock();
+
+   const TWorldSnapshot* current = m_Current.load(std::memory_order_acquire);
+   TWorldSnapshot*       next    = new TWorldSnapshot(*current);
+
+   next->Version = current->Version + 1;
+   return next;
+}
+
+void C_world::Publish(TWorldSnapshot* Next)
+{
+   Next->Scene.Build();
+
+   TWorldSnapshot* previous = m_Current.exchange(Next);
+
+   m_Version.store(Next->Version, std::memory_order_release);
+
+   // Readers that announce a later epoch are guaranteed to see Next
+   m_Retired.push_back({ previous, m_Epoch.fetch_add(1) });
+
+   ReclaimRetired();
+   m_WriteLock.unlock();
+}
+
+u32 C_world::Reclaim()
+{
+   std::lock_guard<std::mutex> lock(m_WriteLock);
+   return ReclaimRetired();
+}
+
+u32 C_world::ReclaimRetired()
+{
+   u64 oldest = UINT64_MAX;
+
+   for (u32 i = 0; i < MAX_READERS; i++)
+   {
+      u64 epoch = m_Readers[i].Epoch.load();
+
+      if (epoch && epoch < oldest)
+         oldest = epoch;
+   }
+
+   u32 kept = 0;
+
+   for (TRetired& retired : m_Retired)
+   {
+      if (retired.Epoch < oldest)
+      {
+         delete retired.Snapshot;
+         m_Reclaimed++;
+      }
+      else
+      {
+         m_Retired[kept++] = retired;
+      }
+   }
+
+   m_Retired.resize(kept);
+   return kept;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "CommonTypes.h"
+#include "Scene.h"
+
+// One immutable version of the world, queried by any number of readers
+struct TWorldSnapshot
+{
+   u64     Version;
+   C_scene Scene;
+};
+
+// Read-copy-update world: the writer builds the next snapshot (cuboid set and
+// broadphase) off to the side and publishes it with one atomic pointer swap.
+// Readers pin the current snapshot by announcing the epoch they entered in,
+// old snapshots are freed once no reader can still be using them.
+class C_world
+{
+public:
+
+   static constexpr u32 MAX_READERS = 64;
+
+   C_world();
+   ~C_world();
+
+   /***********
+    * Readers *
+    ***********/
+
+   //! s32 RegisterReader()
+   //! \details Claims a reader slot, one per querying thread.
+   //! \return The slot, or -1 if all MAX_READERS slots are taken.
+   s32 RegisterReader();
+
+   //! void UnregisterReader(s32 Reader)
+   void UnregisterReader(s32 Reader);
+
+   //! const TWorldSnapshot* Acquire(s32 Reader)
+   //! \details Pins and returns the current snapshot. Never blocks, the
+   //!          snapshot stays valid and unchanged until Release().
+   const TWorldSnapshot* Acquire(s32 Reader);
+
+   //! void Release(s32 Reader)
+   //! \details Unpins the snapshot returned by the last Acquire().
+   void Release(s32 Reader);
+
+   /**********
+    * Writer *
+    **********/
+
+   //! TWorldSnapshot* BeginUpdate()
+   //! \details Locks out other writers and returns a private copy of the
+   //!          current snapshot to modify (C_scene::Set / Add).
+   TWorldSnapshot* BeginUpdate();
+
+   //! void Publish(TWorldSnapshot* Next)
+   //! \details Rebuilds the broadphase of Next, makes it the current
+   //!          snapshot and retires the previous one. Unlocks writers.
+   void Publish(TWorldSnapshot* Next);
+
+   //! u32 Reclaim()
+   //! \details Frees retired snapshots no reader can still hold. Publish()
+   //!          does this itself, call it when updates pause for a while.
+   //! \return The number of snapshots still waiting for readers.
+   u32 Reclaim();
+
+   //! u64 Version()
+   //! \details Safe from any thread without a reader slot, the snapshot
+   //!          itself may be freed as soon as it is replaced.
+   //! \return The version of the current snapshot.
+   u64 Version() const { return m_Version.load(std::memory_order_acquire); }
+
+   //! u64 Reclaimed()
+   //! \return The number of snapshots freed so far.
+   u64 Reclaimed() const { return m_Reclaimed.load(std::memory_order_relaxed); }
+
+private:
+
+   u32 ReclaimRetired();
+
+   struct alignas(64) TReaderSlot
+   {
+      std::atomic<u64>  Epoch; // 0 when not inside Acquire/Release
+      std::atomic<bool> InUse;
+   };
+
+   struct TRetired
+   {
+      TWorldSnapshot* Snapshot;
+      u64             Epoch;
+   };
+
+   std::atomic<TWorldSnapshot*> m_Current;
+   std::atomic<u64>             m_Version;   // of m_Current, readable without pinning it
+   std::atomic<u64>             m_Epoch;
+   TReaderSlot                  m_Readers[MAX_READERS];
+
+   std::mutex                   m_WriteLock;
+   std::vector<TRetired>        m_Retired;
+   std::atomic<u64>             m_Reclaimed;
+};
@@ -0,0 +1,1867 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <thread>
+#include <vector>
+
+#include "CommonTypes.h"
+#include "FileUtils.cpp"
+#include "AsyncReader.cpp"
+#include "Arena.cpp"
+#include "Vector.cpp"
+#include "Cuboid.cpp"
+#include "Scene.cpp"
+#include "Gjk.cpp"
+#include "Sensor.cpp"
+#include "Proximity.cpp"
+#include "ThreadPool.cpp"
+#include "BatchEngine.cpp"
+#include "RingQueue.h"
+#include "World.cpp"
+#include "Kinetic.cpp"
+#include "Ccd.cpp"
+#include "AsyncScorer.cpp"
+#include "Recording.cpp"
+#include "BlockCodec.cpp"
+#include "RecordingFile.cpp"
+#include "RecordingTail.cpp"
+#include "Replay.cpp"
+#include "SeekIndex.cpp"
+
+// Headless benchmarks of the collision queries, run as: bench <name> [count]
+
+using bench_clock = std::chrono::steady_clock;
+
+static f64 SecondsSince(bench_clock::time_point Start)
+{
+   return std::chrono::duration<f64>(bench_clock::now() - Start).count();
+}
+
+// Hardware cache and TLB miss counters of the calling thread (and threads
+// it starts), unavailable counters read as -1
+struct TPerfCounters
+{
+   static constexpr int COUNTERS = 3;
+
+   int Fd[COUNTERS];
+
+   void Open()
+   {
+      static const u64 configs[COUNTERS][2] =
+      {
+         { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+         { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+         { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+      };
+
+      for (int i = 0; i < COUNTERS; i++)
+      {
+         struct perf_event_attr attr;
+
+         memset(&attr, 0, sizeof(attr));
+         attr.size           = sizeof(attr);
+         attr.type           = (u32)configs[i][0];
+         attr.config         = configs[i][1];
+         attr.disabled       = 1;
+         attr.inherit        = 1;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv     = 1;
+
+         Fd[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+      }
+   }
+
+   void Start()
+   {
+      for (int i = 0; i < COUNTERS; i++)
+      {
+         if (Fd[i] >= 0)
+         {
+            ioctl(Fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(Fd[i], PERF_EVENT_IOC_ENABLE, 0);
+         }
+      }
+   }
+
+   void Stop(s64 Values[COUNTERS])
+   {
+      for (int i = 0; i < COUNTERS; i++)
+      {
+         Values[i] = -1;
+
+         if (Fd[i] >= 0)
+         {
+            ioctl(Fd[i], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(Fd[i], &Values[i], sizeof(Values[i])) != sizeof(Values[i]))
+               Values[i] = -1;
+         }
+      }
+   }
+
+   void Close()
+   {
+      for (int i = 0; i < COUNTERS; i++)
+         if (Fd[i] >= 0)
+            close(Fd[i]);
+   }
+};
+
+// Deterministic uniform in [-Range, Range]
+static f64 Random(u64& State, f64 Range)
+{
+   State = State * 6364136223846793005ULL + 1442695040888963407ULL;
+   return Range * ((f64)(State >> 11) / (f64)(1ULL << 53) * 2.0 - 1.0);
+}
+
+// Vehicle sized cuboids scattered over a square exercise area
+static void BuildScene(C_scene& Scene, u32 Count, f64 Area, u64 Seed)
+{
+   u64 state = Seed;
+
+   Scene.Clear();
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      C_vector pos(Random(state, Area), Random(state, Area), -7.5 + Random(state, 2.0));
+      C_cuboid entity(pos, 3.0 + Random(state, 1.0), 3.0 + Random(state, 1.0), 8.0 + Random(state, 3.0));
+
+      entity.SetYaw_D(Random(state, 180.0));
+      Scene.Add(entity, 10000 + i);
+   }
+
+   Scene.Build();
+}
+
+static void BenchRange(u32 Count)
+{
+   const u32 queries  = 10000;
+   const f64 area     = 10000.0;
+   const f64 radius   = 50.0;
+   const u32 capacity = 4096;
+
+   C_scene   scene;
+   TRangeHit hits[capacity];
+   u64       state = 7;
+
+   auto start = bench_clock::now();
+   BuildScene(scene, Count, area, 1);
+   printf("range: %u cuboids, BVH built in %.3f s (%zu nodes)\n", Count, SecondsSince(start), scene.m_BvhNodes.size());
+
+   std::vector<C_vector> points(queries);
+   for (u32 i = 0; i < queries; i++)
+      points[i] = C_vector(Random(state, area), Random(state, area), -7.5);
+
+   for (int pass = 0; pass < 2; pass++)
+   {
+      EBroadphase broadphase = pass ? BROADPHASE_NONE : BROADPHASE_BVH;
+      u64         found      = 0;
+
+      scene.SetBroadphase(broadphase);
+      scene.Build();
+
+      start = bench_clock::now();
+      for (u32 i = 0; i < queries; i++)
+         found += scene.RangeQuery(points[i], radius, hits, capacity);
+      f64 seconds = SecondsSince(start);
+
+      printf("range: %-4s %u queries of %.0f m, %.2f us/query, %.2f hits/query\n",
+             pass ? "none" : "bvh", queries, radius, seconds * 1e6 / queries, (f64)found / queries);
+   }
+}
+
+static void BenchSensor(u32 Count)
+{
+   const u32 sensors = 4000;
+   const f64 area    = 10000.0;
+
+   C_scene                 scene;
+   std::vector<TSensor>    batch(sensors);
+   std::vector<TSensorHit> hits;
+   u64                     state = 11;
+
+   BuildScene(scene, Count, area, 1);
+
+   // Half cones, half frustums, looking roughly level
+   for (u32 i = 0; i < sensors; i++)
+   {
+      TSensor& sensor = batch[i];
+      f64      hdg    = Random(state, 3.14159);
+
+      sensor.Shape      = (i & 1) ? SENSOR_FRUSTUM : SENSOR_CONE;
+      sensor.Origin     = C_vector(Random(state, area), Random(state, area), -10.0);
+      sensor.Forward    = C_vector(cos(hdg), sin(hdg), 0.0);
+      sensor.Up         = C_vector(0.0, 0.0, 1.0);
+      sensor.HalfAngleH = 0.35;
+      sensor.HalfAngleV = 0.15;
+      sensor.Near       = 1.0;
+      sensor.Range      = 500.0;
+   }
+
+   u32 cores = std::max(1u, std::thread::hardware_concurrency());
+
+   for (u32 threads = 1; threads <= cores; threads *= 2)
+   {
+      TSensorStats stats = {};
+
+      auto start = bench_clock::now();
+      SensorQueryBatch(scene, batch.data(), sensors, hits, threads, &stats);
+      f64 seconds = SecondsSince(start);
+
+      printf("sensor: %u cuboids, %u sensors, %u threads, %.3f ms, %.1f hits/sensor\n",
+             Count, sensors, threads, seconds * 1e3, (f64)hits.size() / sensors);
+      printf("sensor:   candidates %llu, rejected %llu, accepted %llu, exact %llu (%llu hit)\n",
+             (unsigned long long)stats.Candidates, (unsigned long long)stats.Rejected, (unsigned long long)stats.Accepted,
+             (unsigned long long)stats.Exact, (unsigned long long)stats.ExactHits);
+   }
+}
+
+static void BenchPairs(u32 Count)
+{
+   const f64 area     = 10000.0;
+   const f64 distance = 25.0;
+
+   C_scene                     scene;
+   std::vector<TProximityPair> pairs;
+   std::vector<TProximityPair> reference;
+
+   BuildScene(scene, Count, area, 1);
+
+   u32 cores = std::max(1u, std::thread::hardware_concurrency());
+
+   for (u32 threads = 1; threads <= cores; threads *= 2)
+   {
+      TProximityStats stats = {};
+
+      auto start = bench_clock::now();
+      ProximityPairs(scene, distance, pairs, threads, &stats);
+      f64 seconds = SecondsSince(start);
+
+      if (threads == 1)
+         reference = pairs;
+
+      bool same = pairs.size() == reference.size() &&
+                  memcmp(pairs.data(), reference.data(), pairs.size() * sizeof(TProximityPair)) == 0;
+
+      printf("pairs: %u cuboids within %.0f m, %u threads, %.3f ms, %zu pairs%s\n",
+             Count, distance, threads, seconds * 1e3, pairs.size(), same ? "" : " (DIFFERS FROM 1 THREAD)");
+      printf("pairs:   candidates %llu, rejected %llu, exact %llu\n",
+             (unsigned long long)stats.Candidates, (unsigned long long)stats.Rejected, (unsigned long long)stats.Exact);
+   }
+}
+
+// Rounds landing around the cuboids, most of them near an entity
+static void BuildShots(std::vector<TShot>& Shots, const C_scene& Scene, u32 Count, u64 Seed)
+{
+   u64 state = Seed;
+
+   Shots.resize(Count);
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      u32 target = (u32)((state >> 33) % Scene.Count());
+      C_vector aim(Scene.m_Center[0][target], Scene.m_Center[1][target], Scene.m_Center[2][target]);
+
+      Random(state, 1.0);
+      Shots[i].Id       = i;
+      Shots[i].Position = aim + C_vector(Random(state, 20.0), Random(state, 20.0), Random(state, 5.0));
+      Shots[i].Radius   = 0.5;
+   }
+}
+
+static void BenchBatch(u32 Count)
+{
+   const u32 shots = 1000000;
+
+   C_scene                  scene;
+   std::vector<TShot>       batch;
+   std::vector<TShotResult> results(shots);
+   std::vector<TShotResult> reference;
+   f64                      base = 0.0;
+
+   BuildScene(scene, Count, 10000.0, 1);
+   BuildShots(batch, scene, shots, 5);
+
+   u32 cores = std::max(1u, std::thread::hardware_concurrency());
+
+   for (u32 threads = 1; threads <= cores; threads = (threads == cores) ? cores + 1 : std::min(cores, threads * 2))
+   {
+      C_batchEngine engine(threads);
+      u32           hits = 0;
+
+      auto start = bench_clock::now();
+      engine.Score(scene, batch.data(), shots, results.data(), 100.0);
+      f64 seconds = SecondsSince(start);
+
+      if (threads == 1)
+      {
+         base      = seconds;
+         reference = results;
+      }
+
+      for (u32 i = 0; i < shots; i++)
+         hits += results[i].Hit;
+
+      bool same = memcmp(results.data(), reference.data(), shots * sizeof(TShotResult)) == 0;
+
+      printf("batch: %u shots vs %u cuboids, %2u threads, %.3f s, %.2f Mshots/s, speedup %.2fx, %u hits%s\n",
+             shots, Count, threads, seconds, shots / seconds * 1e-6, base / seconds, hits,
+             same ? "" : " (DIFFERS FROM 1 THREAD)");
+   }
+}
+
+// Receivers feeding one scoring consumer through the shot ring
+static void BenchQueue(u32 Count)
+{
+   const u32 producers = 4;
+   const u32 batch     = 64;
+
+   for (int pass = 0; pass < 2; pass++)
+   {
+      bool                     drop = (pass == 1);
+      C_ringQueue<TShot>       queue(4096);
+      std::vector<std::thread> threads;
+      std::atomic<u32>         done(0);
+      TShot                    items[batch];
+      u64                      received = 0;
+      u64                      checksum = 0;
+
+      auto start = bench_clock::now();
+
+      for (u32 p = 0; p < producers; p++)
+      {
+         threads.emplace_back([&, p]
+         {
+            TShot shot = {};
+
+            for (u32 i = 0; i < Count; i++)
+            {
+               shot.Id = p * Count + i;
+
+               if (drop)
+                  queue.PushOrDrop(shot);
+               else
+                  while (!queue.TryPush(shot))
+                     std::this_thread::yield();
+            }
+
+            done++;
+         });
+      }
+
+      for (;;)
+      {
+         u32 n = queue.PopBatch(items, batch);
+
+         for (u32 i = 0; i < n; i++)
+            checksum += items[i].Id;
+         received += n;
+
+         if (n == 0)
+         {
+            if (done.load() == producers && queue.Size() == 0)
+               break;
+            std::this_thread::yield();
+         }
+      }
+
+      f64 seconds = SecondsSince(start);
+
+      for (std::thread& thread : threads)
+         thread.join();
+
+      u64 total = (u64)producers * Count;
+      u64 sum   = total * (total - 1) / 2;
+
+      printf("queue: %-13s %u producers x %u shots, %.3f s, %.2f Mshots/s, received %llu, overflows %llu, drops %llu%s\n",
+             drop ? "push-or-drop" : "push-retry", producers, Count, seconds, received / seconds * 1e-6,
+             (unsigned long long)received, (unsigned long long)queue.Overflows(), (unsigned long long)queue.Drops(),
+             (!drop && checksum != sum) ? " (CHECKSUM MISMATCH)" : "");
+   }
+}
+
+// Readers keep querying while one writer moves entities and publishes
+static void BenchWorld(u32 Count)
+{
+   const u32 readers = 3;
+   const u32 ticks   = 20;
+   const u32 moved   = 1000;
+
+   C_world                  world;
+   std::vector<std::thread> threads;
+   std::atomic<bool>        stop(false);
+   std::atomic<u64>         queries(0);
+   std::atomic<u64>         torn(0);
+   u64                      state = 3;
+
+   TWorldSnapshot* next = world.BeginUpdate();
+   BuildScene(next->Scene, Count, 10000.0, 1);
+   world.Publish(next);
+
+   for (u32 r = 0; r < readers; r++)
+   {
+      threads.emplace_back([&, r]
+      {
+         s32       reader = world.RegisterReader();
+         u64       seed   = r + 100;
+         TRangeHit hit;
+
+         while (!stop.load(std::memory_order_relaxed))
+         {
+            const TWorldSnapshot* snapshot = world.Acquire(reader);
+            u64                   version  = snapshot->Version;
+
+            for (int i = 0; i < 64; i++)
+               snapshot->Scene.Nearest(C_vector(Random(seed, 10000.0), Random(seed, 10000.0), -7.5), 200.0, hit);
+
+            // The pinned snapshot must not change underneath the reader
+            if (snapshot->Version != version)
+               torn++;
+
+            world.Release(reader);
+            queries += 64;
+         }
+
+         world.UnregisterReader(reader);
+      });
+   }
+
+   auto start = bench_clock::now();
+   f64  build = 0.0;
+
+   for (u32 t = 0; t < ticks; t++)
+   {
+      auto            tick_start = bench_clock::now();
+      TWorldSnapshot* update     = world.BeginUpdate();
+      C_cuboid        entity(C_vector(0.0), 3.0, 3.0, 8.0);
+
+      for (u32 i = 0; i < moved; i++)
+      {
+         u32 index = (u32)((state >> 33) % Count);
+         Random(state, 1.0);
+
+         entity.SetPosition(Random(state, 10000.0), Random(state, 10000.0), -7.5);
+         entity.SetYaw_D(Random(state, 180.0));
+         update->Scene.Set(index, entity);
+      }
+
+      world.Publish(update);
+      build += SecondsSince(tick_start);
+   }
+
+   f64 seconds = SecondsSince(start);
+   stop = true;
+
+   for (std::thread& thread : threads)
+      thread.join();
+
+   printf("world: %u cuboids, %u versions in %.3f s (%.1f ms per copy+build+publish), %u readers, %.2f Mqueries/s\n",
+          Count, ticks, seconds, build * 1e3 / ticks, readers, queries.load() / seconds * 1e-6);
+   printf("world: version %llu, %llu snapshots reclaimed, %u still retired, %llu torn reads\n",
+          (unsigned long long)world.Version(), (unsigned long long)world.Reclaimed(), world.Reclaim(),
+          (unsigned long long)torn.load());
+}
+
+// Same batch at 1, 2, 8 and N threads, results and summary compared bytewise
+static void BenchDeterminism(u32 Count)
+{
+   const u32 shots = 200000;
+
+   C_scene                  scene;
+   std::vector<TShot>       batch;
+   std::vector<TShotResult> results(shots);
+   std::vector<TShotResult> reference;
+   TScoreSummary            summary;
+   TScoreSummary            reference_summary;
+   bool                     identical = true;
+
+   BuildScene(scene, Count, 10000.0, 1);
+   BuildShots(batch, scene, shots, 5);
+
+   u32 counts[] = { 1, 2, 8, std::max(1u, std::thread::hardware_concurrency()) };
+
+   // Poisons every result, a shot the engine skips cannot match the reference
+   const TShotResult unset = { -2, -2, NAN, C_vector(NAN) };
+
+   for (u32 i = 0; i < ArrayCount(counts); i++)
+   {
+      C_batchEngine engine(counts[i]);
+
+      std::fill(results.begin(), results.end(), unset);
+      engine.Score(scene, batch.data(), shots, results.data(), 100.0);
+      engine.Summarize(results.data(), shots, summary);
+
+      if (i == 0)
+      {
+         reference         = results;
+         reference_summary = summary;
+      }
+
+      bool same = memcmp(results.data(), reference.data(), shots * sizeof(TShotResult)) == 0 &&
+                  memcmp(&summary, &reference_summary, sizeof(summary)) == 0;
+
+      identical = identical && same;
+
+      printf("determinism: %2u threads, %llu hits of %llu scored, mean miss %.17g m, closest %u @ %.6f m: %s\n",
+             counts[i], (unsigned long long)summary.Hits, (unsigned long long)summary.Scored, summary.MeanMissDistance,
+             summary.Closest[0].Shot, summary.Closest[0].Distance, same ? "identical" : "DIFFERS");
+   }
+
+   if (!identical)
+      exit(1);
+}
+
+// Time ordered (spatially scattered) shots with and without Morton reordering
+static void BenchMorton(u32 Count)
+{
+   const u32 shots = 1000000;
+
+   C_scene                  scene;
+   std::vector<TShot>       batch;
+   std::vector<TShotResult> results(shots);
+   std::vector<TShotResult> reference;
+   TPerfCounters            perf;
+
+   BuildScene(scene, Count, 10000.0, 1);
+   BuildShots(batch, scene, shots, 5);
+   perf.Open();
+
+   for (int pass = 0; pass < 2; pass++)
+   {
+      C_batchEngine engine;
+      s64           counters[TPerfCounters::COUNTERS];
+
+      engine.m_SpatialSort = (pass == 1);
+
+      perf.Start();
+      auto start = bench_clock::now();
+      engine.Score(scene, batch.data(), shots, results.data(), 100.0);
+      f64 seconds = SecondsSince(start);
+      perf.Stop(counters);
+
+      if (pass == 0)
+         reference = results;
+
+      bool same = memcmp(results.data(), reference.data(), shots * sizeof(TShotResult)) == 0;
+
+      printf("morton: %-7s %u shots, %.3f s, %.2f Mshots/s, cache misses %lld, L1D read misses %lld, dTLB read misses %lld%s\n",
+             pass ? "sorted" : "arrival", shots, seconds, shots / seconds * 1e-6,
+             (long long)counters[0], (long long)counters[1], (long long)counters[2], same ? "" : " (RESULTS DIFFER)");
+   }
+
+   perf.Close();
+}
+
+// Bursts of 8 nearly parallel 2 km trajectories, packet against single ray
+static void BenchPacket(u32 Count)
+{
+   const u32 bursts = 20000;
+   const u32 lanes  = C_scene::RAY_PACKET;
+
+   C_scene               scene;
+   std::vector<C_vector> from(bursts * lanes);
+   std::vector<C_vector> to(bursts * lanes);
+   std::vector<TRayHit>  single(bursts * lanes);
+   std::vector<TRayHit>  packet(bursts * lanes);
+   u64                   state = 21;
+
+   BuildScene(scene, Count, 10000.0, 1);
+
+   for (u32 b = 0; b < bursts; b++)
+   {
+      C_vector shooter(Random(state, 10000.0), Random(state, 10000.0), -7.5);
+      f64      hdg = Random(state, 3.14159);
+
+      for (u32 l = 0; l < lanes; l++)
+      {
+         f64 h = hdg + Random(state, 0.01);
+         f64 p = Random(state, 0.002);
+
+         from[b * lanes + l] = shooter;
+         to[b * lanes + l]   = shooter + C_vector(cos(h) * cos(p), sin(h) * cos(p), -sin(p)) * 2000.0;
+      }
+   }
+
+   auto start = bench_clock::now();
+   u32  hits  = 0;
+   for (u32 i = 0; i < bursts * lanes; i++)
+      hits += scene.RayCast(from[i], to[i], single[i]) ? 1 : 0;
+   f64 single_seconds = SecondsSince(start);
+
+   C_scene::ResetPacketStats();
+
+   start = bench_clock::now();
+   u32 packet_hits = 0;
+   for (u32 b = 0; b < bursts; b++)
+      packet_hits += scene.RayCastPacket(&from[b * lanes], &to[b * lanes], &packet[b * lanes], lanes);
+   f64 packet_seconds = SecondsSince(start);
+
+   u32 differ = 0;
+   for (u32 i = 0; i < bursts * lanes; i++)
+      if (single[i].Entity != packet[i].Entity || single[i].Face != packet[i].Face || single[i].T != packet[i].T)
+         differ++;
+
+   const TPacketStats& stats = C_scene::PacketStats();
+
+   printf("packet: %u bursts x %u rays vs %u cuboids, single %.3f s (%u hits), packet %.3f s (%u hits), %.2fx, %u differ\n",
+          bursts, lanes, Count, single_seconds, hits, packet_seconds, packet_hits, single_seconds / packet_seconds, differ);
+   printf("   %llu of %llu bursts (%.1f%%) walked as a packet\n", (unsigned long long)stats.Coherent,
+          (unsigned long long)stats.Packets, 100.0 * stats.Coherent / std::max<u64>(stats.Packets, 1));
+}
+
+// Rounds fired at moving vehicles, kinetic scheduling against testing every
+// pair at a fixed 1 ms step. Vehicles send a new state every 100 ms.
+static void BenchKinetic(u32 Count)
+{
+   const u32 shots   = 200;
+   const u32 updates = 30;
+   const f64 period  = 0.1;
+   const f64 step    = 0.001;
+
+   C_scene               scene;
+   std::vector<C_vector> position(Count);
+   std::vector<C_vector> velocity(Count * updates);
+   std::vector<f64>      heading(Count);
+   std::vector<TKineticShot> rounds(shots);
+   u64                   state = 37;
+
+   BuildScene(scene, Count, 2000.0, 1);
+
+   for (u32 e = 0; e < Count; e++)
+   {
+      position[e] = C_vector(scene.m_Center[0][e], scene.m_Center[1][e], scene.m_Center[2][e]);
+      heading[e]  = Random(state, 3.14159);
+
+      for (u32 u = 0; u < updates; u++)
+      {
+         heading[e] += Random(state, 0.05);
+         velocity[e * updates + u] = C_vector(cos(heading[e]), sin(heading[e]), 0.0) * (10.0 + Random(state, 5.0));
+      }
+   }
+
+   for (u32 s = 0; s < shots; s++)
+   {
+      u32      target = (u32)((Random(state, 0.5) + 0.5) * (Count - 1));
+      C_vector from(position[target].x() + Random(state, 1500.0), position[target].y() + Random(state, 1500.0), -7.5);
+      C_vector aim = position[target] + C_vector(Random(state, 5.0), Random(state, 5.0), 0.0) - from;
+
+      rounds[s] = { s, from, aim * (800.0 / abs(aim)), 1.0, 0.0, updates * period };
+   }
+
+   // Entity state at the start of every update period, shared by both runs
+   std::vector<C_cuboid> samples(Count * updates);
+   for (u32 e = 0; e < Count; e++)
+   {
+      C_vector pos = position[e];
+
+      for (u32 u = 0; u < updates; u++)
+      {
+         C_cuboid& sample = samples[e * updates + u];
+
+         sample = C_cuboid(pos, 2.0 * scene.m_Half[1][e], 2.0 * scene.m_Half[2][e], 2.0 * scene.m_Half[0][e]);
+         sample.SetYaw(atan2(velocity[e * updates + u].y(), velocity[e * updates + u].x()));
+         pos += velocity[e * updates + u] * period;
+      }
+   }
+
+   auto                         start = bench_clock::now();
+   C_kineticScheduler           kinetic;
+   std::vector<TKineticContact> contacts;
+
+   for (u32 e = 0; e < Count; e++)
+      kinetic.AddEntity(samples[e * updates], e, velocity[e * updates], 0.0);
+   for (u32 s = 0; s < shots; s++)
+      kinetic.AddShot(rounds[s]);
+
+   for (u32 u = 0; u < updates; u++)
+   {
+      if (u > 0)
+         for (u32 e = 0; e < Count; e++)
+            kinetic.UpdateEntity(e, samples[e * updates + u], velocity[e * updates + u], u * period);
+
+      kinetic.Advance((u + 1) * period, contacts);
+   }
+   f64 kinetic_seconds = SecondsSince(start);
+
+   start = bench_clock::now();
+   C_scene                 sampled;
+   std::unordered_set<u64> touched;
+   u64                     tests = 0;
+
+   sampled.SetBroadphase(BROADPHASE_NONE);
+   for (u32 e = 0; e < Count; e++)
+      sampled.Add(samples[e * updates], e);
+
+   for (u32 u = 0; u < updates; u++)
+   {
+      for (u32 e = 0; e < Count; e++)
+         sampled.Set(e, samples[e * updates + u]);
+
+      for (f64 t = u * period; t < (u + 1) * period - 0.5 * step; t += step)
+      {
+         for (u32 s = 0; s < shots; s++)
+         {
+            C_vector round = rounds[s].Position + rounds[s].Velocity * t;
+
+            for (u32 e = 0; e < Count; e++)
+            {
+               C_vector closest;
+
+               if (touched.count(((u64)s << 32) | e))
+                  continue;
+
+               tests++;
+               if (sampled.PointDistance(e, round - velocity[e * updates + u] * (t - u * period), closest) <= rounds[s].Radius)
+                  touched.insert(((u64)s << 32) | e);
+            }
+         }
+      }
+   }
+   f64 sampled_seconds = SecondsSince(start);
+
+   u32 matched = 0;
+   for (const TKineticContact& contact : contacts)
+      if (touched.count(((u64)contact.Shot << 32) | contact.Entity))
+         matched++;
+
+   const TKineticStats& stats = kinetic.Stats();
+   printf("kinetic: %u rounds vs %u vehicles over %.1f s\n", shots, Count, updates * period);
+   printf("   kinetic %.3f s, %llu tests, %llu scheduled, %llu stale, %zu contacts\n",
+          kinetic_seconds, (unsigned long long)stats.Evaluated, (unsigned long long)stats.Scheduled,
+          (unsigned long long)stats.Stale, contacts.size());
+   printf("   1 ms step %.3f s, %llu tests, %zu contacts, %u found by both\n",
+          sampled_seconds, (unsigned long long)tests, touched.size(), matched);
+}
+
+// Rounds passing turning vehicles within one 100 ms step. Conservative
+// advancement against a dense resampling of the moving, turning cuboid and
+// against the swept test of the cuboid frozen at the start of the step.
+static void BenchCcd(u32 Count)
+{
+   const u32 samples = 200;
+
+   C_scene                scene;
+   C_threadPool           pool(1);
+   std::vector<TCcdQuery> queries(Count);
+   std::vector<TCcdHit>   hits(Count);
+   TCcdStats              stats = {};
+   u64                    state = 38;
+
+   BuildScene(scene, 1000, 2000.0, 1);
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      TCcdQuery& q = queries[i];
+      u32        e = (u32)((Random(state, 0.5) + 0.5) * (scene.Count() - 1));
+      C_vector   center(scene.m_Center[0][e], scene.m_Center[1][e], scene.m_Center[2][e]);
+      f64        hdg = Random(state, 3.14159);
+      C_vector   dir(cos(hdg), sin(hdg), 0.0);
+      C_vector   aim = center + C_vector(Random(state, 6.0), Random(state, 6.0), Random(state, 1.0));
+
+      q.From     = aim - dir * (40.0 + Random(state, 20.0));
+      q.To       = q.From + dir * 80.0;
+      q.Radius   = (i & 1) ? 0.5 : 0.0;
+      q.Entity   = e;
+      q.EntityTo = center + C_vector(Random(state, 2.0), Random(state, 2.0), 0.0);
+      q.Turn     = Random(state, 0.5);
+   }
+
+   auto start = bench_clock::now();
+   CcdQueryBatch(scene, queries.data(), Count, hits.data(), pool, &stats);
+   f64 ccd_seconds = SecondsSince(start);
+
+   // Reference: the cuboid rebuilt with C_cuboid::Yaw at every sample
+   u32 sampled_hits = 0;
+   u32 missed       = 0;
+   u32 static_hits  = 0;
+   C_scene one;
+
+   one.SetBroadphase(BROADPHASE_NONE);
+
+   start = bench_clock::now();
+   for (u32 i = 0; i < Count; i++)
+   {
+      const TCcdQuery& q = queries[i];
+      u32              e = q.Entity;
+      C_vector         center(scene.m_Center[0][e], scene.m_Center[1][e], scene.m_Center[2][e]);
+      bool             hit = false;
+
+      for (u32 k = 0; k <= samples && !hit; k++)
+      {
+         f64      t = (f64)k / samples;
+         C_cuboid cuboid(center + (q.EntityTo - center) * t, 2.0 * scene.m_Half[1][e], 2.0 * scene.m_Half[2][e], 2.0 * scene.m_Half[0][e]);
+         C_vector closest;
+
+         for (int r = 0; r < 3; r++)
+            for (int c = 0; c < 3; c++)
+               cuboid.m_pOrientation[r][c] = scene.m_Axis[r][c][e];
+         cuboid.Yaw(q.Turn * t);
+
+         one.Clear();
+         one.Add(cuboid, 0);
+
+         if (one.PointDistance(0, q.From + (q.To - q.From) * t, closest) <= q.Radius)
+            hit = true;
+      }
+
+      if (hit)
+      {
+         sampled_hits++;
+         if (!hits[i].Hit)
+            missed++;
+      }
+
+      TRayHit ray;
+      if (q.Radius == 0.0 && scene.RayCuboid(e, q.From, q.To - q.From, 1.0, ray))
+         static_hits++;
+   }
+   f64 sampled_seconds = SecondsSince(start);
+
+   printf("ccd: %u queries, %.3f s, %llu hits, %.2f iterations per query, %llu capped\n",
+          Count, ccd_seconds, (unsigned long long)stats.Hits, (f64)stats.Iterations / Count, (unsigned long long)stats.Capped);
+   printf("   %u samples per step: %.3f s, %u hits, %u missed by ccd\n", samples, sampled_seconds, sampled_hits, missed);
+   printf("   frozen cuboid segment test: %u hits of %u segments\n", static_hits, Count / 2);
+}
+
+// Fire and forget coroutine, runs until its first co_await on the caller
+struct TDetachedTask
+{
+   struct promise_type
+   {
+      TDetachedTask       get_return_object() { return {}; }
+      std::suspend_never  initial_suspend() { return {}; }
+      std::suspend_never  final_suspend() noexcept { return {}; }
+      void                return_void() {}
+      void                unhandled_exception() { abort(); }
+   };
+};
+
+static TDetachedTask AsyncRequest(C_asyncScorer& Scorer, const TShot& Shot, TShotResult& Result, f64& Latency, std::atomic<u32>& InFlight)
+{
+   auto start = bench_clock::now();
+
+   Result  = co_await Scorer.Score(Shot);
+   Latency = SecondsSince(start);
+   InFlight.fetch_sub(1, std::memory_order_release);
+}
+
+static void Percentiles(std::vector<f64>& Latency, f64& P50, f64& P99)
+{
+   std::sort(Latency.begin(), Latency.end());
+   P50 = Latency[Latency.size() / 2] * 1e6;
+   P99 = Latency[Latency.size() * 99 / 100] * 1e6;
+}
+
+// One request at a time through the synchronous API, against four client
+// threads submitting through the coroutine front end with up to 256
+// requests each in flight
+static void BenchAsync(u32 Count)
+{
+   const u32 requests = 200000;
+   const u32 clients  = 4;
+   const u32 window   = 256;
+
+   C_scene                  scene;
+   std::vector<TShot>       shots;
+   std::vector<TShotResult> sync(requests);
+   std::vector<TShotResult> async(requests);
+   std::vector<f64>         latency(requests);
+   C_batchEngine            engine(1);
+   f64                      p50, p99;
+
+   BuildScene(scene, Count, 10000.0, 1);
+   BuildShots(shots, scene, requests, 5);
+
+   auto start = bench_clock::now();
+   for (u32 i = 0; i < requests; i++)
+   {
+      auto call = bench_clock::now();
+      engine.Score(scene, &shots[i], 1, &sync[i], 100.0);
+      latency[i] = SecondsSince(call);
+   }
+   f64 sync_seconds = SecondsSince(start);
+
+   Percentiles(latency, p50, p99);
+   printf("async: %u requests vs %u cuboids\n", requests, Count);
+   printf("   sync  %.3f s, %.2f Mreq/s, latency p50 %.1f us, p99 %.1f us\n",
+          sync_seconds, requests / sync_seconds * 1e-6, p50, p99);
+
+   std::atomic<u32> in_flight[clients];
+   u64              batches;
+
+   {
+      C_asyncScorer            scorer(scene, engine, 100.0);
+      std::vector<std::thread> threads;
+
+      start = bench_clock::now();
+      for (u32 c = 0; c < clients; c++)
+      {
+         in_flight[c].store(0);
+         threads.emplace_back([&, c]
+         {
+            for (u32 i = c; i < requests; i += clients)
+            {
+               while (in_flight[c].load(std::memory_order_acquire) >= window)
+                  std::this_thread::yield();
+
+               in_flight[c].fetch_add(1, std::memory_order_relaxed);
+               AsyncRequest(scorer, shots[i], async[i], latency[i], in_flight[c]);
+            }
+
+            while (in_flight[c].load(std::memory_order_acquire) > 0)
+               std::this_thread::yield();
+         });
+      }
+
+      for (std::thread& thread : threads)
+         thread.join();
+
+      batches = scorer.Batches();
+   }
+   f64 async_seconds = SecondsSince(start);
+
+   Percentiles(latency, p50, p99);
+   printf("   async %.3f s, %.2f Mreq/s, latency p50 %.1f us, p99 %.1f us, %llu batches (%.1f per batch), %s\n",
+          async_seconds, requests / async_seconds * 1e-6, p50, p99, (unsigned long long)batches,
+          (f64)requests / batches, memcmp(sync.data(), async.data(), requests * sizeof(TShotResult)) ? "DIFFERS" : "same results");
+}
+
+// Range queries with variable length results, a vector per query against
+// an arena reset after every batch of 1024 queries
+static void BenchArena(u32 Count)
+{
+   const u32 queries = 200000;
+   const u32 batch   = 1024;
+   const f64 radius  = 50.0;
+
+   C_scene                 scene;
+   std::vector<TShot>      shots;
+   std::vector<TRangeHit*> batch_hits(batch);
+   std::vector<u32>        batch_found(batch);
+   C_arena                 arena;
+   u64                     vector_total = 0;
+   u64                     arena_total  = 0;
+
+   BuildScene(scene, Count, 10000.0, 1);
+   BuildShots(shots, scene, queries, 5);
+
+   C_queryScope::ResetAllocations();
+   auto start = bench_clock::now();
+   for (u32 i = 0; i < queries; i++)
+   {
+      C_queryScope           scope;
+      std::vector<TRangeHit> hits(16);
+      u32                    found = scene.RangeQuery(shots[i].Position, radius, hits.data(), (u32)hits.size());
+
+      if (found > hits.size())
+      {
+         hits.resize(found);
+         scene.RangeQuery(shots[i].Position, radius, hits.data(), found);
+      }
+
+      vector_total += found;
+   }
+   f64 vector_seconds = SecondsSince(start);
+   u64 vector_allocs  = C_queryScope::Allocations();
+
+   C_queryScope::ResetAllocations();
+   start = bench_clock::now();
+   for (u32 first = 0; first < queries; first += batch)
+   {
+      u32 last = std::min(queries, first + batch);
+
+      {
+         C_queryScope scope;
+
+         for (u32 i = first; i < last; i++)
+            batch_found[i - first] = scene.RangeQuery(shots[i].Position, radius, arena, batch_hits[i - first]);
+      }
+
+      for (u32 i = first; i < last; i++)
+         arena_total += batch_found[i - first];
+
+      arena.Reset();
+   }
+   f64 arena_seconds = SecondsSince(start);
+   u64 arena_allocs  = C_queryScope::Allocations();
+
+   printf("arena: %u range queries (%.0f m) vs %u cuboids, %llu hits\n", queries, radius, Count, (unsigned long long)vector_total);
+   printf("   vector per query %.3f s, %llu heap allocations on the query path\n", vector_seconds, (unsigned long long)vector_allocs);
+   printf("   arena per batch  %.3f s, %llu heap allocations on the query path, %llu blocks, high water %llu KB%s\n",
+          arena_seconds, (unsigned long long)arena_allocs, (unsigned long long)arena.Blocks(),
+          (unsigned long long)arena.HighWater() / 1024, arena_total == vector_total ? "" : " (HIT COUNT DIFFERS)");
+#if !QUERY_ALLOC_CHECK
+   printf("   (allocation counts need make bench_alloccheck)\n");
+#endif
+}
+
+// Recording text in memory: 50 vehicles, every 20th line an entity state,
+// the rest shots landing around them
+static void BuildRecording(std::vector<u8>& Text, u32 Lines, u64 Seed)
+{
+   u64  state = Seed;
+   char line[256];
+
+   Text.clear();
+
+   for (u32 i = 0; i < Lines; i++)
+   {
+      f64 x = 300000.0 + Random(state, 5000.0);
+      f64 y = 524000.0 + Random(state, 5000.0);
+      int n;
+
+      if (i % 20 == 0)
+         n = snprintf(line, sizeof(line), "78,%u,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n", 10000 + (u32)(i / 20) % 50,
+                      x, y, -7.5, x, y, -7.5, 2.8, 3.0, 8.8, Random(state, 180.0));
+      else
+         n = snprintf(line, sizeof(line), "78,10170,%f,%f,%f,1\n", x, y, -7.5 + Random(state, 3.0));
+
+      Text.insert(Text.end(), line, line + n);
+   }
+}
+
+// Line at a time strtod parsing against the SSE2 scanner filling columns
+static void BenchParse(u32 Count)
+{
+   std::vector<u8>      text;
+   std::vector<TRecord> records;
+   TRecordColumns       columns;
+   u64                  malformed = 0;
+
+   BuildRecording(text, Count, 43);
+
+   auto start = bench_clock::now();
+   ParseRecording(text.data(), text.size(), records, &malformed);
+   f64 line_seconds = SecondsSince(start);
+
+   f64 column_seconds = 1e30;
+   for (int pass = 0; pass < 5; pass++)
+   {
+      columns.Clear();
+      start = bench_clock::now();
+      ParseRecordingColumns(text.data(), text.size(), columns, &malformed);
+      column_seconds = std::min(column_seconds, SecondsSince(start));
+   }
+
+   auto same = [&](const TRecordColumns& Columns)
+   {
+      if (records.size() != Columns.Count())
+         return false;
+
+      for (u64 i = 0; i < records.size(); i++)
+      {
+         TRecord row;
+         Columns.Get(i, row);
+         if (memcmp(&row, &records[i], sizeof(TRecord)) != 0)
+            return false;
+      }
+      return true;
+   };
+
+   bool differ = !same(columns);
+
+   printf("parse: %u lines, %.1f MB, %llu malformed\n", Count, text.size() / 1e6, (unsigned long long)malformed);
+   printf("   strtod per line %.3f s, %.0f MB/s\n", line_seconds, text.size() / 1e6 / line_seconds);
+   printf("   columns         %.3f s, %.0f MB/s, %s\n", column_seconds, text.size() / 1e6 / column_seconds,
+          differ ? "DIFFERS" : "bit-identical");
+
+   // Byte range parallel parse, doubling the worker count up to every core
+   u32 cores = std::max(1u, std::thread::hardware_concurrency());
+
+   for (u32 threads = 1; ; threads = std::min(threads * 2, cores))
+   {
+      C_threadPool pool(threads);
+      f64          seconds = 1e30;
+
+      for (int pass = 0; pass < 5; pass++)
+      {
+         columns.Clear();
+         start = bench_clock::now();
+         ParseRecordingParallel(text.data(), text.size(), columns, pool, nullptr);
+         seconds = std::min(seconds, SecondsSince(start));
+      }
+
+      printf("   parallel %2u thr %.3f s, %.0f MB/s, %.2fx columns, %s\n", threads, seconds, text.size() / 1e6 / seconds,
+             column_seconds / seconds, same(columns) ? "bit-identical" : "DIFFERS");
+
+      if (threads == cores)
+         break;
+   }
+}
+
+// Drops the file's clean pages from the page cache, no root needed
+static void EvictFile(const char* Filename)
+{
+   int fd = open(Filename, O_RDONLY);
+
+   if (fd >= 0)
+   {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+      close(fd);
+   }
+}
+
+// Reads one byte per page so lazily mapped pages are faulted in
+static u64 TouchPages(const TBuffer& Buffer)
+{
+   u64 sum = 0;
+
+   for (u64 i = 0; i < Buffer.Size; i += 4096)
+      sum += Buffer.Data[i];
+
+   return sum;
+}
+
+static void BenchLoad(u32 Count)
+{
+   std::vector<u8> text;
+   char            filename[] = "/tmp/bench_load_XXXXXX";
+   int             fd         = mkstemp(filename);
+
+   BuildRecording(text, Count, 45);
+
+   if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size() || fsync(fd) != 0)
+   {
+      printf("load: cannot write %s\n", filename);
+      return;
+   }
+   close(fd);
+
+   printf("load: %.1f MB, best of 3, load plus a read of every page\n", text.size() / 1e6);
+
+   u64 expect = 0;
+
+   for (int method = 0; method < 3; method++)
+   {
+      static const char* names[] = { "ReadEntireFile", "mmap", "mmap populate" };
+      f64                seconds[2] = { 1e30, 1e30 };
+      u64                check      = 0;
+      bool               padded     = true;
+
+      for (int warm = 0; warm < 2; warm++)
+      {
+         for (int pass = 0; pass < 3; pass++)
+         {
+            if (!warm)
+               EvictFile(filename);
+            else if (pass == 0)
+               TouchPages(C_mappedFile().Map(filename, true));
+
+            C_mappedFile mapping;
+            auto         start = bench_clock::now();
+            TBuffer      file  = (method == 0) ? ReadEntireFile(filename) : mapping.Map(filename, method == 2);
+
+            check += TouchPages(file);
+            seconds[warm] = std::min(seconds[warm], SecondsSince(start));
+
+            if (method == 0)
+            {
+               delete [] file.Data;
+               continue;
+            }
+
+            for (u64 i = 0; i < C_mappedFile::PADDING; i++)
+               padded = padded && file.Data[file.Size + i] == 0;
+         }
+      }
+
+      if (method == 0)
+         expect = check;
+
+      // The page sum is printed so the page reads cannot be optimized away
+      printf("   %-14s cold %.3f s (%5.0f MB/s), warm %.3f s (%5.0f MB/s), page sum %llu%s%s\n", names[method],
+             seconds[0], text.size() / 1e6 / seconds[0], seconds[1], text.size() / 1e6 / seconds[1],
+             (unsigned long long)check, (method && !padded) ? ", PADDING NOT ZERO" : "",
+             (check != expect) ? ", DIFFERS" : "");
+   }
+
+   unlink(filename);
+}
+
+static void BenchSeek(u32 Count)
+{
+   std::vector<u8> text;
+   char            filename[] = "/tmp/bench_seek_XXXXXX";
+   int             fd         = mkstemp(filename);
+
+   BuildRecording(text, Count, 47);
+
+   if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size())
+   {
+      printf("seek: cannot write %s\n", filename);
+      return;
+   }
+   close(fd);
+
+   std::string sidecar = C_seekIndex::SidecarName(filename);
+   C_seekIndex built;
+   C_seekIndex index;
+
+   auto start = bench_clock::now();
+   built.Build(filename);
+   f64 build_seconds = SecondsSince(start);
+
+   bool loaded = built.Save(sidecar.c_str()) && index.Load(sidecar.c_str(), filename);
+
+   TRecordColumns reference;
+   ParseRecordingColumns(text.data(), text.size(), reference, nullptr);
+
+   printf("seek: %u lines, %.1f MB, index of %llu entries built in %.3f s, %s\n", Count, text.size() / 1e6,
+          (unsigned long long)index.Entries(), build_seconds, loaded ? "reloaded" : "RELOAD FAILED");
+
+   // Random seeks, each parses one stride from the entry it lands on
+   const u32               seeks  = 1000;
+   u64                     state  = 47;
+   u64                     differ = 0;
+   TRecordColumns          stride;
+   std::vector<TSeekRange> ranges;
+
+   start = bench_clock::now();
+   for (u32 i = 0; i < seeks; i++)
+   {
+      state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+
+      u64 record = (state >> 33) % index.Records();
+      u64 skip;
+      u64 offset = index.Seek(record, skip);
+
+      index.Split(record, 1, 1, ranges);
+
+      stride.Clear();
+      ParseRecordingColumns(text.data() + offset, ranges[0].End - offset, stride, nullptr);
+
+      TRecord found, expect;
+      stride.Get(skip, found);
+      reference.Get(record, expect);
+      differ += memcmp(&found, &expect, sizeof(TRecord)) != 0;
+   }
+   f64 seek_seconds = SecondsSince(start) / seeks;
+
+   // Without the index the 95% mark is only reached by parsing up to it
+   u64 target = index.Records() * 95 / 100;
+   u64 skip;
+   u64 offset = index.Seek(target, skip);
+
+   start = bench_clock::now();
+   stride.Clear();
+   ParseRecordingColumns(text.data(), offset, stride, nullptr);
+   f64 scan_seconds = SecondsSince(start);
+
+   printf("   seek and parse a stride %.3f ms (%s), scan to the 95%% mark %.3f ms\n", seek_seconds * 1e3,
+          differ ? "DIFFERS" : "rows match", scan_seconds * 1e3);
+
+   // A window at the 90% mark parsed across the pool
+   C_threadPool   pool(0);
+   TRecordColumns window;
+   u64            first = index.Records() * 90 / 100;
+   u64            count = index.Records() / 20;
+
+   start = bench_clock::now();
+   u64 got = ParseRecordingRange(index, text.data(), text.size(), first, count, window, pool);
+   f64 window_seconds = SecondsSince(start);
+
+   differ = (got != count);
+   for (u64 i = 0; !differ && i < count; i++)
+   {
+      TRecord found, expect;
+      window.Get(i, found);
+      reference.Get(first + i, expect);
+      differ += memcmp(&found, &expect, sizeof(TRecord)) != 0;
+   }
+
+   printf("   records %llu..%llu on %u threads %.3f ms, %s\n", (unsigned long long)first,
+          (unsigned long long)(first + count - 1), pool.Threads(), window_seconds * 1e3, differ ? "DIFFERS" : "rows match");
+
+   unlink(sidecar.c_str());
+   unlink(filename);
+}
+
+// Sums every 64th byte so each chunk is actually read
+static u64 ChunkSum(const u8* Data, u64 Size)
+{
+   u64 sum = 0;
+
+   for (u64 i = 0; i < Size; i += 64)
+      sum += Data[i];
+
+   return sum;
+}
+
+static void BenchAsyncRead(u32 Count)
+{
+   const u32       files = 8;
+   std::vector<u8> text;
+   std::string     names[files];
+   u64             bytes = 0;
+
+   BuildRecording(text, Count / files, 48);
+
+   for (u32 f = 0; f < files; f++)
+   {
+      char filename[] = "/tmp/bench_aread_XXXXXX";
+      int  fd         = mkstemp(filename);
+
+      if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size() || fsync(fd) != 0)
+      {
+         printf("aread: cannot write %s\n", filename);
+         return;
+      }
+      close(fd);
+
+      names[f] = filename;
+      bytes   += text.size();
+   }
+
+   printf("aread: %u files of %.1f MB read round robin in 1 MB chunks, best of 3 cold\n", files, text.size() / 1e6);
+
+   u64 expect = 0;
+
+   for (int method = 0; method < 5; method++)
+   {
+      static const char* labels[] = { "C_chunkReader", "pread qd 1", "pread qd 8", "io_uring qd 1", "io_uring qd 8" };
+      const u64          chunk    = 1 << 20;
+      f64                seconds  = 1e30;
+      u64                sum      = 0;
+      EReadBackend       backend  = READ_BACKEND_THREADS;
+      bool               failed   = false;
+
+      for (int pass = 0; pass < 3; pass++)
+      {
+         for (u32 f = 0; f < files; f++)
+            EvictFile(names[f].c_str());
+
+         auto start = bench_clock::now();
+         sum = 0;
+
+         if (method == 0)
+         {
+            C_chunkReader         readers[files];
+            std::unique_ptr<u8[]> buffer(new u8[chunk]);
+            u32                   open = 0;
+
+            for (u32 f = 0; f < files; f++)
+               open += readers[f].Open(names[f].c_str());
+
+            while (open)
+            {
+               open = 0;
+               for (u32 f = 0; f < files; f++)
+               {
+                  u64 got = readers[f].Read(buffer.get(), chunk);
+                  sum  += ChunkSum(buffer.get(), got);
+                  open += (got != 0);
+               }
+            }
+         }
+         else
+         {
+            C_asyncReader reader((method & 1) ? 1 : 8, chunk, (method < 3) ? READ_BACKEND_THREADS : READ_BACKEND_URING);
+            s32           handles[files];
+            u32           open = 0;
+
+            backend = reader.Backend();
+
+            for (u32 f = 0; f < files; f++)
+               open += (handles[f] = reader.Open(names[f].c_str())) >= 0;
+
+            while (open)
+            {
+               open = 0;
+               for (u32 f = 0; f < files; f++)
+               {
+                  TAsyncChunk piece;
+
+                  if (handles[f] >= 0 && reader.Next(handles[f], piece))
+                  {
+                     sum += ChunkSum(piece.Data, piece.Size);
+                     reader.Release(handles[f], piece);
+                     open++;
+                  }
+                  else if (handles[f] >= 0)
+                  {
+                     failed = failed || reader.Failed(handles[f]);
+                  }
+               }
+            }
+         }
+
+         seconds = std::min(seconds, SecondsSince(start));
+      }
+
+      if (method == 0)
+         expect = sum;
+
+      printf("   %-14s %.3f s (%5.0f MB/s)%s%s%s\n", labels[method], seconds, bytes / 1e6 / seconds,
+             (method >= 3 && backend != READ_BACKEND_URING) ? ", fell back to pread" : "",
+             failed ? ", READ FAILED" : "", (sum != expect) ? ", DIFFERS" : "");
+   }
+
+   for (u32 f = 0; f < files; f++)
+      unlink(names[f].c_str());
+}
+
+// Decodes every block of a coded recording serially and across pools,
+// checking each against the uncoded file
+static void BenchCodec(u32 Count)
+{
+   std::vector<u8> text;
+   char            filename[] = "/tmp/bench_codec_XXXXXX";
+   int             fd         = mkstemp(filename);
+
+   BuildRecording(text, Count, 49);
+
+   if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size())
+   {
+      printf("codec: cannot write %s\n", filename);
+      return;
+   }
+   close(fd);
+
+   std::string         raw_name   = std::string(filename) + ".raw";
+   std::string         coded_name = std::string(filename) + ".delta";
+   TRecordConvertStats raw_stats, coded_stats;
+   C_recordingFile     raw, coded;
+
+   auto start = bench_clock::now();
+   ConvertRecording(filename, raw_name.c_str(), raw_stats, RECORD_CODEC_NONE);
+   f64 raw_seconds = SecondsSince(start);
+
+   start = bench_clock::now();
+   ConvertRecording(filename, coded_name.c_str(), coded_stats, RECORD_CODEC_DELTA);
+   f64 coded_seconds = SecondsSince(start);
+
+   if (!raw.Open(raw_name.c_str()) || !coded.Open(coded_name.c_str()))
+   {
+      printf("codec: cannot open the converted recordings\n");
+      return;
+   }
+
+   printf("codec: %u lines, text %.1f MB, binary %.1f MB in %.3f s, delta coded %.1f MB in %.3f s (%.2fx smaller)\n",
+          Count, text.size() / 1e6, raw_stats.FileBytes / 1e6, raw_seconds, coded_stats.FileBytes / 1e6, coded_seconds,
+          (f64)raw_stats.FileBytes / coded_stats.FileBytes);
+
+   std::vector<u32> blocks(coded.Blocks());
+
+   for (u32 b = 0; b < coded.Blocks(); b++)
+      blocks[b] = b;
+
+   // Decoded bytes are the uncoded column bytes
+   u64 decoded = raw_stats.FileBytes;
+
+   for (u32 threads : { 1u, 4u })
+   {
+      C_threadPool                  pool(threads);
+      std::vector<std::vector<u64>> buffers(coded.Blocks());
+      std::vector<TRecordBlock>     views(coded.Blocks());
+      f64                           seconds = 1e30;
+      bool                          ok      = true;
+
+      for (int pass = 0; pass < 3; pass++)
+      {
+         start = bench_clock::now();
+         ok    = coded.DecodeBlocks(blocks.data(), coded.Blocks(), buffers.data(), views.data(), pool);
+         seconds = std::min(seconds, SecondsSince(start));
+      }
+
+      u64 differ = 0;
+
+      for (u32 b = 0; ok && b < coded.Blocks(); b++)
+      {
+         TRecordBlock expect;
+
+         raw.Block(b, expect);
+
+         for (u32 i = 0; i < expect.Count; i++)
+         {
+            TRecord found, want;
+
+            views[b].Get(i, found);
+            expect.Get(i, want);
+            differ += (views[b].Row[i] != expect.Row[i]) || memcmp(&found, &want, sizeof(TRecord)) != 0;
+         }
+      }
+
+      printf("   decode %u blocks on %u threads %.3f s (%5.0f MB/s decoded), %s\n", coded.Blocks(), pool.Threads(),
+             seconds, decoded / 1e6 / seconds, !ok ? "DAMAGED" : differ ? "DIFFERS" : "rows match");
+   }
+
+   raw.Close();
+   coded.Close();
+   unlink(raw_name.c_str());
+   unlink(coded_name.c_str());
+   unlink(filename);
+}
+
+// Flips one u32 of a file, for the damaged index checks
+static bool PatchFile(const char* Filename, u64 Offset, u32 Value)
+{
+   int  fd = open(Filename, O_WRONLY);
+   bool ok = fd >= 0 && pwrite(fd, &Value, sizeof(Value), (off_t)Offset) == (ssize_t)sizeof(Value);
+
+   if (fd >= 0)
+      close(fd);
+
+   return ok;
+}
+
+// Block and entity lookups of a binary recording against scans of its
+// index, then Open against index entries pointing outside the file
+static void BenchBlocks(u32 Count)
+{
+   const u32       lookups = 100000;
+   std::vector<u8> text;
+   char            filename[] = "/tmp/bench_blocks_XXXXXX";
+   int             fd         = mkstemp(filename);
+
+   BuildRecording(text, Count, 51);
+
+   if (fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size())
+   {
+      printf("blocks: cannot write %s\n", filename);
+      return;
+   }
+   close(fd);
+
+   std::string         binary_name = std::string(filename) + ".crec";
+   TRecordConvertStats stats;
+   C_recordingFile     file;
+
+   if (!ConvertRecording(filename, binary_name.c_str(), stats) || !file.Open(binary_name.c_str()))
+   {
+      printf("blocks: cannot convert %s\n", filename);
+      unlink(filename);
+      return;
+   }
+
+   std::vector<u32> found, expect;
+   u64              state  = 51;
+   u64              differ = 0;
+   u64              listed = 0;
+
+   auto start = bench_clock::now();
+
+   for (u32 i = 0; i < lookups; i++)
+   {
+      ERecordKind kind  = (i & 1) ? RECORD_ENTITY : RECORD_SHOT;
+      u64         first = (u64)((Random(state, 0.5) + 0.5) * file.Rows());
+      u64         last  = first + (u64)((Random(state, 0.5) + 0.5) * file.Rows() * 0.1);
+
+      file.BlocksInRange(kind, first, last, found);
+      listed += found.size();
+   }
+
+   f64 range_seconds = SecondsSince(start);
+
+   // The same windows again, each checked against every block of its kind
+   state = 51;
+
+   for (u32 i = 0; i < lookups; i++)
+   {
+      ERecordKind kind  = (i & 1) ? RECORD_ENTITY : RECORD_SHOT;
+      u64         first = (u64)((Random(state, 0.5) + 0.5) * file.Rows());
+      u64         last  = first + (u64)((Random(state, 0.5) + 0.5) * file.Rows() * 0.1);
+
+      expect.clear();
+      for (u32 b : file.KindBlocks(kind))
+         if (file.Index(b).LastRow >= first && file.Index(b).FirstRow <= last)
+            expect.push_back(b);
+
+      file.BlocksInRange(kind, first, last, found);
+      differ += (found != expect);
+   }
+
+   // Every id of an entity block, against the ids each block holds
+   u64 entity_differ = 0;
+   u32 ids           = 0;
+
+   std::vector<std::vector<u32>> holders(50);
+
+   for (u32 b : file.KindBlocks(RECORD_ENTITY))
+   {
+      TRecordBlock view;
+
+      file.Block(b, view);
+
+      for (u32 r = 0; r < view.Count; r++)
+         if (view.Id[r] >= 10000 && view.Id[r] < 10050 && (holders[view.Id[r] - 10000].empty() || holders[view.Id[r] - 10000].back() != b))
+            holders[view.Id[r] - 10000].push_back(b);
+   }
+
+   start = bench_clock::now();
+
+   for (u32 i = 0; i < lookups; i++)
+   {
+      u32        count;
+      u32        id   = 10000 + i % 51; // 10050 is never an entity
+      const u32* list = file.EntityBlocks(id, count);
+
+      if (i < 51)
+      {
+         std::vector<u32> want = (id < 10050) ? holders[id - 10000] : std::vector<u32>();
+
+         entity_differ += !(count == want.size() && (count == 0 || std::equal(list, list + count, want.begin())));
+         ids           += count > 0;
+      }
+   }
+
+   f64 entity_seconds = SecondsSince(start);
+   u32 blocks         = file.Blocks();
+
+   file.Close();
+
+   printf("blocks: %u lines in %u blocks, %u lookups each\n", Count, blocks, lookups);
+   printf("   BlocksInRange %.1f ns, %.1f blocks per window, %llu differ from a scan of the index\n",
+          range_seconds / lookups * 1e9, (f64)listed / lookups, (unsigned long long)differ);
+   printf("   EntityBlocks  %.1f ns, %u ids found, %llu differ from the blocks holding them\n",
+          entity_seconds / lookups * 1e9, ids, (unsigned long long)entity_differ);
+
+   // A block number past the last block, then an entity slice past the list
+   TRecordFileTrailer trailer;
+   int                in = open(binary_name.c_str(), O_RDONLY);
+   off_t              size = lseek(in, 0, SEEK_END);
+
+   pread(in, &trailer, sizeof(trailer), size - (off_t)sizeof(trailer));
+   close(in);
+
+   u64  list_end  = (u64)size - sizeof(trailer) - sizeof(u32);
+   u64  entity_at = trailer.IndexOffset + (u64)trailer.Blocks * sizeof(TRecordBlockIndex) + offsetof(TRecordEntityIndex, First);
+   bool block_rejected  = PatchFile(binary_name.c_str(), list_end, trailer.Blocks) && !file.Open(binary_name.c_str());
+   bool entity_rejected = PatchFile(binary_name.c_str(), list_end, 0) &&
+                          PatchFile(binary_name.c_str(), entity_at, (u32)trailer.EntityBlocks) && !file.Open(binary_name.c_str());
+
+   printf("   damaged index: block number past the end %s, entity slice past the list %s\n",
+          block_rejected ? "rejected" : "ACCEPTED", entity_rejected ? "rejected" : "ACCEPTED");
+
+   file.Close();
+   unlink(binary_name.c_str());
+   unlink(filename);
+}
+
+// A writer thread appends batches of lines every few milliseconds, the
+// follower parses and scores each as it lands. Latency runs from the start
+// of a batch's first write to its scores being written. Only hits are
+// written, every pair of 20k shots a second is more CSV than a core formats.
+static void BenchFollow(u32 Count)
+{
+   const u32       lines  = 100;  // per batch
+   const u32       period = 5;    // ms between batches
+   std::vector<u8> text;
+   char            filename[] = "/tmp/bench_follow_XXXXXX";
+   int             fd         = mkstemp(filename);
+
+   BuildRecording(text, Count, 50);
+
+   // Byte offset of every batch start
+   std::vector<u64> starts(1, 0);
+
+   for (u64 i = 0, line = 0; i < text.size(); i++)
+      if (text[i] == '\n' && ++line % lines == 0)
+         starts.push_back(i + 1);
+
+   if (starts.back() != text.size())
+      starts.push_back(text.size());
+
+   u32                           batches = (u32)starts.size() - 1;
+   std::vector<std::atomic<s64>> written(batches);
+   std::atomic<bool>             done(false);
+   C_recordingTail               tail;
+
+   if (fd < 0 || !tail.Open(filename))
+   {
+      printf("follow: cannot watch %s\n", filename);
+      return;
+   }
+
+   auto epoch = bench_clock::now();
+
+   auto ticks = [&]() { return (s64)std::chrono::duration_cast<std::chrono::microseconds>(bench_clock::now() - epoch).count(); };
+
+   std::thread writer([&]()
+   {
+      for (u32 b = 0; b < batches; b++)
+      {
+         // Two writes, the second starting mid line
+         u64 half = starts[b] + (starts[b + 1] - starts[b]) / 2;
+
+         written[b] = ticks();
+
+         if (write(fd, text.data() + starts[b], half - starts[b]) < 0 ||
+             write(fd, text.data() + half, starts[b + 1] - half) < 0)
+            break;
+
+         std::this_thread::sleep_for(std::chrono::milliseconds(period));
+      }
+
+      done = true;
+   });
+
+   C_replay                replay(0.0, 0, false);
+   TRecordColumns          records;
+   std::vector<TPairScore> scores;
+   std::vector<f64>        latency;
+   FILE*                   out  = fopen("/dev/null", "wb");
+   u64                     seen = 0;
+
+   while (latency.size() < batches)
+   {
+      records.Clear();
+
+      ETailState state = tail.Poll(100, records);
+
+      if (state == TAIL_GONE || (state == TAIL_WAITING && done))
+         break;
+
+      if (state != TAIL_RECORDS)
+         continue;
+
+      scores.clear();
+      replay.Replay(records, 0, records.Count(), scores);
+      C_replay::WriteScores(out, scores.data(), scores.size(), true);
+      fflush(out);
+
+      seen += records.Count();
+
+      s64 now = ticks();
+
+      // Every line of the recording parses, batch b is done at (b + 1) * lines
+      while (latency.size() < batches && std::min<u64>((latency.size() + 1) * lines, Count) <= seen)
+         latency.push_back((now - written[latency.size()]) * 1e-3);
+   }
+
+   writer.join();
+   fclose(out);
+   close(fd);
+   unlink(filename);
+
+   std::vector<f64> sorted(latency);
+   std::sort(sorted.begin(), sorted.end());
+
+   u32 late = (u32)(sorted.end() - std::upper_bound(sorted.begin(), sorted.end(), 100.0));
+
+   printf("follow: %u batches of %u lines every %u ms, %u followed in %llu wakeups\n", batches, lines, period,
+          (u32)latency.size(), (unsigned long long)tail.Stats().Wakeups);
+
+   if (!sorted.empty())
+      printf("   write to scored latency median %.3f ms, 99%% %.3f ms, max %.3f ms, %u over 100 ms\n",
+             sorted[sorted.size() / 2], sorted[sorted.size() * 99 / 100], sorted.back(), late);
+}
+
+// Checks the points SphereCollision and ClosestPoint report against the
+// entity's own box, with entities far from the origin and turned
+static void BenchPoints(u32 Count)
+{
+   const u32 rounds = 20; // per entity
+   const f64 eps    = 1e-6;
+
+   C_scene scene;
+   u64     state = 41;
+   u64     faces = 0, off_box = 0, closest_differ = 0;
+
+   for (u32 i = 0; i < Count; i++)
+   {
+      C_vector pos(300000.0 + Random(state, 5000.0), 524000.0 + Random(state, 5000.0), -7.5);
+      C_cuboid entity(pos, 2.8, 3.0, 8.8);
+
+      entity.SetYaw_D(Random(state, 180.0));
+
+      u32 index = scene.Add(entity, 10000 + i);
+
+      for (u32 r = 0; r < rounds; r++)
+      {
+         C_vector round = pos + C_vector(Random(state, 8.0), Random(state, 8.0), Random(state, 3.0));
+         C_vector poc, closest, expect;
+         f64      miss;
+
+         // Face points must lie on the box: inside every slab, on one face
+         if (entity.SphereCollision(round, 0.0, miss, poc) > 0)
+         {
+            C_vector offset  = poc - pos;
+            f64      outside = 0.0, nearest = 1e30;
+
+            for (int k = 0; k < 3; k++)
+            {
+               f64 o = entity.m_pOrientation[k][0] * offset.x() + entity.m_pOrientation[k][1] * offset.y() + entity.m_pOrientation[k][2] * offset.z();
+               f64 h = entity.m_pSize[k] * 0.5;
+
+               outside = std::max(outside, fabs(o) - h);
+               nearest = std::min(nearest, h - fabs(o));
+            }
+
+            faces++;
+            off_box += (outside > eps || nearest > eps);
+         }
+
+         f64 dist = entity.ClosestPoint(round, closest);
+         f64 want = scene.PointDistance(index, round, expect);
+
+         closest_differ += fabs(dist - want) > eps || abs(closest - expect) > eps;
+      }
+   }
+
+   printf("points: %u entities, %u rounds each\n", Count, rounds);
+   printf("   %llu face points, %llu off the box, %llu closest points differ from C_scene::PointDistance\n",
+          (unsigned long long)faces, (unsigned long long)off_box, (unsigned long long)closest_differ);
+}
+
+struct TBench
+{
+   const char* Name;
+   void      (*Run)(u32 Count);
+   u32         DefaultCount;
+};
+
+static const TBench Benches[] =
+{
+   { "range",       BenchRange,       100000 },
+   { "points",      BenchPoints,      10000 },
+   { "sensor",      BenchSensor,      100000 },
+   { "pairs",       BenchPairs,       100000 },
+   { "batch",       BenchBatch,       100000 },
+   { "queue",       BenchQueue,       1000000 },
+   { "world",       BenchWorld,       100000 },
+   { "determinism", BenchDeterminism, 100000 },
+   { "morton",      BenchMorton,      100000 },
+   { "packet",      BenchPacket,      100000 },
+   { "kinetic",     BenchKinetic,     200 },
+   { "ccd",         BenchCcd,         20000 },
+   { "async",       BenchAsync,       100000 },
+   { "arena",       BenchArena,       100000 },
+   { "parse",       BenchParse,       2000000 },
+   { "load",        BenchLoad,        2000000 },
+   { "seek",        BenchSeek,        2000000 },
+   { "aread",       BenchAsyncRead,   2000000 },
+   { "codec",       BenchCodec,       2000000 },
+   { "blocks",      BenchBlocks,      2000000 },
+   { "follow",      BenchFollow,      20000 },
+};
+
+int main(int argc, char* argv[])
+{
+   if (argc < 2)
+   {
+      printf("usage: %s <bench> [count]\n", argv[0]);
+      for (u32 i = 0; i < ArrayCount(Benches); i++)
+         printf("   %s (default count %u)\n", Benches[i].Name, Benches[i].DefaultCount);
+      return 1;
+   }
+
+   for (u32 i = 0; i < ArrayCount(Benches); i++)
+   {
+      if (strcmp(argv[1], Benches[i].Name) == 0)
+      {
+         u32 count = (argc > 2) ? (u32)atoi(argv[2]) : Benches[i].DefaultCount;
+         Benches[i].Run(count);
+         return 0;
+      }
+   }
+
+   printf("unknown bench %s\n", argv[1]);
+   return 1;
+}
@@ -347,6 +347,9 @@ int main(int argc, char* argv[])
       for (int i = 0; i < 3; i++)
          entity.m_pSize[i] = size[i];
 
+      // The collision early outs use bounds cached from the size
+      entity.UpdateBounds();
+
       if (ImGui::Button("Reset##Size"))
       {
          entity.SetDepth(2.0);
@@ -402,16 +405,27 @@ int main(int argc, char* argv[])
 
       ImGui::SeparatorText("Results (Old)");
       int face = entity.SphereCollisionOld(sphere, 0.0, miss_distance, poc);
-      ImGui::Text("Face: %s (%d)", (face == -1) ? "None" : face_str[face-1], face);
+      ImGui::Text("Face: %s (%d)", (face <= 0) ? "None" : face_str[face-1], face);
       ImGui::Text("Miss Distance (m): %f", miss_distance);
       ImGui::Text("Point on Face: (%f, %f, %f)", poc.data[0], poc.data[1], poc.data[2]);
 
+      int      face_old = face;
+      C_vector poc_old  = poc;
+
       ImGui::SeparatorText("Results (New)");
       face = entity.SphereCollision(sphere, 0.0, miss_distance, poc);
-      ImGui::Text("Face: %s (%d)", (face == -1) ? "None" : face_str[face-1], face);
+      ImGui::Text("Face: %s (%d)", (face == 0) ? "None (outside bounds)" : (face < 0) ? "None" : face_str[face-1], face);
       ImGui::Text("Miss Distance (m): %f", miss_distance);
       ImGui::Text("Point on Face: (%f, %f, %f)", poc.data[0], poc.data[1], poc.data[2]);
 
+      // Points outside the boundary sphere or box are settled without a
+      // face, the six face test still names the closest one for drawing
+      if (face == 0)
+      {
+         face = face_old;
+         poc  = poc_old;
+      }
+
       ImGui::EndChild();
 
       ImGui::End();
@@ -494,7 +508,7 @@ int main(int argc, char* argv[])
       glLineWidth(1.0);
 
       // Draw intersection point
-      if (face != -1)
+      if (face > 0)
       {
          glm::vec3 pocPos(poc.data[0], poc.data[1], poc.data[2]);
 
@@ -537,7 +551,7 @@ int main(int argc, char* argv[])
       GLCALL(glDrawArrays(GL_POINTS, 0, 1));
       GLCALL(glBindVertexArray(0));
 
-      if (face != -1)
+      if (face > 0)
       {
          // Get the face defining corners via C_cuboid helper
          C_vector c0, c1, c2, c3;
@@ -187,6 +187,9 @@ int main(int argc, char* argv[])
 
       for (int i = 0; i < 3; i++)
          entity.m_pSize[i] = size[i];
+
+      // The collision early outs use bounds cached from the size
+      entity.UpdateBounds();
    
       if (ImGui::Button("Reset##Size"))
       {
@@ -217,13 +220,13 @@ int main(int argc, char* argv[])
 
       ImGui::SeparatorText("Results (New)");
       int face = entity.SphereCollision(sphere, 0.0, miss_distance, poc);
-      ImGui::Text("Face: %s (%d)", (face == -1) ? "None" : face_str[face-1], face);
+      ImGui::Text("Face: %s (%d)", (face == 0) ? "None (outside bounds)" : (face < 0) ? "None" : face_str[face-1], face);
       ImGui::Text("Miss Distance (m): %f", miss_distance);
       ImGui::Text("Point on Face: (%f, %f, %f)", poc.data[0], poc.data[1], poc.data[2]);
 
       ImGui::SeparatorText("Results (Old)");
       face = entity.SphereCollisionOld(sphere, 0.0, miss_distance, poc);
-      ImGui::Text("Face: %s (%d)", (face == -1) ? "None" : face_str[face-1], face);
+      ImGui::Text("Face: %s (%d)", (face <= 0) ? "None" : face_str[face-1], face);
       ImGui::Text("Miss Distance (m): %f", miss_distance);
       ImGui::Text("Point on Face: (%f, %f, %f)", poc.data[0], poc.data[1], poc.data[2]);
 
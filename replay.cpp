@@ -0,0 +1,630 @@
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#include "CommonTypes.h"
+#include "FileUtils.cpp"
+#include "AsyncReader.cpp"
+#include "Vector.cpp"
+#include "Cuboid.cpp"
+#include "ThreadPool.cpp"
+#include "Recording.cpp"
+#include "BlockCodec.cpp"
+#include "RecordingFile.cpp"
+#include "SeekIndex.cpp"
+#include "RecordingTail.cpp"
+#include "Replay.cpp"
+#include "Pipeline.cpp"
+
+// Headless replay of a recording, scores every shot against every entity:
+//    replay <recording> [-o results.csv] [-r radius] [-t threads] [-hits] [-whole] [-qd depth] [-pread]
+//    replay <recording> [-window first count] [-entity id] [-o results.csv] [-r radius] [-t threads] [-hits]
+//    replay <recording> -convert <binary recording> [-delta]
+//    replay <recording> -index
+//    replay <recording> -follow [-o results.csv] [-r radius] [-t threads] [-hits]
+// Binary recordings are recognized by their header and always replayed mapped.
+// A window of a text recording is found through its -index sidecar.
+
+using replay_clock = std::chrono::steady_clock;
+
+#define REPLAY_DECODE_BLOCKS 8         // coded blocks per kind decoded at once, at most
+#define REPLAY_FOLLOW_POLL   100       // ms between checks for an interrupt while following
+#define REPLAY_PARSE_SLICE   (1 << 20) // records parsed at a time through a seek index
+
+// The part of a recording to score, all of it by default. Entity states
+// before the window still apply.
+struct TReplayWindow
+{
+   u64  First;  // record numbers [First, End) are scored
+   u64  End;
+   bool Entity; // only one entity is tracked and scored against
+   u32  Id;
+};
+
+static f64 SecondsSince(replay_clock::time_point Start)
+{
+   return std::chrono::duration<f64>(replay_clock::now() - Start).count();
+}
+
+static void Usage(const char* Name)
+{
+   fprintf(stderr, "usage: %s <recording> [-o results.csv] [-r radius] [-t threads] [-hits] [-whole] [-qd depth] [-pread]\n", Name);
+   fprintf(stderr, "       %s <recording> [-window first count] [-entity id] [-o results.csv] [-r radius] [-t threads] [-hits]\n", Name);
+   fprintf(stderr, "       %s <recording> -convert <binary recording> [-delta]\n", Name);
+   fprintf(stderr, "       %s <recording> -index\n", Name);
+   fprintf(stderr, "       %s <recording> -follow [-o results.csv] [-r radius] [-t threads] [-hits]\n", Name);
+   fprintf(stderr, "   -o       write the scores here instead of stdout\n");
+   fprintf(stderr, "   -r       round radius in meters (default 0)\n");
+   fprintf(stderr, "   -t       scoring threads, 0 uses every core (default 0)\n");
+   fprintf(stderr, "   -hits    only write shot/entity pairs that hit\n");
+   fprintf(stderr, "   -whole   map the whole file first instead of streaming it\n");
+   fprintf(stderr, "   -qd      streamed reads kept in flight (default %u)\n", C_replayPipeline::QUEUE_DEPTH);
+   fprintf(stderr, "   -pread   stream with blocking preads on threads instead of io_uring\n");
+   fprintf(stderr, "   -window  only score the shots of records [first, first + count), text needs the -index sidecar\n");
+   fprintf(stderr, "   -entity  only score against the entity with this id, binary recordings only\n");
+   fprintf(stderr, "   -convert write a text recording out as a binary one and exit\n");
+   fprintf(stderr, "   -delta   with -convert, delta and varint code the blocks\n");
+   fprintf(stderr, "   -index   write the <recording>.idx seek index and exit\n");
+   fprintf(stderr, "   -follow  score the recording, then lines appended to it, until interrupted\n");
+}
+
+static void PrintTotals(const C_replay& Replay, f64 Seconds)
+{
+   const TReplayStats& stats = Replay.Stats();
+
+   fprintf(stderr, "   %llu shots, %u entities, %llu entity updates, %llu pairs scored, %llu hits\n",
+           (unsigned long long)stats.Shots, Replay.Entities(), (unsigned long long)stats.EntityUpdates,
+           (unsigned long long)stats.Pairs, (unsigned long long)stats.Hits);
+   fprintf(stderr, "   total %.3f s, %.2f Mshots/s\n", Seconds, stats.Shots / Seconds * 1e-6);
+}
+
+// Streams the file through the read/parse/score/write pipeline
+static bool ReplayStream(const char* Input, FILE* Out, C_replay& Replay, bool HitsOnly, u32 QueueDepth, EReadBackend Backend)
+{
+   C_replayPipeline pipeline(Replay, QueueDepth, Backend);
+   TPipelineStats   stats;
+   auto             start = replay_clock::now();
+
+   if (!pipeline.Run(Input, Out, HitsOnly, stats))
+   {
+      fprintf(stderr, "cannot read %s\n", Input);
+      return false;
+   }
+
+   f64 seconds = SecondsSince(start);
+
+   fprintf(stderr, "replay: %s, %.1f MB in %llu chunks read with %s, %llu records (%llu malformed lines)\n",
+           Input, stats.Bytes / 1e6, (unsigned long long)stats.Chunks,
+           (pipeline.Backend() == READ_BACKEND_URING) ? "io_uring" : "pread threads",
+           (unsigned long long)Replay.Stats().Records, (unsigned long long)stats.Malformed);
+   fprintf(stderr, "   busy: read %.3f s, parse %.3f s, score %.3f s, write %.3f s\n",
+           stats.ReadSeconds, stats.ParseSeconds, stats.ScoreSeconds, stats.WriteSeconds);
+   fprintf(stderr, "   waits: read %llu, parse %llu, score %llu (for free buffers), write %llu (for scores)\n",
+           (unsigned long long)stats.ReadStalls, (unsigned long long)stats.ParseStalls,
+           (unsigned long long)stats.ScoreStalls, (unsigned long long)stats.WriteStalls);
+   PrintTotals(Replay, seconds);
+   return true;
+}
+
+// Scores and writes Count parsed records from First on in slices of
+// ScoreSlice() records, so one batch of scores stays under
+// C_replay::SCORE_PAIRS pairs however many entities there are
+static void ScoreRecords(const TRecordColumns& Records, u64 First, u64 Count, FILE* Out, C_replay& Replay, bool HitsOnly,
+                         std::vector<TPairScore>& Scores, f64& ScoreSeconds, f64& WriteSeconds)
+{
+   for (u64 end = First + Count; First < end;)
+   {
+      u64  slice = std::min<u64>(Replay.ScoreSlice(), end - First);
+      auto start = replay_clock::now();
+
+      Scores.clear();
+      Replay.Replay(Records, First, slice, Scores);
+      ScoreSeconds += SecondsSince(start);
+
+      start = replay_clock::now();
+      C_replay::WriteScores(Out, Scores.data(), Scores.size(), HitsOnly);
+      WriteSeconds += SecondsSince(start);
+
+      First += slice;
+   }
+}
+
+// Maps and parses the whole file, then scores and writes it in slices
+static bool ReplayWhole(const char* Input, FILE* Out, C_replay& Replay, bool HitsOnly)
+{
+   C_mappedFile mapping;
+   auto         start = replay_clock::now();
+   TBuffer      file  = mapping.Map(Input, true);
+
+   if (!file.Data)
+   {
+      fprintf(stderr, "cannot read %s\n", Input);
+      return false;
+   }
+
+   f64 read_seconds = SecondsSince(start);
+
+   TRecordColumns records;
+   u64            malformed = 0;
+
+   start = replay_clock::now();
+   ParseRecordingParallel(file.Data, file.Size, records, Replay.Pool(), &malformed);
+   f64 parse_seconds = SecondsSince(start);
+
+   std::vector<TPairScore> scores;
+   f64                     score_seconds = 0.0;
+   f64                     write_seconds = 0.0;
+
+   ScoreRecords(records, 0, records.Count(), Out, Replay, HitsOnly, scores, score_seconds, write_seconds);
+
+   fprintf(stderr, "replay: %s, %.1f MB, %llu records (%llu malformed lines)\n",
+           Input, file.Size / 1e6, (unsigned long long)records.Count(), (unsigned long long)malformed);
+   fprintf(stderr, "   read %.3f s, parse %.3f s (%.1f MB/s), score %.3f s, write %.3f s\n",
+           read_seconds, parse_seconds, file.Size / 1e6 / parse_seconds, score_seconds, write_seconds);
+   PrintTotals(Replay, read_seconds + parse_seconds + score_seconds + write_seconds);
+   return true;
+}
+
+// Replays a window of a text recording found through its seek index. The
+// records before the window are parsed on the pool for their entity states
+// only, the window is then parsed, scored and written REPLAY_PARSE_SLICE
+// records at a time.
+static bool ReplayIndexed(const char* Input, FILE* Out, C_replay& Replay, bool HitsOnly, const TReplayWindow& Window)
+{
+   C_seekIndex  index;
+   std::string  sidecar = C_seekIndex::SidecarName(Input);
+   C_mappedFile mapping;
+   TBuffer      file    = mapping.Map(Input);
+
+   if (!file.Data)
+   {
+      fprintf(stderr, "cannot read %s\n", Input);
+      return false;
+   }
+
+   if (!index.Load(sidecar.c_str(), Input))
+   {
+      fprintf(stderr, "%s is missing, damaged or older than %s, write it with -index\n", sidecar.c_str(), Input);
+      return false;
+   }
+
+   u64            first = std::min(Window.First, index.Records());
+   u64            end   = std::min(Window.End, index.Records());
+   TRecordColumns records;
+   auto           start = replay_clock::now();
+
+   // Shots before the window still count towards the shot ordinals
+   for (u64 at = 0; at < first; at += REPLAY_PARSE_SLICE)
+   {
+      u64 shots = 0;
+
+      records.Clear();
+      ParseRecordingRange(index, file.Data, file.Size, at, std::min<u64>(REPLAY_PARSE_SLICE, first - at), records, Replay.Pool());
+
+      for (u64 r = 0; r < records.Count(); r++)
+      {
+         if (records.Kind[r] != RECORD_ENTITY)
+         {
+            shots++;
+            continue;
+         }
+
+         TRecord record;
+
+         records.Get(r, record);
+         Replay.ApplyEntity(record);
+      }
+
+      Replay.SkipShots(shots);
+   }
+
+   f64 prefix_seconds = SecondsSince(start);
+
+   std::vector<TPairScore> scores;
+   f64                     parse_seconds = 0.0;
+   f64                     score_seconds = 0.0;
+   f64                     write_seconds = 0.0;
+
+   for (u64 at = first; at < end; at += REPLAY_PARSE_SLICE)
+   {
+      start = replay_clock::now();
+      records.Clear();
+      ParseRecordingRange(index, file.Data, file.Size, at, std::min<u64>(REPLAY_PARSE_SLICE, end - at), records, Replay.Pool());
+      parse_seconds += SecondsSince(start);
+
+      ScoreRecords(records, 0, records.Count(), Out, Replay, HitsOnly, scores, score_seconds, write_seconds);
+   }
+
+   u64 skip;
+   u64 offset = index.Seek(first, skip);
+
+   fprintf(stderr, "replay: %s, records [%llu, %llu) of %llu, parsed from byte %llu on\n", Input,
+           (unsigned long long)first, (unsigned long long)end, (unsigned long long)index.Records(), (unsigned long long)offset);
+   fprintf(stderr, "   entity states before the window %.3f s, parse %.3f s, score %.3f s, write %.3f s\n",
+           prefix_seconds, parse_seconds, score_seconds, write_seconds);
+   PrintTotals(Replay, prefix_seconds + parse_seconds + score_seconds + write_seconds);
+   return true;
+}
+
+static volatile sig_atomic_t g_StopFollowing = 0;
+
+static void StopFollowing(int)
+{
+   g_StopFollowing = 1;
+}
+
+// Scores the recording and then every line appended to it as it arrives,
+// flushing the scores of each batch. Ends on SIGINT or SIGTERM, or when the
+// file is deleted or moved.
+static bool ReplayFollow(const char* Input, FILE* Out, C_replay& Replay, bool HitsOnly)
+{
+   C_recordingTail tail;
+
+   if (!tail.Open(Input))
+   {
+      fprintf(stderr, "cannot follow %s\n", Input);
+      return false;
+   }
+
+   signal(SIGINT, StopFollowing);
+   signal(SIGTERM, StopFollowing);
+
+   fprintf(stderr, "replay: following %s, interrupt to stop\n", Input);
+
+   TRecordColumns          records;
+   std::vector<TPairScore> scores;
+   u64                     batches = 0;
+   f64                     busy    = 0.0;
+   f64                     worst   = 0.0;
+
+   while (!g_StopFollowing)
+   {
+      records.Clear();
+
+      ETailState state = tail.Poll(REPLAY_FOLLOW_POLL, records);
+
+      if (state == TAIL_GONE)
+         break;
+
+      if (state != TAIL_RECORDS)
+         continue;
+
+      auto start         = replay_clock::now();
+      f64  score_seconds = 0.0;
+      f64  write_seconds = 0.0;
+
+      ScoreRecords(records, 0, records.Count(), Out, Replay, HitsOnly, scores, score_seconds, write_seconds);
+      fflush(Out);
+
+      f64 seconds = SecondsSince(start);
+
+      busy  += seconds;
+      worst  = std::max(worst, seconds);
+      batches++;
+   }
+
+   const TTailStats& stats = tail.Stats();
+
+   fprintf(stderr, "replay: %s followed, %.1f MB, %llu records (%llu malformed lines), %llu truncations\n",
+           Input, stats.Bytes / 1e6, (unsigned long long)stats.Records, (unsigned long long)stats.Malformed,
+           (unsigned long long)stats.Truncations);
+   fprintf(stderr, "   %llu batches from %llu wakeups, scored and written in %.3f ms on average, %.3f ms at worst\n",
+           (unsigned long long)batches, (unsigned long long)stats.Wakeups,
+           batches ? busy / batches * 1e3 : 0.0, worst * 1e3);
+   PrintTotals(Replay, busy);
+   return true;
+}
+
+// Scores a binary recording straight from its mapped columns. Shot and
+// entity blocks are merged by record number, each run of shots between two
+// entity states is scored in place. Only the shot blocks of the window are
+// loaded, and with an entity filter only the entity blocks holding it.
+static bool ReplayBinary(const C_recordingFile& File, const char* Input, FILE* Out, C_replay& Replay, bool HitsOnly,
+                         const TReplayWindow& Window)
+{
+   // Blocks are loaded a batch at a time, coded ones decode across the pool
+   struct TCursor
+   {
+      const std::vector<u32>*       Blocks;
+      u32                           Next;    // next block to load
+      u32                           Loaded;  // blocks in the batch
+      u32                           Current; // block of the batch in use
+      u32                           Index;   // row in that block
+      TRecordBlock                  Block;
+      std::vector<TRecordBlock>     Views;
+      std::vector<std::vector<u64>> Buffers;
+      bool                          Valid;
+   };
+
+   u32  batch   = (File.Codec() == RECORD_CODEC_NONE) ? 1 : std::min<u32>(Replay.Pool().Threads(), REPLAY_DECODE_BLOCKS);
+   bool damaged = false;
+
+   auto advance = [&](TCursor& Cursor)
+   {
+      while (Cursor.Valid && Cursor.Index == Cursor.Block.Count)
+      {
+         Cursor.Index = 0;
+
+         if (++Cursor.Current >= Cursor.Loaded)
+         {
+            Cursor.Loaded  = std::min<u32>(batch, (u32)Cursor.Blocks->size() - Cursor.Next);
+            Cursor.Current = 0;
+            Cursor.Valid   = Cursor.Loaded > 0;
+
+            if (Cursor.Valid && !File.DecodeBlocks(Cursor.Blocks->data() + Cursor.Next, Cursor.Loaded,
+                                                   Cursor.Buffers.data(), Cursor.Views.data(), Replay.Pool()))
+               damaged = true;
+
+            Cursor.Next += Cursor.Loaded;
+         }
+
+         if (Cursor.Valid)
+            Cursor.Block = Cursor.Views[Cursor.Current];
+      }
+   };
+
+   std::vector<u32> shot_blocks, entity_blocks;
+
+   File.BlocksInRange(RECORD_SHOT, Window.First, Window.End - 1, shot_blocks);
+
+   if (Window.Entity)
+   {
+      u32        count = 0;
+      const u32* list  = File.EntityBlocks(Window.Id, count);
+
+      for (u32 i = 0; i < count && File.Index(list[i]).FirstRow < Window.End; i++)
+         entity_blocks.push_back(list[i]);
+   }
+   else
+   {
+      File.BlocksInRange(RECORD_ENTITY, 0, Window.End - 1, entity_blocks);
+   }
+
+   // Shots before the window still count towards the shot ordinals
+   for (u32 b : File.KindBlocks(RECORD_SHOT))
+   {
+      if (File.Index(b).LastRow >= Window.First)
+         break;
+
+      Replay.SkipShots(File.Index(b).Count);
+   }
+
+   TCursor shots    = { &shot_blocks,   0, 0, 0, 0, {}, {}, {}, true };
+   TCursor entities = { &entity_blocks, 0, 0, 0, 0, {}, {}, {}, true };
+
+   for (TCursor* cursor : { &shots, &entities })
+   {
+      cursor->Views.resize(batch);
+      cursor->Buffers.resize(batch);
+   }
+
+   advance(shots);
+   advance(entities);
+
+   std::vector<TPairScore> scores;
+   f64                     score_seconds = 0.0;
+   f64                     write_seconds = 0.0;
+
+   for (;;)
+   {
+      u64 shot_row   = shots.Valid    ? shots.Block.Row[shots.Index]       : ~0ULL;
+      u64 entity_row = entities.Valid ? entities.Block.Row[entities.Index] : ~0ULL;
+
+      // Rows past the window end it, as does the end of both kinds
+      if (shot_row >= Window.End && entity_row >= Window.End)
+         break;
+
+      if (entity_row < shot_row)
+      {
+         TRecord record;
+
+         entities.Block.Get(entities.Index++, record);
+
+         if (!Window.Entity || record.Id == Window.Id)
+            Replay.ApplyEntity(record);
+
+         advance(entities);
+         continue;
+      }
+
+      const TRecordBlock& b     = shots.Block;
+      u32                 first = shots.Index;
+
+      // The first shot block of the window may start before it
+      if (shot_row < Window.First)
+      {
+         shots.Index = (u32)(std::lower_bound(b.Row + first, b.Row + b.Count, Window.First) - b.Row);
+         Replay.SkipShots(shots.Index - first);
+         advance(shots);
+         continue;
+      }
+
+      // The shots of this block before the next entity state
+      u32 end = (u32)(std::lower_bound(b.Row + first, b.Row + b.Count, std::min(entity_row, Window.End)) - b.Row);
+
+      end = (u32)std::min<u64>(end, first + Replay.ScoreSlice());
+
+      // A shot sharing its record number with an entity state cannot be
+      // ordered, the file is damaged and nothing more can be merged
+      if (end == first)
+      {
+         damaged = true;
+         break;
+      }
+
+      const f64* position[3] = { b.Position[0] + first, b.Position[1] + first, b.Position[2] + first };
+
+      scores.clear();
+
+      auto start = replay_clock::now();
+      Replay.ScoreShots(position, b.Id + first, end - first, scores);
+      score_seconds += SecondsSince(start);
+
+      start = replay_clock::now();
+      C_replay::WriteScores(Out, scores.data(), scores.size(), HitsOnly);
+      write_seconds += SecondsSince(start);
+
+      shots.Index = end;
+      advance(shots);
+   }
+
+   if (damaged)
+   {
+      fprintf(stderr, "replay: %s has damaged blocks, not all of its records were replayed\n", Input);
+      return false;
+   }
+
+   fprintf(stderr, "replay: %s, binary%s, %u blocks, %llu records, %zu shot and %zu entity blocks loaded\n", Input,
+           (File.Codec() == RECORD_CODEC_DELTA) ? " delta coded" : "", File.Blocks(), (unsigned long long)File.Rows(),
+           shot_blocks.size(), entity_blocks.size());
+   fprintf(stderr, "   score %.3f s, write %.3f s\n", score_seconds, write_seconds);
+   PrintTotals(Replay, score_seconds + write_seconds);
+   return true;
+}
+
+static bool Convert(const char* Input, const char* Output, ERecordCodec Codec)
+{
+   TRecordConvertStats stats;
+   auto                start = replay_clock::now();
+
+   if (!ConvertRecording(Input, Output, stats, Codec))
+   {
+      fprintf(stderr, "cannot convert %s to %s\n", Input, Output);
+      return false;
+   }
+
+   f64 seconds = SecondsSince(start);
+
+   fprintf(stderr, "convert: %s, %.1f MB, %llu records (%llu malformed lines) -> %s, %.1f MB in %u blocks, %.3f s\n",
+           Input, stats.Bytes / 1e6, (unsigned long long)stats.Rows, (unsigned long long)stats.Malformed,
+           Output, stats.FileBytes / 1e6, stats.Blocks, seconds);
+   return true;
+}
+
+static bool Index(const char* Input)
+{
+   C_seekIndex index;
+   std::string sidecar = C_seekIndex::SidecarName(Input);
+   auto        start   = replay_clock::now();
+
+   if (!index.Build(Input) || !index.Save(sidecar.c_str()))
+   {
+      fprintf(stderr, "cannot index %s\n", Input);
+      return false;
+   }
+
+   fprintf(stderr, "index: %s, %llu records, %llu entries every %u lines -> %s, %.3f s\n",
+           Input, (unsigned long long)index.Records(), (unsigned long long)index.Entries(), C_seekIndex::STRIDE,
+           sidecar.c_str(), SecondsSince(start));
+   return true;
+}
+
+int main(int argc, char* argv[])
+{
+   const char* input     = nullptr;
+   const char* output    = nullptr;
+   f64         radius    = 0.0;
+   u32         threads   = 0;
+   bool        hits_only = false;
+   bool        whole     = false;
+   const char* convert   = nullptr;
+   bool        delta     = false;
+   bool        index     = false;
+   u32         depth     = C_replayPipeline::QUEUE_DEPTH;
+   bool        pread     = false;
+   bool        follow    = false;
+
+   TReplayWindow window = { 0, ~0ULL, false, 0 };
+
+   for (int i = 1; i < argc; i++)
+   {
+      if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+         output = argv[++i];
+      else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+         radius = atof(argv[++i]);
+      else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+         threads = (u32)atoi(argv[++i]);
+      else if (strcmp(argv[i], "-hits") == 0)
+         hits_only = true;
+      else if (strcmp(argv[i], "-whole") == 0)
+         whole = true;
+      else if (strcmp(argv[i], "-convert") == 0 && i + 1 < argc)
+         convert = argv[++i];
+      else if (strcmp(argv[i], "-delta") == 0)
+         delta = true;
+      else if (strcmp(argv[i], "-index") == 0)
+         index = true;
+      else if (strcmp(argv[i], "-qd") == 0 && i + 1 < argc)
+         depth = (u32)atoi(argv[++i]);
+      else if (strcmp(argv[i], "-pread") == 0)
+         pread = true;
+      else if (strcmp(argv[i], "-follow") == 0)
+         follow = true;
+      else if (strcmp(argv[i], "-window") == 0 && i + 2 < argc)
+      {
+         window.First = strtoull(argv[++i], nullptr, 10);
+         window.End   = window.First + std::min<u64>(strtoull(argv[++i], nullptr, 10), ~0ULL - window.First);
+      }
+      else if (strcmp(argv[i], "-entity") == 0 && i + 1 < argc)
+      {
+         window.Entity = true;
+         window.Id     = (u32)strtoul(argv[++i], nullptr, 10);
+      }
+      else if (argv[i][0] != '-' && !input)
+         input = argv[i];
+      else
+      {
+         Usage(argv[0]);
+         return 1;
+      }
+   }
+
+   if (!input || window.End <= window.First)
+   {
+      Usage(argv[0]);
+      return 1;
+   }
+
+   if (convert)
+      return Convert(input, convert, delta ? RECORD_CODEC_DELTA : RECORD_CODEC_NONE) ? 0 : 1;
+
+   if (index)
+      return Index(input) ? 0 : 1;
+
+   FILE* out = output ? fopen(output, "wb") : stdout;
+
+   if (!out)
+   {
+      fprintf(stderr, "cannot write %s\n", output);
+      return 1;
+   }
+
+   C_replay        replay(radius, threads, !hits_only);
+   C_recordingFile binary;
+   bool            windowed = window.First != 0 || window.End != ~0ULL || window.Entity;
+   bool            ok;
+
+   if (follow)
+      ok = ReplayFollow(input, out, replay, hits_only);
+   else if (binary.Open(input))
+      ok = ReplayBinary(binary, input, out, replay, hits_only, window);
+   else if (window.Entity)
+   {
+      fprintf(stderr, "-entity needs a binary recording\n");
+      ok = false;
+   }
+   else if (windowed)
+      ok = ReplayIndexed(input, out, replay, hits_only, window);
+   else
+      ok = whole ? ReplayWhole(input, out, replay, hits_only) : ReplayStream(input, out, replay, hits_only, depth, pread ? READ_BACKEND_THREADS : READ_BACKEND_URING);
+
+   if (output)
+      fclose(out);
+   else
+      fflush(out);
+
+   return ok ? 0 : 1;
+}